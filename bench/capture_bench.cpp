@@ -0,0 +1,147 @@
+// compares how many port 53 frames the libpcap path and the TPACKET_V3 ring deliver while a sender floods one
+// device with small dns queries, each backend runs alone against the same burst
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <PcapFilter.h>
+#include <PcapLiveDeviceList.h>
+#include "packet_ring_capture.h"
+
+static constexpr int kDatagrams = 500000;
+static constexpr int kSettleMs = 200;
+
+// an A query for example.com, the payload does not matter to either capture path
+static const uint8_t kQuery[] = {0x12, 0x34, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 7,    'e',  'x',
+                                 'a',  'm',  'p',  'l',  'e',  3,    'c',  'o',  'm',  0,    0x00, 0x01, 0x00, 0x01};
+
+struct frame_counter
+{
+    std::atomic<uint64_t> frames{0};
+};
+
+static void pcap_frame(pcpp::RawPacket* raw_packet, pcpp::PcapLiveDevice* device, void* cookie)
+{
+    (void)raw_packet;
+    (void)device;
+    static_cast<frame_counter*>(cookie)->frames.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void ring_frame(const uint8_t* data, uint32_t length, const timespec& timestamp, uint16_t link_type, void* cookie)
+{
+    (void)data;
+    (void)length;
+    (void)timestamp;
+    (void)link_type;
+    static_cast<frame_counter*>(cookie)->frames.fetch_add(1, std::memory_order_relaxed);
+}
+
+// returns the seconds the burst took to send
+static double flood(const char* address)
+{
+    const int sender = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    sockaddr_in target = {};
+    target.sin_family = AF_INET;
+    target.sin_port = htons(53);
+    if (sender < 0 || ::inet_pton(AF_INET, address, &target.sin_addr) != 1)
+    {
+        return 0.0;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kDatagrams; ++i)
+    {
+        // a full qdisc is waited out so both backends see the same number of frames
+        while (::sendto(sender, kQuery, sizeof(kQuery), 0, reinterpret_cast<sockaddr*>(&target), sizeof(target)) < 0 && errno == ENOBUFS)
+        {
+            std::this_thread::yield();
+        }
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    ::close(sender);
+    return elapsed.count();
+}
+
+// frames still sitting in an open ring block only show up after the block timeout
+static void settle(const frame_counter& counter)
+{
+    uint64_t seen = counter.frames.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(kSettleMs));
+        const uint64_t now = counter.frames.load(std::memory_order_relaxed);
+        if (now == seen)
+        {
+            return;
+        }
+        seen = now;
+    }
+}
+
+static void report(const char* backend, uint64_t frames, uint64_t drops, double seconds)
+{
+    std::printf("%-6s %10llu frames %9llu dropped %9.1f ms %12.0f frames/s\n",
+                backend,
+                static_cast<unsigned long long>(frames),
+                static_cast<unsigned long long>(drops),
+                seconds * 1000,
+                seconds > 0 ? static_cast<double>(frames) / seconds : 0.0);
+}
+
+static void bench_pcap(const std::string& device_name, const char* address)
+{
+    pcpp::PcapLiveDevice* device = pcpp::PcapLiveDeviceList::getInstance().getPcapLiveDeviceByName(device_name);
+    if (device == nullptr || !device->open())
+    {
+        std::printf("pcap   cannot open %s\n", device_name.c_str());
+        return;
+    }
+    pcpp::PortFilter dns_filter(53, pcpp::SRC_OR_DST);
+    frame_counter counter;
+    if (!device->setFilter(dns_filter) || !device->startCapture(pcap_frame, &counter))
+    {
+        std::printf("pcap   cannot capture on %s\n", device_name.c_str());
+        device->close();
+        return;
+    }
+    const double seconds = flood(address);
+    settle(counter);
+    pcpp::PcapLiveDevice::PcapStats stats = {};
+    device->getStatistics(stats);
+    device->stopCapture();
+    device->close();
+    report("pcap", counter.frames.load(), stats.packetsDrop, seconds);
+}
+
+static void bench_ring(const std::string& device_name, const char* address)
+{
+    packet_ring_capture ring;
+    frame_counter counter;
+    if (!ring.open(device_name) || !ring.start(ring_frame, &counter))
+    {
+        std::printf("ring   cannot capture on %s\n", device_name.c_str());
+        return;
+    }
+    const double seconds = flood(address);
+    settle(counter);
+    ring.stop();
+    packet_ring_stats stats;
+    ring.read_statistics(stats);
+    report("ring", counter.frames.load(), stats.drops, seconds);
+}
+
+int main(int argc, char* argv[])
+{
+    // lo sees every datagram twice, once leaving and once arriving
+    const std::string device_name = argc > 1 ? argv[1] : "lo";
+    const char* address = argc > 2 ? argv[2] : "127.0.0.1";
+    std::printf("%d datagrams to %s:53 on %s\n", kDatagrams, address, device_name.c_str());
+    bench_pcap(device_name, address);
+    bench_ring(device_name, address);
+    return 0;
+}
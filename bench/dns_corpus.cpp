@@ -0,0 +1,497 @@
+#include <ctime>
+#include <string_view>
+#include <endian.h>
+#include <arpa/inet.h>
+#include <Packet.h>
+#include <DnsLayer.h>
+#include <IPLayer.h>
+#include <PcapFileDevice.h>
+#include "dns_corpus.h"
+
+static constexpr uint16_t kDnsPort = 53;
+static constexpr uint16_t kClientPort = 40000;
+static constexpr uint16_t kTypeA = 1;
+static constexpr uint16_t kTypeNs = 2;
+static constexpr uint16_t kTypeCname = 5;
+static constexpr uint16_t kTypePtr = 12;
+static constexpr uint16_t kTypeMx = 15;
+static constexpr uint16_t kTypeAaaa = 28;
+static constexpr uint16_t kFlagsQuery = 0x0100;
+static constexpr uint16_t kFlagsResponse = 0x8180;
+// the question name always starts right after the header
+static constexpr uint16_t kQuestionNameOffset = 12;
+
+static const uint8_t kClientV4[] = {192, 168, 1, 10};
+static const uint8_t kServerV4[] = {192, 168, 1, 1};
+static const uint8_t kClientV6[] = {0xfd, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x10};
+static const uint8_t kServerV6[] = {0xfd, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x01};
+
+namespace
+{
+struct dns_message
+{
+    std::string label;
+    bool is_response = false;
+    std::vector<uint8_t> bytes;
+};
+
+enum class transport : uint8_t
+{
+    kEthernetIpv4Udp,
+    kEthernetIpv6Udp,
+    kEthernetIpv6HopByHopUdp,
+    kVlanIpv4Udp,
+    kDoubleVlanIpv6Udp,
+    kEthernetIpv4Tcp,
+    kEthernetIpv6Tcp,
+    kLinuxSllIpv4Udp,
+    kRawIpv4Udp,
+    kRawIpv6Udp
+};
+
+struct transport_info
+{
+    transport type;
+    const char* label;
+};
+
+const transport_info kTransports[] = {
+    {transport::kEthernetIpv4Udp, "eth/ipv4/udp"},
+    {transport::kEthernetIpv6Udp, "eth/ipv6/udp"},
+    {transport::kEthernetIpv6HopByHopUdp, "eth/ipv6+hbh/udp"},
+    {transport::kVlanIpv4Udp, "eth/vlan/ipv4/udp"},
+    {transport::kDoubleVlanIpv6Udp, "eth/vlan/vlan/ipv6/udp"},
+    {transport::kEthernetIpv4Tcp, "eth/ipv4/tcp"},
+    {transport::kEthernetIpv6Tcp, "eth/ipv6/tcp"},
+    {transport::kLinuxSllIpv4Udp, "sll/ipv4/udp"},
+    {transport::kRawIpv4Udp, "raw/ipv4/udp"},
+    {transport::kRawIpv6Udp, "raw/ipv6/udp"},
+};
+}    // namespace
+
+static void put_u16(std::vector<uint8_t>& out, uint16_t value)
+{
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+static void put_u32(std::vector<uint8_t>& out, uint32_t value)
+{
+    put_u16(out, static_cast<uint16_t>(value >> 16));
+    put_u16(out, static_cast<uint16_t>(value));
+}
+
+static void put_bytes(std::vector<uint8_t>& out, const uint8_t* data, size_t length) { out.insert(out.end(), data, data + length); }
+
+// writes the labels of a dotted name, the terminating zero is left to the caller so a pointer can follow instead
+static void put_labels(std::vector<uint8_t>& out, std::string_view dotted)
+{
+    while (!dotted.empty())
+    {
+        const size_t dot = dotted.find('.');
+        const std::string_view label = dotted.substr(0, dot);
+        out.push_back(static_cast<uint8_t>(label.size()));
+        out.insert(out.end(), label.begin(), label.end());
+        dotted = dot == std::string_view::npos ? std::string_view() : dotted.substr(dot + 1);
+    }
+}
+
+static void put_name(std::vector<uint8_t>& out, std::string_view dotted)
+{
+    put_labels(out, dotted);
+    out.push_back(0);
+}
+
+static void put_pointer(std::vector<uint8_t>& out, uint16_t offset) { put_u16(out, static_cast<uint16_t>(0xc000 | offset)); }
+
+static dns_message start_message(const char* label, uint16_t id, uint16_t flags, uint16_t answers, std::string_view name, uint16_t type)
+{
+    dns_message message;
+    message.label = label;
+    message.is_response = (flags & 0x8000) != 0;
+    put_u16(message.bytes, id);
+    put_u16(message.bytes, flags);
+    put_u16(message.bytes, 1);
+    put_u16(message.bytes, answers);
+    put_u16(message.bytes, 0);
+    put_u16(message.bytes, 0);
+    put_name(message.bytes, name);
+    put_u16(message.bytes, type);
+    put_u16(message.bytes, 1);
+    return message;
+}
+
+// owner name, type, class, ttl and rdata length, the owner is a pointer like real resolvers send
+static void put_answer_header(std::vector<uint8_t>& out, uint16_t owner, uint16_t type, uint16_t data_length)
+{
+    put_pointer(out, owner);
+    put_u16(out, type);
+    put_u16(out, 1);
+    put_u32(out, 300);
+    put_u16(out, data_length);
+}
+
+static void put_a(std::vector<uint8_t>& out, uint16_t owner, uint8_t last_octet)
+{
+    const uint8_t address[] = {93, 184, 216, last_octet};
+    put_answer_header(out, owner, kTypeA, sizeof(address));
+    put_bytes(out, address, sizeof(address));
+}
+
+static std::vector<dns_message> build_messages()
+{
+    std::vector<dns_message> messages;
+
+    messages.push_back(start_message("a query", 0x1001, kFlagsQuery, 0, "example.com", kTypeA));
+
+    dns_message a_response = start_message("a response", 0x1001, kFlagsResponse, 2, "example.com", kTypeA);
+    put_a(a_response.bytes, kQuestionNameOffset, 34);
+    put_a(a_response.bytes, kQuestionNameOffset, 35);
+    messages.push_back(a_response);
+
+    dns_message aaaa_response = start_message("aaaa response", 0x1002, kFlagsResponse, 1, "ipv6.example.org", kTypeAaaa);
+    const uint8_t address_v6[] = {0x26, 0x06, 0x28, 0x00, 0x02, 0x20, 0, 1, 0x2, 0x48, 0x18, 0x93, 0x25, 0xc8, 0x19, 0x46};
+    put_answer_header(aaaa_response.bytes, kQuestionNameOffset, kTypeAaaa, sizeof(address_v6));
+    put_bytes(aaaa_response.bytes, address_v6, sizeof(address_v6));
+    messages.push_back(aaaa_response);
+
+    // www.example.com CNAME edge.example.com A, the target reuses example.com from the question
+    dns_message cname_response = start_message("cname chain", 0x1003, kFlagsResponse, 2, "www.example.com", kTypeA);
+    put_answer_header(cname_response.bytes, kQuestionNameOffset, kTypeCname, 7);
+    const auto edge_offset = static_cast<uint16_t>(cname_response.bytes.size());
+    put_labels(cname_response.bytes, "edge");
+    put_pointer(cname_response.bytes, kQuestionNameOffset + 4);
+    put_a(cname_response.bytes, edge_offset, 36);
+    messages.push_back(cname_response);
+
+    messages.push_back(start_message("nxdomain", 0x1004, kFlagsResponse | 3, 0, "missing.example.com", kTypeA));
+    messages.push_back(start_message("servfail", 0x1005, kFlagsResponse | 2, 0, "broken.example.com", kTypeAaaa));
+
+    dns_message ptr_response = start_message("ptr response", 0x1006, kFlagsResponse, 1, "10.1.168.192.in-addr.arpa", kTypePtr);
+    std::vector<uint8_t> ptr_target;
+    put_name(ptr_target, "host.lan");
+    put_answer_header(ptr_response.bytes, kQuestionNameOffset, kTypePtr, static_cast<uint16_t>(ptr_target.size()));
+    put_bytes(ptr_response.bytes, ptr_target.data(), ptr_target.size());
+    messages.push_back(ptr_response);
+
+    dns_message ns_response = start_message("ns response", 0x1007, kFlagsResponse, 1, "example.com", kTypeNs);
+    put_answer_header(ns_response.bytes, kQuestionNameOffset, kTypeNs, 6);
+    put_labels(ns_response.bytes, "ns1");
+    put_pointer(ns_response.bytes, kQuestionNameOffset);
+    messages.push_back(ns_response);
+
+    // the mx record is skipped and the walk continues with the address after it
+    dns_message mx_response = start_message("mx then a", 0x1008, kFlagsResponse, 2, "example.com", kTypeMx);
+    put_answer_header(mx_response.bytes, kQuestionNameOffset, kTypeMx, 9);
+    put_u16(mx_response.bytes, 10);
+    put_labels(mx_response.bytes, "mail");
+    put_pointer(mx_response.bytes, kQuestionNameOffset);
+    put_a(mx_response.bytes, kQuestionNameOffset, 37);
+    messages.push_back(mx_response);
+
+    // more answers than the parser keeps
+    dns_message many_response = start_message("many answers", 0x1009, kFlagsResponse, 24, "pool.example.com", kTypeA);
+    for (uint8_t i = 0; i < 24; ++i)
+    {
+        put_a(many_response.bytes, kQuestionNameOffset, i);
+    }
+    messages.push_back(many_response);
+
+    // three 63 byte labels and a 61 byte one are the longest name that fits 255 bytes on the wire
+    std::string long_name;
+    for (int label = 0; label < 4; ++label)
+    {
+        long_name += (label == 0 ? "" : ".") + std::string(label == 3 ? 61 : 63, static_cast<char>('a' + label));
+    }
+    messages.push_back(start_message("longest name", 0x100a, kFlagsQuery, 0, long_name, kTypeA));
+
+    return messages;
+}
+
+static void put_ipv4(std::vector<uint8_t>& out, uint8_t protocol, size_t payload_length, bool from_server)
+{
+    out.push_back(0x45);
+    out.push_back(0);
+    put_u16(out, static_cast<uint16_t>(20 + payload_length));
+    put_u16(out, 0);
+    put_u16(out, 0x4000);
+    out.push_back(64);
+    out.push_back(protocol);
+    put_u16(out, 0);
+    put_bytes(out, from_server ? kServerV4 : kClientV4, 4);
+    put_bytes(out, from_server ? kClientV4 : kServerV4, 4);
+}
+
+static void put_ipv6(std::vector<uint8_t>& out, uint8_t protocol, size_t payload_length, bool from_server, bool hop_by_hop)
+{
+    put_u32(out, 0x60000000);
+    put_u16(out, static_cast<uint16_t>(payload_length + (hop_by_hop ? 8 : 0)));
+    out.push_back(hop_by_hop ? 0 : protocol);
+    out.push_back(64);
+    put_bytes(out, from_server ? kServerV6 : kClientV6, 16);
+    put_bytes(out, from_server ? kClientV6 : kServerV6, 16);
+    if (hop_by_hop)
+    {
+        // one PadN option fills the eight byte header
+        const uint8_t options[] = {protocol, 0, 1, 4, 0, 0, 0, 0};
+        put_bytes(out, options, sizeof(options));
+    }
+}
+
+static std::vector<uint8_t> transport_payload(const dns_message& message, bool tcp)
+{
+    std::vector<uint8_t> segment;
+    const uint16_t source_port = message.is_response ? kDnsPort : kClientPort;
+    const uint16_t destination_port = message.is_response ? kClientPort : kDnsPort;
+    put_u16(segment, source_port);
+    put_u16(segment, destination_port);
+    if (tcp)
+    {
+        put_u32(segment, 1);
+        put_u32(segment, 1);
+        put_u16(segment, 0x5018);
+        put_u16(segment, 65535);
+        put_u32(segment, 0);
+        put_u16(segment, static_cast<uint16_t>(message.bytes.size()));
+    }
+    else
+    {
+        put_u16(segment, static_cast<uint16_t>(8 + message.bytes.size()));
+        put_u16(segment, 0);
+    }
+    put_bytes(segment, message.bytes.data(), message.bytes.size());
+    return segment;
+}
+
+static void put_ethernet(std::vector<uint8_t>& out, size_t vlan_tags, uint16_t ether_type)
+{
+    const uint8_t macs[] = {0x02, 0, 0, 0, 0, 0x01, 0x02, 0, 0, 0, 0, 0x02};
+    put_bytes(out, macs, sizeof(macs));
+    for (size_t tag = 0; tag < vlan_tags; ++tag)
+    {
+        put_u16(out, 0x8100);
+        put_u16(out, static_cast<uint16_t>(100 + tag));
+    }
+    put_u16(out, ether_type);
+}
+
+static dns_corpus_frame wrap(const dns_message& message, const transport_info& info)
+{
+    dns_corpus_frame frame;
+    frame.label = message.label + " " + info.label;
+    const bool tcp = info.type == transport::kEthernetIpv4Tcp || info.type == transport::kEthernetIpv6Tcp;
+    const std::vector<uint8_t> segment = transport_payload(message, tcp);
+    const uint8_t protocol = tcp ? 6 : 17;
+    std::vector<uint8_t>& out = frame.bytes;
+
+    switch (info.type)
+    {
+        case transport::kEthernetIpv4Udp:
+        case transport::kEthernetIpv4Tcp:
+            put_ethernet(out, 0, 0x0800);
+            put_ipv4(out, protocol, segment.size(), message.is_response);
+            break;
+        case transport::kEthernetIpv6Udp:
+        case transport::kEthernetIpv6Tcp:
+            put_ethernet(out, 0, 0x86dd);
+            put_ipv6(out, protocol, segment.size(), message.is_response, false);
+            break;
+        case transport::kEthernetIpv6HopByHopUdp:
+            put_ethernet(out, 0, 0x86dd);
+            put_ipv6(out, protocol, segment.size(), message.is_response, true);
+            break;
+        case transport::kVlanIpv4Udp:
+            put_ethernet(out, 1, 0x0800);
+            put_ipv4(out, protocol, segment.size(), message.is_response);
+            break;
+        case transport::kDoubleVlanIpv6Udp:
+            put_ethernet(out, 2, 0x86dd);
+            put_ipv6(out, protocol, segment.size(), message.is_response, false);
+            break;
+        case transport::kLinuxSllIpv4Udp:
+        {
+            frame.link_type = dns_link_type::kLinuxSll;
+            const uint8_t address[] = {0x02, 0, 0, 0, 0, 0x01, 0, 0};
+            put_u16(out, message.is_response ? 0 : 4);
+            put_u16(out, 1);
+            put_u16(out, 6);
+            put_bytes(out, address, sizeof(address));
+            put_u16(out, 0x0800);
+            put_ipv4(out, protocol, segment.size(), message.is_response);
+            break;
+        }
+        case transport::kRawIpv4Udp:
+            frame.link_type = dns_link_type::kRawIp;
+            put_ipv4(out, protocol, segment.size(), message.is_response);
+            break;
+        case transport::kRawIpv6Udp:
+            frame.link_type = dns_link_type::kRawIp;
+            put_ipv6(out, protocol, segment.size(), message.is_response, false);
+            break;
+    }
+    put_bytes(out, segment.data(), segment.size());
+    return frame;
+}
+
+std::vector<dns_corpus_frame> build_dns_corpus()
+{
+    std::vector<dns_corpus_frame> frames;
+    for (const dns_message& message : build_messages())
+    {
+        for (const transport_info& info : kTransports)
+        {
+            frames.push_back(wrap(message, info));
+        }
+    }
+    return frames;
+}
+
+static bool link_type_of(pcpp::LinkLayerType link_type, dns_link_type& out)
+{
+    switch (link_type)
+    {
+        case pcpp::LINKTYPE_ETHERNET:
+            out = dns_link_type::kEthernet;
+            return true;
+        case pcpp::LINKTYPE_LINUX_SLL:
+            out = dns_link_type::kLinuxSll;
+            return true;
+        case pcpp::LINKTYPE_RAW:
+        case pcpp::LINKTYPE_DLT_RAW1:
+        case pcpp::LINKTYPE_DLT_RAW2:
+            out = dns_link_type::kRawIp;
+            return true;
+        default:
+            return false;
+    }
+}
+
+static pcpp::LinkLayerType pcpp_link_type(dns_link_type link_type)
+{
+    switch (link_type)
+    {
+        case dns_link_type::kLinuxSll:
+            return pcpp::LINKTYPE_LINUX_SLL;
+        case dns_link_type::kRawIp:
+            return pcpp::LINKTYPE_RAW;
+        case dns_link_type::kEthernet:
+            break;
+    }
+    return pcpp::LINKTYPE_ETHERNET;
+}
+
+bool load_dns_capture(const std::string& path, std::vector<dns_corpus_frame>& frames)
+{
+    pcpp::IFileReaderDevice* reader = pcpp::IFileReaderDevice::getReader(path);
+    if (reader == nullptr || !reader->open())
+    {
+        delete reader;
+        return false;
+    }
+    pcpp::RawPacket raw_packet;
+    size_t index = 0;
+    while (reader->getNextPacket(raw_packet))
+    {
+        dns_corpus_frame frame;
+        if (!link_type_of(raw_packet.getLinkLayerType(), frame.link_type))
+        {
+            continue;
+        }
+        frame.label = path + " #" + std::to_string(index++);
+        frame.bytes.assign(raw_packet.getRawData(), raw_packet.getRawData() + raw_packet.getRawDataLen());
+        frames.push_back(std::move(frame));
+    }
+    reader->close();
+    delete reader;
+    return true;
+}
+
+static std::string format_address(std::string_view address)
+{
+    char text[INET6_ADDRSTRLEN] = {};
+    if ((address.size() != 4 && address.size() != 16) ||
+        inet_ntop(address.size() == 4 ? AF_INET : AF_INET6, address.data(), text, sizeof(text)) == nullptr)
+    {
+        return {};
+    }
+    return text;
+}
+
+bool parse_with_wire(const dns_corpus_frame& frame, dns_name_table& names, dns_corpus_fields& fields)
+{
+    dns_wire_message message;
+    if (dns_wire_parser::parse_frame(frame.bytes.data(), frame.bytes.size(), frame.link_type, names, message) != dns_parse_result::kOk)
+    {
+        return false;
+    }
+    fields.transaction_id = message.transaction_id;
+    fields.is_response = message.is_response;
+    fields.response_code = message.response_code;
+    fields.query_name = names.to_qstring(message.query_name).toStdString();
+    fields.query_type = message.query_type;
+    fields.resolver = format_address(message.is_response ? message.source_address : message.destination_address);
+    fields.answers.clear();
+    for (uint8_t i = 0; i < message.answer_count; ++i)
+    {
+        const dns_wire_answer& answer = message.answers[i];
+        if (!answer.address.empty())
+        {
+            fields.answers.push_back(format_address(answer.address));
+        }
+        else if (answer.name != kInvalidNameHandle)
+        {
+            fields.answers.push_back(names.to_qstring(answer.name).toStdString());
+        }
+    }
+    return true;
+}
+
+bool parse_with_pcpp(const dns_corpus_frame& frame, dns_corpus_fields& fields)
+{
+    timespec timestamp = {};
+    pcpp::RawPacket raw_packet(frame.bytes.data(), static_cast<int>(frame.bytes.size()), timestamp, false, pcpp_link_type(frame.link_type));
+    pcpp::Packet parsed_packet(&raw_packet);
+    auto* dns_layer = parsed_packet.getLayerOfType<pcpp::DnsLayer>();
+    auto* ip_layer = parsed_packet.getLayerOfType<pcpp::IPLayer>();
+    if (dns_layer == nullptr || ip_layer == nullptr)
+    {
+        return false;
+    }
+    pcpp::DnsQuery* query = dns_layer->getFirstQuery();
+    if (query == nullptr)
+    {
+        return false;
+    }
+
+    pcpp::dnshdr* dns_header = dns_layer->getDnsHeader();
+    fields.transaction_id = be16toh(dns_header->transactionID);
+    fields.is_response = dns_header->queryOrResponse != 0;
+    fields.response_code = dns_header->responseCode;
+    fields.query_name = query->getName();
+    fields.query_type = static_cast<uint16_t>(query->getDnsType());
+    fields.resolver = fields.is_response ? ip_layer->getSrcIPAddress().toString() : ip_layer->getDstIPAddress().toString();
+    fields.answers.clear();
+    // the wire parser keeps the first kMaxDnsAnswers records, type or not
+    size_t records = 0;
+    for (pcpp::DnsResource* answer = dns_layer->getFirstAnswer(); answer != nullptr && records < kMaxDnsAnswers;
+         answer = dns_layer->getNextAnswer(answer), ++records)
+    {
+        switch (answer->getDnsType())
+        {
+            case pcpp::DNS_TYPE_A:
+                fields.answers.push_back(answer->getData()->castAs<pcpp::IPv4DnsResourceData>()->getIpAddress().toString());
+                break;
+            case pcpp::DNS_TYPE_AAAA:
+                fields.answers.push_back(answer->getData()->castAs<pcpp::IPv6DnsResourceData>()->getIpAddress().toString());
+                break;
+            case pcpp::DNS_TYPE_CNAME:
+            case pcpp::DNS_TYPE_NS:
+            case pcpp::DNS_TYPE_PTR:
+                fields.answers.push_back(answer->getData()->castAs<pcpp::StringDnsResourceData>()->toString());
+                break;
+            default:
+                break;
+        }
+    }
+    return true;
+}
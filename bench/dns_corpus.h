@@ -0,0 +1,38 @@
+#ifndef DNS_CORPUS_H
+#define DNS_CORPUS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "dns_wire_parser.h"
+
+// a captured or generated frame together with the link layer it was captured on
+struct dns_corpus_frame
+{
+    std::string label;
+    dns_link_type link_type = dns_link_type::kEthernet;
+    std::vector<uint8_t> bytes;
+};
+
+// the fields dns_collector publishes for a message, filled the same way from either parser
+struct dns_corpus_fields
+{
+    uint16_t transaction_id = 0;
+    bool is_response = false;
+    uint8_t response_code = 0;
+    std::string query_name;
+    uint16_t query_type = 0;
+    std::string resolver;
+    std::vector<std::string> answers;
+};
+
+// every generated message wrapped in every supported link, vlan, ip version and transport combination
+std::vector<dns_corpus_frame> build_dns_corpus();
+// reads a pcap or pcapng capture, returns false when the file cannot be opened
+bool load_dns_capture(const std::string& path, std::vector<dns_corpus_frame>& frames);
+
+bool parse_with_wire(const dns_corpus_frame& frame, dns_name_table& names, dns_corpus_fields& fields);
+// the pcpp::DnsLayer path the wire parser replaced
+bool parse_with_pcpp(const dns_corpus_frame& frame, dns_corpus_fields& fields);
+
+#endif
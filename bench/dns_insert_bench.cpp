@@ -0,0 +1,173 @@
+// compares dns_logs insert throughput of the old per row autocommit and per batch prepare paths against the
+// group commit through one cached statement that database_manager uses now
+#include <algorithm>
+#include <cstdio>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include "sqlite_store.h"
+
+static constexpr int kRows = 200000;
+// every autocommit waits for its own wal sync, a smaller run gives the same rate
+static constexpr int kAutocommitRows = 5000;
+static constexpr int kQueueBatchRows = 512;
+static constexpr int kGroupCommitRows = 2048;
+static constexpr int kDomains = 500;
+
+static const char* kCreateSql =
+    "CREATE TABLE dns_logs (timestamp INTEGER NOT NULL, transaction_id INTEGER NOT NULL, direction INTEGER NOT NULL, "
+    "query_domain TEXT NOT NULL, query_type TEXT NOT NULL, response_code TEXT, response_data TEXT, resolver_ip TEXT NOT NULL)";
+static const char* kIndexSql = "CREATE INDEX idx_dns_log_time ON dns_logs (timestamp)";
+static const std::string kInsertSql =
+    "INSERT INTO dns_logs (timestamp, transaction_id, direction, query_domain, query_type, response_code, response_data, resolver_ip) "
+    "VALUES (?, ?, ?, ?, ?, ?, ?, ?)";
+
+struct dns_row
+{
+    qint64 timestamp;
+    qint64 transaction_id;
+    qint64 direction;
+    QString query_domain;
+    QString query_type;
+    QString response_code;
+    QString response_data;
+    QString resolver_ip;
+};
+
+// alternating requests and responses for a few hundred domains, about what a busy desktop resolves
+static QList<dns_row> make_rows()
+{
+    QList<dns_row> rows;
+    rows.reserve(kRows);
+    for (int i = 0; i < kRows; ++i)
+    {
+        const bool response = (i % 2) != 0;
+        dns_row row;
+        row.timestamp = 1700000000000LL + i * 5LL;
+        row.transaction_id = i & 0xffff;
+        row.direction = response ? 1 : 0;
+        row.query_domain = QString("host%1.example.com").arg(i / 2 % kDomains);
+        row.query_type = i % 3 == 0 ? "AAAA" : "A";
+        row.response_code = response ? "NoError" : "";
+        row.response_data = response ? "93.184.216.34, 93.184.216.35" : "";
+        row.resolver_ip = "192.168.1.1";
+        rows.append(row);
+    }
+    return rows;
+}
+
+static void bind_row(sqlite_statement& insert, const dns_row& row)
+{
+    insert.bind_int64(1, row.timestamp);
+    insert.bind_int64(2, row.transaction_id);
+    insert.bind_int64(3, row.direction);
+    insert.bind_text(4, row.query_domain);
+    insert.bind_text(5, row.query_type);
+    insert.bind_text(6, row.response_code);
+    insert.bind_text(7, row.response_data);
+    insert.bind_text(8, row.resolver_ip);
+}
+
+static bool open_store(sqlite_database& db, const QString& path)
+{
+    return db.open(path) && db.exec("PRAGMA journal_mode = WAL") && db.exec(kCreateSql) && db.exec(kIndexSql);
+}
+
+static void report(const char* path, qint64 rows, qint64 commits, qint64 elapsed_ns)
+{
+    const double seconds = static_cast<double>(elapsed_ns) / 1e9;
+    std::printf("%-12s %8lld rows %7lld commits %9.1f ms %10.0f rows/s\n",
+                path,
+                static_cast<long long>(rows),
+                static_cast<long long>(commits),
+                seconds * 1000,
+                static_cast<double>(rows) / seconds);
+}
+
+// add_dns_log before the writer was batched, a fresh statement and an implicit transaction per row
+static void bench_autocommit(const QString& path, const QList<dns_row>& rows)
+{
+    sqlite_database db;
+    if (!open_store(db, path))
+    {
+        std::printf("autocommit open failed %s\n", db.last_error());
+        return;
+    }
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < kAutocommitRows; ++i)
+    {
+        auto insert = db.prepare(kInsertSql);
+        bind_row(*insert, rows[i]);
+        insert->execute();
+    }
+    report("autocommit", kAutocommitRows, kAutocommitRows, timer.nsecsElapsed());
+}
+
+// the event queue path before the writer was batched, one transaction and one prepare per capture batch
+static void bench_queue_batches(const QString& path, const QList<dns_row>& rows)
+{
+    sqlite_database db;
+    if (!open_store(db, path))
+    {
+        std::printf("queue batch open failed %s\n", db.last_error());
+        return;
+    }
+    QElapsedTimer timer;
+    timer.start();
+    qint64 commits = 0;
+    for (qsizetype start = 0; start < rows.size(); start += kQueueBatchRows)
+    {
+        db.begin();
+        auto insert = db.prepare(kInsertSql);
+        for (qsizetype i = start; i < std::min<qsizetype>(start + kQueueBatchRows, rows.size()); ++i)
+        {
+            bind_row(*insert, rows[i]);
+            insert->execute();
+        }
+        db.commit();
+        ++commits;
+    }
+    report("queue batch", rows.size(), commits, timer.nsecsElapsed());
+}
+
+static void bench_group_commit(const QString& path, const QList<dns_row>& rows)
+{
+    sqlite_database db;
+    if (!open_store(db, path) || db.statement(kInsertSql) == nullptr)
+    {
+        std::printf("group commit open failed %s\n", db.last_error());
+        return;
+    }
+    QElapsedTimer timer;
+    timer.start();
+    qint64 commits = 0;
+    for (qsizetype start = 0; start < rows.size(); start += kGroupCommitRows)
+    {
+        db.begin();
+        sqlite_statement* insert = db.statement(kInsertSql);
+        for (qsizetype i = start; i < std::min<qsizetype>(start + kGroupCommitRows, rows.size()); ++i)
+        {
+            bind_row(*insert, rows[i]);
+            insert->execute();
+        }
+        db.commit();
+        ++commits;
+    }
+    report("group commit", rows.size(), commits, timer.nsecsElapsed());
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTemporaryDir dir;
+    if (!dir.isValid())
+    {
+        return 1;
+    }
+    const QList<dns_row> rows = make_rows();
+    bench_autocommit(dir.filePath("autocommit.db"), rows);
+    bench_queue_batches(dir.filePath("queue_batch.db"), rows);
+    bench_group_commit(dir.filePath("group_commit.db"), rows);
+    return 0;
+}
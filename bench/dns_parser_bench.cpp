@@ -0,0 +1,52 @@
+// compares the per message cost of dns_wire_parser and the pcpp::DnsLayer path on the generated corpus,
+// or on a pcap capture passed as the first argument
+#include <chrono>
+#include <cstdio>
+#include "dns_corpus.h"
+
+static constexpr size_t kMessages = 2000000;
+
+static void report(const char* path, size_t messages, size_t parsed, std::chrono::nanoseconds elapsed)
+{
+    const double nanos = static_cast<double>(elapsed.count()) / static_cast<double>(messages);
+    std::printf("%-12s %9zu messages %9zu parsed %8.1f ns/message %12.0f messages/s\n", path, messages, parsed, nanos, 1e9 / nanos);
+}
+
+template <typename parse_function>
+static void bench_path(const char* path, const std::vector<dns_corpus_frame>& corpus, parse_function parse)
+{
+    size_t parsed = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < kMessages; ++i)
+    {
+        parsed += parse(corpus[i % corpus.size()]) ? 1 : 0;
+    }
+    report(path, kMessages, parsed, std::chrono::steady_clock::now() - start);
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<dns_corpus_frame> corpus = argc > 1 ? std::vector<dns_corpus_frame>() : build_dns_corpus();
+    if (argc > 1 && !load_dns_capture(argv[1], corpus))
+    {
+        std::printf("cannot read %s\n", argv[1]);
+        return 1;
+    }
+    if (corpus.empty())
+    {
+        std::printf("no ethernet, sll or raw ip frames to parse\n");
+        return 1;
+    }
+    std::printf("%zu distinct frames\n", corpus.size());
+
+    dns_name_table names;
+    dns_corpus_fields fields;
+    // the parse only row is what the capture thread pays before handing interned names on
+    bench_path("wire parse", corpus, [&names](const dns_corpus_frame& frame) {
+        dns_wire_message message;
+        return dns_wire_parser::parse_frame(frame.bytes.data(), frame.bytes.size(), frame.link_type, names, message) == dns_parse_result::kOk;
+    });
+    bench_path("wire fields", corpus, [&names, &fields](const dns_corpus_frame& frame) { return parse_with_wire(frame, names, fields); });
+    bench_path("pcpp fields", corpus, [&fields](const dns_corpus_frame& frame) { return parse_with_pcpp(frame, fields); });
+    return 0;
+}
@@ -0,0 +1,189 @@
+// checks dns_wire_parser against the pcpp::DnsLayer path on the generated corpus, then feeds it every truncation and
+// a fixed set of byte mutations of each frame placed right before an unmapped page so any read past the end faults
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "dns_corpus.h"
+
+static constexpr size_t kMaxFrameLength = 65536;
+static constexpr int kMutationsPerFrame = 2000;
+// small enough that the mutation pass keeps switching name table generations
+static constexpr size_t kMutationNameCapacity = 64;
+
+namespace
+{
+// copies a frame so its last byte sits just before a PROT_NONE page
+class guarded_buffer
+{
+   public:
+    guarded_buffer()
+    {
+        page_size_ = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_ = (kMaxFrameLength + page_size_ - 1) / page_size_ * page_size_;
+        void* mapping = mmap(nullptr, size_ + page_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapping != MAP_FAILED && mprotect(static_cast<uint8_t*>(mapping) + size_, page_size_, PROT_NONE) == 0)
+        {
+            base_ = static_cast<uint8_t*>(mapping);
+        }
+    }
+    ~guarded_buffer()
+    {
+        if (base_ != nullptr)
+        {
+            munmap(base_, size_ + page_size_);
+        }
+    }
+    guarded_buffer(const guarded_buffer&) = delete;
+    guarded_buffer& operator=(const guarded_buffer&) = delete;
+
+    bool is_valid() const { return base_ != nullptr; }
+    const uint8_t* place(const uint8_t* data, size_t length)
+    {
+        uint8_t* start = base_ + size_ - length;
+        if (length > 0)
+        {
+            std::memcpy(start, data, length);
+        }
+        return start;
+    }
+
+   private:
+    uint8_t* base_ = nullptr;
+    size_t size_ = 0;
+    size_t page_size_ = 0;
+};
+}    // namespace
+
+static bool same_fields(const dns_corpus_fields& wire, const dns_corpus_fields& pcpp, const char*& field)
+{
+    field = wire.transaction_id != pcpp.transaction_id ? "transaction id"
+            : wire.is_response != pcpp.is_response     ? "direction"
+            : wire.response_code != pcpp.response_code ? "response code"
+            : wire.query_name != pcpp.query_name       ? "query name"
+            : wire.query_type != pcpp.query_type       ? "query type"
+            : wire.resolver != pcpp.resolver           ? "resolver"
+            : wire.answers != pcpp.answers             ? "answers"
+                                                       : nullptr;
+    return field == nullptr;
+}
+
+static int check_against_pcpp(const std::vector<dns_corpus_frame>& corpus)
+{
+    int failures = 0;
+    dns_name_table names;
+    for (const dns_corpus_frame& frame : corpus)
+    {
+        dns_corpus_fields wire;
+        dns_corpus_fields pcpp;
+        const bool wire_parsed = parse_with_wire(frame, names, wire);
+        const bool pcpp_parsed = parse_with_pcpp(frame, pcpp);
+        const char* field = nullptr;
+        if (!wire_parsed || !pcpp_parsed)
+        {
+            std::printf("FAIL %s parsed by wire %d pcpp %d\n", frame.label.c_str(), wire_parsed, pcpp_parsed);
+            ++failures;
+        }
+        else if (!same_fields(wire, pcpp, field))
+        {
+            std::printf("FAIL %s differs in %s\n", frame.label.c_str(), field);
+            ++failures;
+        }
+    }
+    return failures;
+}
+
+// a truncated frame may still parse when the cut falls in the answers, it must then agree on the question
+static int check_truncations(const std::vector<dns_corpus_frame>& corpus, guarded_buffer& buffer, size_t& truncations)
+{
+    int failures = 0;
+    dns_name_table names;
+    for (const dns_corpus_frame& frame : corpus)
+    {
+        dns_corpus_fields full;
+        parse_with_wire(frame, names, full);
+        for (size_t length = 0; length < frame.bytes.size(); ++length)
+        {
+            const uint8_t* data = buffer.place(frame.bytes.data(), length);
+            dns_wire_message message;
+            const dns_parse_result result = dns_wire_parser::parse_frame(data, length, frame.link_type, names, message);
+            ++truncations;
+            if (result == dns_parse_result::kOk &&
+                (message.transaction_id != full.transaction_id || names.to_qstring(message.query_name).toStdString() != full.query_name))
+            {
+                std::printf("FAIL %s truncated to %zu bytes parsed a different question\n", frame.label.c_str(), length);
+                ++failures;
+            }
+        }
+    }
+    return failures;
+}
+
+// mutations only have to be survived, there is no expected result for a corrupted frame
+static void run_mutations(const std::vector<dns_corpus_frame>& corpus, guarded_buffer& buffer, size_t& mutations)
+{
+    std::mt19937 random(53);
+    dns_name_table names(kMutationNameCapacity);
+    std::vector<uint8_t> mutated;
+    for (const dns_corpus_frame& frame : corpus)
+    {
+        for (int i = 0; i < kMutationsPerFrame; ++i)
+        {
+            mutated = frame.bytes;
+            const int flips = 1 + static_cast<int>(random() % 4);
+            for (int flip = 0; flip < flips; ++flip)
+            {
+                mutated[random() % mutated.size()] = static_cast<uint8_t>(random());
+            }
+            const uint8_t* data = buffer.place(mutated.data(), mutated.size());
+            dns_wire_message message;
+            if (dns_wire_parser::parse_frame(data, mutated.size(), frame.link_type, names, message) == dns_parse_result::kOk)
+            {
+                names.to_qstring(message.query_name);
+            }
+            ++mutations;
+        }
+    }
+}
+
+// a name pointing at itself must end in kMalformed instead of looping
+static int check_pointer_loop(guarded_buffer& buffer)
+{
+    const uint8_t message_bytes[] = {0x12, 0x34, 0x81, 0x80, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01};
+    dns_name_table names;
+    dns_wire_message message;
+    const uint8_t* data = buffer.place(message_bytes, sizeof(message_bytes));
+    if (dns_wire_parser::parse_message(data, sizeof(message_bytes), names, message) != dns_parse_result::kMalformed)
+    {
+        std::printf("FAIL self referencing name pointer was not rejected\n");
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<dns_corpus_frame> corpus = build_dns_corpus();
+    // a capture adds real traffic to the comparison, frames pcpp does not see as dns are compared too
+    if (argc > 1 && !load_dns_capture(argv[1], corpus))
+    {
+        std::printf("cannot read %s\n", argv[1]);
+        return 1;
+    }
+    guarded_buffer buffer;
+    if (!buffer.is_valid())
+    {
+        std::printf("cannot map the guard page\n");
+        return 1;
+    }
+
+    size_t truncations = 0;
+    size_t mutations = 0;
+    int failures = check_against_pcpp(corpus);
+    failures += check_truncations(corpus, buffer, truncations);
+    failures += check_pointer_loop(buffer);
+    run_mutations(corpus, buffer, mutations);
+    std::printf("%zu frames %zu truncations %zu mutations %d failures\n", corpus.size(), truncations, mutations, failures);
+    return failures == 0 ? 0 : 1;
+}
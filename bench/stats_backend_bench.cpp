@@ -0,0 +1,126 @@
+// compares the per tick cost of the interface counter backends on this host, one get_all_stats call per tick,
+// then times proc_net_dev_reader alone on a /proc/net/dev fixture with thousands of interfaces, with and
+// without the per interface flags ioctl the procfs backend falls back to when link notifications are off
+#include <cstdio>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include "network_info.h"
+
+static constexpr int kTicks = 2000;
+static constexpr int kFixtureInterfaces = 4096;
+
+static void report(const char* backend, qsizetype interfaces, qint64 ticks, qint64 elapsed_ns)
+{
+    const double micros = static_cast<double>(elapsed_ns) / 1e3 / static_cast<double>(ticks);
+    std::printf("%-8s %6lld interfaces %6lld ticks %10.1f us/tick\n", backend, static_cast<long long>(interfaces), static_cast<long long>(ticks), micros);
+}
+
+static void bench_backend(network_info::backend type)
+{
+    network_info info(type);
+    // the first call opens the socket or file so it is left out of the timing
+    QList<interface_stats> stats = info.get_all_stats();
+    if (info.active_backend() != type)
+    {
+        std::printf("%-8s unavailable\n", network_info::backend_name(type));
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int tick = 0; tick < kTicks; ++tick)
+    {
+        stats = info.get_all_stats();
+    }
+    report(network_info::backend_name(type), stats.size(), kTicks, timer.nsecsElapsed());
+}
+
+// same layout as the kernel writes, counters differ per interface so the tokenizer sees realistic digit counts
+static bool write_fixture(const std::string& path)
+{
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (file == nullptr)
+    {
+        return false;
+    }
+    std::fputs("Inter-|   Receive                                                |  Transmit\n", file);
+    std::fputs(" face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets errs drop fifo colls carrier "
+               "compressed\n",
+               file);
+    for (int i = 0; i < kFixtureInterfaces; ++i)
+    {
+        const unsigned long long n = static_cast<unsigned long long>(i) + 1;
+        std::fprintf(file,
+                     "veth%05d: %llu %llu 0 %llu 0 0 0 %llu %llu %llu 0 0 0 0 0 0\n",
+                     i,
+                     n * 987654321ULL,
+                     n * 654321ULL,
+                     n % 7,
+                     n % 13,
+                     n * 123456789ULL,
+                     n * 98765ULL);
+    }
+    return std::fclose(file) == 0;
+}
+
+static void bench_fixture(const std::string& path)
+{
+    proc_net_dev_reader reader(path);
+    std::vector<proc_net_dev_entry> entries;
+    if (!reader.open() || !reader.read(entries))
+    {
+        std::printf("fixture %s unreadable\n", path.c_str());
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int tick = 0; tick < kTicks; ++tick)
+    {
+        reader.read(entries);
+    }
+    const qint64 elapsed_ns = timer.nsecsElapsed();
+    report("fixture", static_cast<qsizetype>(entries.size()), kTicks, elapsed_ns);
+    std::printf("fixture %10.1f ns/interface\n", static_cast<double>(elapsed_ns) / kTicks / static_cast<double>(entries.size()));
+
+    // fixture names do not exist here so every ioctl fails with ENODEV, which costs the same syscall round trip
+    size_t running = 0;
+    timer.restart();
+    for (int tick = 0; tick < kTicks; ++tick)
+    {
+        reader.read(entries);
+        for (const auto& entry : entries)
+        {
+            running += reader.is_running(entry) ? 1 : 0;
+        }
+    }
+    const qint64 flags_elapsed_ns = timer.nsecsElapsed();
+    report("flags", static_cast<qsizetype>(entries.size()), kTicks, flags_elapsed_ns);
+    std::printf("flags   %10.1f ns/interface %zu running\n",
+                static_cast<double>(flags_elapsed_ns) / kTicks / static_cast<double>(entries.size()),
+                running);
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    bench_backend(network_info::backend::kNetlink);
+    bench_backend(network_info::backend::kProcNetDev);
+    bench_backend(network_info::backend::kSysfs);
+
+    // a recorded /proc/net/dev can be passed in, otherwise one is generated
+    if (argc > 1)
+    {
+        bench_fixture(argv[1]);
+        return 0;
+    }
+    QTemporaryDir dir;
+    const std::string fixture = dir.filePath("proc_net_dev").toStdString();
+    if (!dir.isValid() || !write_fixture(fixture))
+    {
+        return 1;
+    }
+    bench_fixture(fixture);
+    return 0;
+}
@@ -0,0 +1,454 @@
+// compares insert and range read throughput of the sqlite3 C API store against the QtSql path it replaced,
+// and the on disk size of the row layouts against traffic_block hours
+#include <cstdio>
+#include <random>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QVariantList>
+#include <QtSql/QSqlDatabase>
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+#include "sqlite_store.h"
+#include "traffic_block.h"
+
+static constexpr int kInterfaces = 8;
+static constexpr int kSamplesPerInterface = 50000;
+static constexpr int kCounterCount = 11;
+static constexpr int kRangeReads = 200;
+static constexpr qint64 kRangeSpanMs = 60LL * 60 * 1000;
+
+static const char* kCreateSql =
+    "CREATE TABLE traffic_snapshots ("
+    "timestamp INTEGER NOT NULL, interface_name TEXT NOT NULL, bytes_received INTEGER NOT NULL, bytes_sent INTEGER NOT NULL, "
+    "rx_packets INTEGER NOT NULL, tx_packets INTEGER NOT NULL, rx_errors INTEGER NOT NULL, tx_errors INTEGER NOT NULL, "
+    "rx_dropped INTEGER NOT NULL, tx_dropped INTEGER NOT NULL, rx_fifo_errors INTEGER NOT NULL, tx_fifo_errors INTEGER NOT NULL, "
+    "multicast INTEGER NOT NULL, PRIMARY KEY (timestamp, interface_name))";
+static const char* kInsertSql =
+    "INSERT OR REPLACE INTO traffic_snapshots VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+static const char* kRangeSql =
+    "SELECT timestamp, bytes_received, bytes_sent, rx_packets, tx_packets, rx_errors, tx_errors, rx_dropped, tx_dropped, "
+    "rx_fifo_errors, tx_fifo_errors, multicast FROM traffic_snapshots "
+    "WHERE interface_name = ?1 AND timestamp BETWEEN ?2 AND ?3 ORDER BY timestamp ASC";
+
+struct row
+{
+    qint64 timestamp;
+    QString name;
+    qint64 counters[kCounterCount];
+};
+
+static QList<row> make_rows()
+{
+    QList<row> rows;
+    rows.reserve(kInterfaces * kSamplesPerInterface);
+    for (int s = 0; s < kSamplesPerInterface; ++s)
+    {
+        for (int i = 0; i < kInterfaces; ++i)
+        {
+            row r{};
+            r.timestamp = 1700000000000LL + s * 1000LL;
+            r.name = QString("eth%1").arg(i);
+            for (int c = 0; c < kCounterCount; ++c)
+            {
+                r.counters[c] = static_cast<qint64>(s) * (c + 1) * 1500;
+            }
+            rows.append(r);
+        }
+    }
+    return rows;
+}
+
+static void report(const char* engine, const char* phase, qint64 rows, qint64 elapsed_ns)
+{
+    const double seconds = static_cast<double>(elapsed_ns) / 1e9;
+    std::printf("%-8s %-10s %10lld rows %9.1f ms %12.0f rows/s\n", engine, phase, static_cast<long long>(rows), seconds * 1000, static_cast<double>(rows) / seconds);
+}
+
+static void bench_qtsql(const QString& path, const QList<row>& rows)
+{
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", "bench");
+        db.setDatabaseName(path);
+        if (!db.open())
+        {
+            std::printf("qtsql open failed %s\n", db.lastError().text().toStdString().c_str());
+            return;
+        }
+        QSqlQuery query(db);
+        query.exec("PRAGMA journal_mode = WAL");
+        query.exec(kCreateSql);
+
+        QElapsedTimer timer;
+        timer.start();
+        db.transaction();
+        query.prepare(kInsertSql);
+        QVariantList timestamps;
+        QVariantList names;
+        QVariantList counters[kCounterCount];
+        for (const auto& r : rows)
+        {
+            timestamps.append(r.timestamp);
+            names.append(r.name);
+            for (int c = 0; c < kCounterCount; ++c)
+            {
+                counters[c].append(r.counters[c]);
+            }
+        }
+        query.addBindValue(timestamps);
+        query.addBindValue(names);
+        for (const auto& column : counters)
+        {
+            query.addBindValue(column);
+        }
+        if (!query.execBatch())
+        {
+            std::printf("qtsql insert failed %s\n", query.lastError().text().toStdString().c_str());
+        }
+        db.commit();
+        report("qtsql", "insert", rows.size(), timer.nsecsElapsed());
+
+        qint64 read_rows = 0;
+        timer.restart();
+        query.prepare(kRangeSql);
+        for (int n = 0; n < kRangeReads; ++n)
+        {
+            const qint64 start = rows[(n * 7919) % rows.size()].timestamp;
+            query.bindValue(0, QString("eth%1").arg(n % kInterfaces));
+            query.bindValue(1, start);
+            query.bindValue(2, start + kRangeSpanMs);
+            query.exec();
+            while (query.next())
+            {
+                qint64 sum = query.value(0).toLongLong();
+                for (int c = 1; c <= kCounterCount; ++c)
+                {
+                    sum += query.value(c).toLongLong();
+                }
+                read_rows += sum != 0 ? 1 : 0;
+            }
+        }
+        report("qtsql", "range read", read_rows, timer.nsecsElapsed());
+        db.close();
+    }
+    QSqlDatabase::removeDatabase("bench");
+}
+
+static void bench_sqlite_store(const QString& path, const QList<row>& rows)
+{
+    sqlite_database db;
+    if (!db.open(path))
+    {
+        return;
+    }
+    db.exec("PRAGMA journal_mode = WAL");
+    db.exec(kCreateSql);
+
+    QElapsedTimer timer;
+    timer.start();
+    db.begin();
+    sqlite_statement* insert = db.statement(kInsertSql);
+    for (const auto& r : rows)
+    {
+        insert->bind_int64(1, r.timestamp);
+        insert->bind_text(2, r.name);
+        for (int c = 0; c < kCounterCount; ++c)
+        {
+            insert->bind_int64(c + 3, r.counters[c]);
+        }
+        if (!insert->execute())
+        {
+            break;
+        }
+    }
+    db.commit();
+    report("sqlite3", "insert", rows.size(), timer.nsecsElapsed());
+
+    qint64 read_rows = 0;
+    timer.restart();
+    sqlite_statement* range = db.statement(kRangeSql);
+    for (int n = 0; n < kRangeReads; ++n)
+    {
+        const qint64 start = rows[(n * 7919) % rows.size()].timestamp;
+        range->bind_text(1, QString("eth%1").arg(n % kInterfaces));
+        range->bind_int64(2, start);
+        range->bind_int64(3, start + kRangeSpanMs);
+        while (range->step() == sqlite_statement::step_result::kRow)
+        {
+            qint64 sum = range->column_int64(0);
+            for (int c = 1; c <= kCounterCount; ++c)
+            {
+                sum += range->column_int64(c);
+            }
+            read_rows += sum != 0 ? 1 : 0;
+        }
+        range->reset();
+    }
+    report("sqlite3", "range read", read_rows, timer.nsecsElapsed());
+}
+
+// 30 days of 1 s samples for two interfaces in the old (timestamp, interface_name) layout and the interface major one
+static constexpr qint64 kLayoutDays = 30;
+static constexpr qint64 kLayoutSamples = kLayoutDays * 24 * 60 * 60;
+static constexpr int kLayoutInterfaces = 2;
+
+struct layout
+{
+    const char* name;
+    const char* create_sql[3];
+    const char* fill_sql;
+    const char* range_sql;
+};
+
+static const layout kLayouts[] = {
+    {"legacy",
+     {"CREATE TABLE traffic_snapshots (timestamp INTEGER NOT NULL, interface_name TEXT NOT NULL, bytes_received INTEGER NOT NULL, "
+      "bytes_sent INTEGER NOT NULL, rx_packets INTEGER NOT NULL, tx_packets INTEGER NOT NULL, rx_errors INTEGER NOT NULL, "
+      "tx_errors INTEGER NOT NULL, rx_dropped INTEGER NOT NULL, tx_dropped INTEGER NOT NULL, rx_fifo_errors INTEGER NOT NULL, "
+      "tx_fifo_errors INTEGER NOT NULL, multicast INTEGER NOT NULL, PRIMARY KEY (timestamp, interface_name))",
+      "CREATE INDEX idx_snapshot_time ON traffic_snapshots (timestamp)",
+      nullptr},
+     "WITH RECURSIVE seq(n) AS (SELECT 0 UNION ALL SELECT n + 1 FROM seq WHERE n + 1 < ?1) "
+     "INSERT INTO traffic_snapshots SELECT 1700000000000 + n * 1000, 'enp3s0f' || ?2, n * 1500, n * 900, n, n, 0, 0, 0, 0, 0, 0, 0 "
+     "FROM seq",
+     "SELECT timestamp, bytes_received, bytes_sent FROM traffic_snapshots "
+     "WHERE interface_name = 'enp3s0f' || ?1 AND timestamp BETWEEN ?2 AND ?3 ORDER BY timestamp ASC"},
+    {"clustered",
+     {"CREATE TABLE interfaces (id INTEGER PRIMARY KEY, name TEXT NOT NULL UNIQUE)",
+      "CREATE TABLE traffic_snapshots (interface_id INTEGER NOT NULL, timestamp INTEGER NOT NULL, bytes_received INTEGER NOT NULL, "
+      "bytes_sent INTEGER NOT NULL, rx_packets INTEGER NOT NULL, tx_packets INTEGER NOT NULL, rx_errors INTEGER NOT NULL, "
+      "tx_errors INTEGER NOT NULL, rx_dropped INTEGER NOT NULL, tx_dropped INTEGER NOT NULL, rx_fifo_errors INTEGER NOT NULL, "
+      "tx_fifo_errors INTEGER NOT NULL, multicast INTEGER NOT NULL, PRIMARY KEY (interface_id, timestamp)) WITHOUT ROWID",
+      nullptr},
+     "WITH RECURSIVE seq(n) AS (SELECT 0 UNION ALL SELECT n + 1 FROM seq WHERE n + 1 < ?1) "
+     "INSERT INTO traffic_snapshots SELECT ?2, 1700000000000 + n * 1000, n * 1500, n * 900, n, n, 0, 0, 0, 0, 0, 0, 0 FROM seq",
+     "SELECT timestamp, bytes_received, bytes_sent FROM traffic_snapshots "
+     "WHERE interface_id = ?1 AND timestamp BETWEEN ?2 AND ?3 ORDER BY timestamp ASC"},
+};
+
+static void bench_layout(const QString& path, const layout& table_layout)
+{
+    sqlite_database db;
+    if (!db.open(path))
+    {
+        return;
+    }
+    db.exec("PRAGMA journal_mode = WAL");
+    for (const char* sql : table_layout.create_sql)
+    {
+        if (sql != nullptr)
+        {
+            db.exec(sql);
+        }
+    }
+
+    db.begin();
+    auto fill = db.prepare(table_layout.fill_sql);
+    for (int i = 0; i < kLayoutInterfaces && fill != nullptr; ++i)
+    {
+        fill->bind_int64(1, kLayoutSamples);
+        fill->bind_int64(2, i);
+        fill->execute();
+    }
+    db.commit();
+    db.exec("PRAGMA wal_checkpoint(TRUNCATE)");
+
+    auto size = db.prepare("SELECT page_count * page_size FROM pragma_page_count(), pragma_page_size()");
+    const qint64 bytes = size != nullptr && size->step() == sqlite_statement::step_result::kRow ? size->column_int64(0) : 0;
+    size.reset();
+
+    qint64 read_rows = 0;
+    QElapsedTimer timer;
+    timer.start();
+    sqlite_statement* range = db.statement(table_layout.range_sql);
+    for (int n = 0; n < kRangeReads && range != nullptr; ++n)
+    {
+        const qint64 start = 1700000000000LL + ((n * 7919LL) % kLayoutSamples) * 1000;
+        range->bind_int64(1, n % kLayoutInterfaces);
+        range->bind_int64(2, start);
+        range->bind_int64(3, start + kRangeSpanMs);
+        while (range->step() == sqlite_statement::step_result::kRow)
+        {
+            read_rows += range->column_int64(1) >= 0 ? 1 : 0;
+        }
+        range->reset();
+    }
+    std::printf("%-9s %7.1f MB on disk ", table_layout.name, static_cast<double>(bytes) / (1024.0 * 1024.0));
+    report("", "range scan", read_rows, timer.nsecsElapsed());
+}
+
+// the same 30 days with noisy counters, one busy interface and one that idles between bursts, stored as clustered
+// rows and as traffic_block hours
+static traffic_point next_sample(traffic_point point, bool busy, std::mt19937_64& rng)
+{
+    const bool burst = busy || rng() % 10 == 0;
+    const quint64 rx_bytes = burst ? rng() % (busy ? 2000000 : 40000) : 0;
+    const quint64 tx_bytes = burst ? rng() % (busy ? 400000 : 8000) : 0;
+    point.timestamp_ms += 1000;
+    point.bytes_received += rx_bytes;
+    point.bytes_sent += tx_bytes;
+    point.rx_packets += rx_bytes / (600 + rng() % 900);
+    point.tx_packets += tx_bytes / (100 + rng() % 1400);
+    point.rx_dropped += rng() % 5000 == 0 ? 1 : 0;
+    point.multicast += rng() % 30 == 0 ? 1 : 0;
+    return point;
+}
+
+static qint64 file_bytes(sqlite_database& db)
+{
+    db.exec("PRAGMA wal_checkpoint(TRUNCATE)");
+    auto size = db.prepare("SELECT page_count * page_size FROM pragma_page_count(), pragma_page_size()");
+    return size != nullptr && size->step() == sqlite_statement::step_result::kRow ? size->column_int64(0) : 0;
+}
+
+static void bench_blocks(const QString& rows_path, const QString& blocks_path)
+{
+    sqlite_database rows_db;
+    sqlite_database blocks_db;
+    if (!rows_db.open(rows_path) || !blocks_db.open(blocks_path))
+    {
+        return;
+    }
+    rows_db.exec("PRAGMA journal_mode = WAL");
+    blocks_db.exec("PRAGMA journal_mode = WAL");
+    rows_db.exec(kLayouts[1].create_sql[1]);
+    blocks_db.exec(
+        "CREATE TABLE traffic_blocks (interface_id INTEGER NOT NULL, block_start INTEGER NOT NULL, samples INTEGER NOT NULL, "
+        "last_timestamp INTEGER NOT NULL, data BLOB NOT NULL, PRIMARY KEY (interface_id, block_start)) WITHOUT ROWID");
+
+    std::mt19937_64 rng(42);
+    rows_db.begin();
+    blocks_db.begin();
+    sqlite_statement* insert_row = rows_db.statement("INSERT INTO traffic_snapshots VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+    sqlite_statement* insert_block = blocks_db.statement("INSERT INTO traffic_blocks VALUES (?, ?, ?, ?, ?)");
+    for (int i = 0; i < kLayoutInterfaces && insert_row != nullptr && insert_block != nullptr; ++i)
+    {
+        traffic_point point;
+        point.timestamp_ms = 1700000000000LL - 1000;
+        point.bytes_received = 48000000000ULL;
+        point.bytes_sent = 9000000000ULL;
+        point.rx_packets = 52000000;
+        point.tx_packets = 31000000;
+        traffic_block block;
+        qint64 block_start = traffic_block::block_start(1700000000000LL);
+        auto write_block = [&]()
+        {
+            const std::string data = block.encode();
+            insert_block->bind_int64(1, i);
+            insert_block->bind_int64(2, block_start);
+            insert_block->bind_int64(3, block.size());
+            insert_block->bind_int64(4, block.last_timestamp_ms());
+            insert_block->bind_blob(5, data.data(), static_cast<int>(data.size()));
+            insert_block->execute();
+        };
+        for (qint64 s = 0; s < kLayoutSamples; ++s)
+        {
+            point = next_sample(point, i == 0, rng);
+            insert_row->bind_int64(1, i);
+            insert_row->bind_int64(2, point.timestamp_ms);
+            const quint64 counters[] = {point.bytes_received,
+                                        point.bytes_sent,
+                                        point.rx_packets,
+                                        point.tx_packets,
+                                        point.rx_errors,
+                                        point.tx_errors,
+                                        point.rx_dropped,
+                                        point.tx_dropped,
+                                        point.rx_fifo_errors,
+                                        point.tx_fifo_errors,
+                                        point.multicast};
+            int column = 3;
+            for (quint64 counter : counters)
+            {
+                insert_row->bind_int64(column++, static_cast<qint64>(counter));
+            }
+            insert_row->execute();
+
+            if (traffic_block::block_start(point.timestamp_ms) != block_start)
+            {
+                write_block();
+                block = traffic_block();
+                block_start = traffic_block::block_start(point.timestamp_ms);
+            }
+            block.append(point);
+        }
+        write_block();
+    }
+    rows_db.commit();
+    blocks_db.commit();
+    const qint64 rows_bytes = file_bytes(rows_db);
+    const qint64 blocks_bytes = file_bytes(blocks_db);
+
+    qint64 read_rows = 0;
+    QElapsedTimer timer;
+    timer.start();
+    sqlite_statement* range = rows_db.statement(
+        "SELECT timestamp, bytes_received, bytes_sent, rx_packets, tx_packets, rx_errors, tx_errors, rx_dropped, tx_dropped, "
+        "rx_fifo_errors, tx_fifo_errors, multicast FROM traffic_snapshots "
+        "WHERE interface_id = ?1 AND timestamp BETWEEN ?2 AND ?3 ORDER BY timestamp ASC");
+    for (int n = 0; n < kRangeReads && range != nullptr; ++n)
+    {
+        const qint64 start = 1700000000000LL + ((n * 7919LL) % kLayoutSamples) * 1000;
+        range->bind_int64(1, n % kLayoutInterfaces);
+        range->bind_int64(2, start);
+        range->bind_int64(3, start + kRangeSpanMs);
+        QList<traffic_point> points;
+        while (range->step() == sqlite_statement::step_result::kRow)
+        {
+            traffic_point point;
+            point.timestamp_ms = range->column_int64(0);
+            point.bytes_received = static_cast<quint64>(range->column_int64(1));
+            point.bytes_sent = static_cast<quint64>(range->column_int64(2));
+            point.multicast = static_cast<quint64>(range->column_int64(11));
+            points.append(point);
+        }
+        read_rows += points.size();
+        range->reset();
+    }
+    std::printf("%-9s %7.1f MB on disk ", "rows", static_cast<double>(rows_bytes) / (1024.0 * 1024.0));
+    report("", "range read", read_rows, timer.nsecsElapsed());
+
+    read_rows = 0;
+    timer.restart();
+    sqlite_statement* blocks = blocks_db.statement(
+        "SELECT data FROM traffic_blocks WHERE interface_id = ?1 AND block_start > ?2 AND block_start <= ?3 ORDER BY block_start");
+    for (int n = 0; n < kRangeReads && blocks != nullptr; ++n)
+    {
+        const qint64 start = 1700000000000LL + ((n * 7919LL) % kLayoutSamples) * 1000;
+        blocks->bind_int64(1, n % kLayoutInterfaces);
+        blocks->bind_int64(2, start - traffic_block::kBlockMs);
+        blocks->bind_int64(3, start + kRangeSpanMs);
+        QList<traffic_point> points;
+        while (blocks->step() == sqlite_statement::step_result::kRow)
+        {
+            traffic_block::decode(blocks->column_blob(0), start, start + kRangeSpanMs, points);
+        }
+        read_rows += points.size();
+        blocks->reset();
+    }
+    std::printf("%-9s %7.1f MB on disk ", "blocks", static_cast<double>(blocks_bytes) / (1024.0 * 1024.0));
+    report("", "range read", read_rows, timer.nsecsElapsed());
+    if (blocks_bytes > 0)
+    {
+        std::printf("blocks are %.1fx smaller than rows\n", static_cast<double>(rows_bytes) / static_cast<double>(blocks_bytes));
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTemporaryDir dir;
+    if (!dir.isValid())
+    {
+        return 1;
+    }
+    const QList<row> rows = make_rows();
+    bench_qtsql(dir.filePath("qtsql.db"), rows);
+    bench_sqlite_store(dir.filePath("sqlite_store.db"), rows);
+    for (const auto& table_layout : kLayouts)
+    {
+        bench_layout(dir.filePath(QString("%1.db").arg(table_layout.name)), table_layout);
+    }
+    bench_blocks(dir.filePath("rows.db"), dir.filePath("blocks.db"));
+    return 0;
+}
@@ -1,23 +1,61 @@
+#include <cstdlib>
+#include <cstring>
 #include <QThread>
+#include <QElapsedTimer>
 #include "log.h"
 #include "data_collector.h"
 
-data_collector::data_collector(QObject* parent) : QObject(parent) {}
+static constexpr qint64 kCollectorReportIntervalMs = 60000;
+static constexpr int kHighFrequencyThresholdMs = 1000;
+static constexpr int kMinCollectionIntervalMs = 10;
+
+data_collector::data_collector(QObject* parent) : QObject(parent), network_info_(backend_from_env()) {}
+
+network_info::backend data_collector::backend_from_env()
+{
+    const char* backend = getenv("NET_STATS_BACKEND");
+    if (backend != nullptr && strcmp(backend, "sysfs") == 0)
+    {
+        return network_info::backend::kSysfs;
+    }
+    if (backend != nullptr && strcmp(backend, "procfs") == 0)
+    {
+        return network_info::backend::kProcNetDev;
+    }
+    return network_info::backend::kNetlink;
+}
 
 void data_collector::start_collection(int interval_ms)
 {
+    interval_ms = qMax(interval_ms, kMinCollectionIntervalMs);
     if (collection_timer_ == nullptr)
     {
         LOG_INFO("creating collector timer in thread {}", QThread::currentThreadId());
         collection_timer_ = new QTimer(this);
+        collection_timer_->setTimerType(Qt::PreciseTimer);
         connect(collection_timer_, &QTimer::timeout, this, &data_collector::collect_and_emit_stats);
+        ticker_ = new monotonic_ticker(this);
+        connect(ticker_, &monotonic_ticker::tick, this, &data_collector::handle_ticker_tick);
+        start_link_monitor();
+        report_timer_.start();
     }
 
-    LOG_INFO("data collector starting with interval {}ms in thread {}", interval_ms, QThread::currentThreadId());
-    if (!collection_timer_->isActive())
+    LOG_INFO("data collector starting with interval {}ms backend {} in thread {}",
+             interval_ms,
+             network_info::backend_name(network_info_.active_backend()),
+             QThread::currentThreadId());
+    if (collection_timer_->isActive() || ticker_->is_active())
     {
-        collection_timer_->start(interval_ms);
+        return;
     }
+
+    // sub-second sampling runs on a timerfd so ticks stay on a fixed monotonic grid
+    if (interval_ms < kHighFrequencyThresholdMs && ticker_->start(interval_ms))
+    {
+        LOG_INFO("high frequency sampling enabled at {}ms", interval_ms);
+        return;
+    }
+    collection_timer_->start(interval_ms);
 }
 
 void data_collector::stop_collection()
@@ -27,11 +65,169 @@ void data_collector::stop_collection()
     {
         collection_timer_->stop();
     }
+    if (ticker_ != nullptr)
+    {
+        ticker_->stop();
+    }
+}
+
+void data_collector::handle_ticker_tick(quint64 missed_ticks, qint64 actual_interval_ns)
+{
+    missed_ticks_ += missed_ticks;
+    if (actual_interval_ns > 0)
+    {
+        interval_total_ns_ += actual_interval_ns;
+        interval_max_ns_ = qMax(interval_max_ns_, actual_interval_ns);
+        interval_samples_++;
+    }
+    collect_and_emit_stats();
+}
+
+void data_collector::report_collection_stats()
+{
+    if (tick_cost_samples_ > 0)
+    {
+        LOG_DEBUG("network stats backend {} average tick cost {}us over {} ticks",
+                  network_info::backend_name(network_info_.active_backend()),
+                  tick_cost_total_ns_ / tick_cost_samples_ / 1000,
+                  tick_cost_samples_);
+    }
+    if (interval_samples_ > 0)
+    {
+        LOG_DEBUG("sampling interval average {}us max {}us missed ticks {}",
+                  interval_total_ns_ / interval_samples_ / 1000,
+                  interval_max_ns_ / 1000,
+                  missed_ticks_);
+    }
+    tick_cost_total_ns_ = 0;
+    tick_cost_samples_ = 0;
+    interval_total_ns_ = 0;
+    interval_max_ns_ = 0;
+    interval_samples_ = 0;
+    missed_ticks_ = 0;
+}
+
+void data_collector::start_link_monitor()
+{
+    // subscribe before the initial dump so no change between the two is missed
+    if (!link_monitor_.open() || !link_reader_.open() || !resync_interfaces())
+    {
+        LOG_WARN("link notifications unavailable interfaces will be detected from collected stats");
+        link_monitor_.close();
+        link_reader_.close();
+        return;
+    }
+
+    link_notifier_ = new QSocketNotifier(link_monitor_.fd(), QSocketNotifier::Read, this);
+    connect(link_notifier_, &QSocketNotifier::activated, this, &data_collector::handle_link_notifications);
+    link_monitor_active_ = true;
+}
+
+bool data_collector::resync_interfaces()
+{
+    if (!link_reader_.dump_links(link_dump_))
+    {
+        return false;
+    }
+    QList<interface_change> changes;
+    interface_registry_.sync(link_dump_, changes);
+    network_info_.set_running_interfaces(interface_registry_.tracked_names());
+    emit_interface_changes(changes);
+    return true;
+}
+
+void data_collector::handle_link_notifications()
+{
+    auto result = link_monitor_.read_events(link_events_);
+
+    QList<interface_change> changes;
+    for (const auto& event : link_events_)
+    {
+        interface_registry_.apply(event, changes);
+    }
+    // an operstate change flips tracked and shows up as an add or remove, so the set only moves with changes
+    if (!changes.isEmpty())
+    {
+        network_info_.set_running_interfaces(interface_registry_.tracked_names());
+    }
+    emit_interface_changes(changes);
+
+    if (result == netlink_link_monitor::read_result::kOverrun && !resync_interfaces())
+    {
+        LOG_ERROR("interface resync after notification overrun failed");
+    }
+    else if (result == netlink_link_monitor::read_result::kError)
+    {
+        LOG_ERROR("link notification socket failed falling back to stats based detection");
+        link_notifier_->setEnabled(false);
+        link_notifier_->deleteLater();
+        link_notifier_ = nullptr;
+        link_monitor_.close();
+        link_monitor_active_ = false;
+        polled_interfaces_ = interface_registry_.tracked_names();
+        network_info_.clear_running_interfaces();
+    }
+}
+
+void data_collector::emit_interface_changes(const QList<interface_change>& changes)
+{
+    for (const auto& change : changes)
+    {
+        switch (change.type)
+        {
+            case interface_change::kind::kAdded:
+                emit interface_added(change.name);
+                break;
+            case interface_change::kind::kRemoved:
+                emit interface_removed(change.name);
+                break;
+            case interface_change::kind::kRenamed:
+                emit interface_renamed(change.previous_name, change.name);
+                break;
+        }
+    }
+}
+
+void data_collector::detect_interfaces_from_stats(const QList<interface_stats>& stats)
+{
+    QStringList current;
+    current.reserve(stats.size());
+    for (const auto& stat : stats)
+    {
+        current.append(stat.name);
+        if (!polled_interfaces_.contains(stat.name))
+        {
+            emit interface_added(stat.name);
+        }
+    }
+    for (const auto& name : polled_interfaces_)
+    {
+        if (!current.contains(name))
+        {
+            emit interface_removed(name);
+        }
+    }
+    polled_interfaces_.swap(current);
 }
 
 void data_collector::collect_and_emit_stats()
 {
     LOG_TRACE("collecting network stats");
-    QList<interface_stats> stats = network_info::get_all_stats();
-    emit stats_collected(stats, QDateTime::currentDateTime());
+    const qint64 read_start_ns = sample_clock::monotonic_ns();
+    QList<interface_stats> stats = network_info_.get_all_stats();
+    // stamp once per tick right after the counters were read
+    const sample_time timestamp = sample_clock::now();
+    tick_cost_total_ns_ += timestamp.monotonic_ns - read_start_ns;
+    tick_cost_samples_++;
+    if (report_timer_.elapsed() >= kCollectorReportIntervalMs)
+    {
+        report_collection_stats();
+        report_timer_.restart();
+    }
+
+    if (!link_monitor_active_)
+    {
+        detect_interfaces_from_stats(stats);
+    }
+    emit stats_collected(stats, timestamp);
 }
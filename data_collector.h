@@ -1,10 +1,14 @@
 #ifndef DATA_COLLECTOR_H
 #define DATA_COLLECTOR_H
 
+#include <vector>
 #include <QObject>
 #include <QTimer>
-#include <QDateTime>
+#include <QElapsedTimer>
+#include <QSocketNotifier>
 #include "network_info.h"
+#include "monotonic_ticker.h"
+#include "interface_registry.h"
 
 class data_collector : public QObject
 {
@@ -19,12 +23,45 @@ class data_collector : public QObject
 
    private slots:
     void collect_and_emit_stats();
+    void handle_ticker_tick(quint64 missed_ticks, qint64 actual_interval_ns);
+    void handle_link_notifications();
 
    signals:
-    void stats_collected(const QList<interface_stats>& stats, const QDateTime& timestamp);
+    void stats_collected(const QList<interface_stats>& stats, const sample_time& timestamp);
+    void interface_added(const QString& name);
+    void interface_removed(const QString& name);
+    void interface_renamed(const QString& old_name, const QString& new_name);
+
+   private:
+    static network_info::backend backend_from_env();
+    void start_link_monitor();
+    bool resync_interfaces();
+    void detect_interfaces_from_stats(const QList<interface_stats>& stats);
+    void emit_interface_changes(const QList<interface_change>& changes);
+
+   private:
+    void report_collection_stats();
 
    private:
     QTimer* collection_timer_ = nullptr;
+    monotonic_ticker* ticker_ = nullptr;
+    network_info network_info_;
+    QElapsedTimer report_timer_;
+    qint64 tick_cost_total_ns_ = 0;
+    qint64 tick_cost_samples_ = 0;
+    qint64 interval_total_ns_ = 0;
+    qint64 interval_max_ns_ = 0;
+    qint64 interval_samples_ = 0;
+    quint64 missed_ticks_ = 0;
+
+    netlink_link_monitor link_monitor_;
+    netlink_link_reader link_reader_;
+    QSocketNotifier* link_notifier_ = nullptr;
+    interface_registry interface_registry_;
+    std::vector<link_event> link_events_;
+    std::vector<link_info> link_dump_;
+    QStringList polled_interfaces_;
+    bool link_monitor_active_ = false;
 };
 
 #endif
@@ -1,21 +1,273 @@
+#include <algorithm>
 #include <cstdlib>
+#include <limits>
+#include <map>
+#include <tuple>
 #include <QThread>
-#include <QVariant>
-#include <QVariantList>
-#include <QtSql/QSqlQuery>
-#include <QtSql/QSqlError>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QDir>
+#include <QFileInfo>
+#include <QMap>
 
 #include "log.h"
+#include "scoped_exit.h"
 #include "database_manager.h"
 
-static QString connection_name() { return QString("db_connection_%1").arg(reinterpret_cast<quintptr>(QThread::currentThreadId())); }
+static traffic_point to_traffic_point(const interface_stats& stats)
+{
+    traffic_point point;
+    point.timestamp_ms = stats.timestamp.realtime_ms;
+    point.bytes_received = stats.bytes_received;
+    point.bytes_sent = stats.bytes_sent;
+    point.rx_packets = stats.rx_packets;
+    point.tx_packets = stats.tx_packets;
+    point.rx_errors = stats.rx_errors;
+    point.tx_errors = stats.tx_errors;
+    point.rx_dropped = stats.rx_dropped;
+    point.tx_dropped = stats.tx_dropped;
+    point.rx_fifo_errors = stats.rx_fifo_errors;
+    point.tx_fifo_errors = stats.tx_fifo_errors;
+    point.multicast = stats.multicast;
+    return point;
+}
+
+// writes each row into the partition of its day, one transaction per partition touched
+template <typename Row, typename Bind>
+static bool write_partitioned(partition_store& partitions, partition_kind kind, const std::string& sql, const QList<Row>& rows, Bind&& bind)
+{
+    sqlite_database* part = nullptr;
+    sqlite_statement* insert = nullptr;
+    for (const auto& row : rows)
+    {
+        sqlite_database* target = partitions.partition(kind, row.timestamp.realtime_ms, true);
+        if (target != part)
+        {
+            // a batch crossing midnight commits the earlier day before the next one begins
+            if (part != nullptr && !part->commit())
+            {
+                LOG_ERROR("partition commit failed {}", part->last_error());
+                return false;
+            }
+            part = target;
+            insert = part != nullptr ? part->statement(sql) : nullptr;
+            if (insert == nullptr || !part->begin())
+            {
+                LOG_ERROR("no writable partition for timestamp {}", row.timestamp.realtime_ms);
+                return false;
+            }
+        }
+        if (!bind(row, *insert))
+        {
+            insert->reset();
+            continue;
+        }
+        if (!insert->execute())
+        {
+            LOG_ERROR("partition insert failed {}", part->last_error());
+            if (!part->rollback())
+            {
+                LOG_ERROR("partition rollback failed {}", part->last_error());
+            }
+            return false;
+        }
+    }
+    if (part != nullptr && !part->commit())
+    {
+        LOG_ERROR("partition commit failed {}", part->last_error());
+        return false;
+    }
+    return true;
+}
+
+// one dns_buckets increment, timestamp holds the bucket start
+struct dns_bucket_delta
+{
+    sample_time timestamp;
+    dns_query_info::packet_direction direction = dns_query_info::packet_direction::kRequest;
+    QString query_type;
+    QString response_code;
+    qint64 count = 0;
+};
+
+static QList<dns_bucket_delta> aggregate_dns_buckets(const QList<dns_query_info>& logs)
+{
+    std::map<std::tuple<qint64, dns_query_info::packet_direction, QString, QString>, qint64> counts;
+    for (const auto& info : logs)
+    {
+        const qint64 bucket_start = info.timestamp.realtime_ms - info.timestamp.realtime_ms % partition_store::kDnsBucketMs;
+        counts[std::make_tuple(bucket_start, info.direction, info.query_type, info.response_code)]++;
+    }
+    QList<dns_bucket_delta> deltas;
+    deltas.reserve(static_cast<qsizetype>(counts.size()));
+    for (const auto& [key, count] : counts)
+    {
+        dns_bucket_delta delta;
+        delta.timestamp.realtime_ms = std::get<0>(key);
+        delta.direction = std::get<1>(key);
+        delta.query_type = std::get<2>(key);
+        delta.response_code = std::get<3>(key);
+        delta.count = count;
+        deltas.append(delta);
+    }
+    return deltas;
+}
+
+static void bind_dns_log(const dns_query_info& info, sqlite_statement& insert)
+{
+    insert.bind_int64(1, info.timestamp.realtime_ms);
+    insert.bind_int64(2, info.transaction_id);
+    insert.bind_int64(3, static_cast<qint64>(info.direction));
+    insert.bind_text(4, info.query_domain);
+    insert.bind_text(5, info.query_type);
+    insert.bind_text(6, info.response_code);
+    insert.bind_text(7, info.response_data.join(", "));
+    insert.bind_text(8, info.resolver_ip);
+}
+
+static void bind_dns_bucket(const dns_bucket_delta& delta, sqlite_statement& upsert)
+{
+    upsert.bind_int64(1, delta.timestamp.realtime_ms);
+    upsert.bind_int64(2, static_cast<qint64>(delta.direction));
+    upsert.bind_text(3, delta.query_type);
+    upsert.bind_text(4, delta.response_code);
+    upsert.bind_int64(5, delta.count);
+}
+
+static constexpr qsizetype kSnapshotBatchRows = 512;
+static constexpr int kSnapshotFlushIntervalMs = 1000;
+static constexpr qsizetype kDnsFlushRows = 2048;
+static constexpr int kDnsFlushIntervalMs = 500;
+static constexpr qint64 kDnsWriterReportIntervalMs = 60000;
+// flushes a failed dns batch is retried on before its rows are counted as dropped
+static constexpr int kDnsWriteRetries = 3;
+// comfortably more than the three minute window the dns page refreshes
+static constexpr qint64 kDnsRecentSpanMs = 10 * 60 * 1000;
+static constexpr qsizetype kDnsRecentMaxEvents = 512 * 1024;
+static constexpr qint64 kLegacyMigrationChunkMs = kMillisPerHour;
+static constexpr int kLegacyMigrationTickMs = 50;
+static constexpr qint64 kRollupBackfillChunkMs = kMillisPerHour;
+static constexpr int kRollupBackfillTickMs = 50;
+static constexpr qint64 kRetentionSliceMs = 10LL * 60 * 1000;
+static constexpr qint64 kRetentionBudgetMs = 20;
+static constexpr int kRetentionBusyTickMs = 200;
+static constexpr int kRetentionIdleTickMs = 60 * 1000;
+// open traffic blocks are rewritten this often so a crash loses at most this much of the current hour
+static constexpr qint64 kBlockCheckpointMs = 60 * 1000;
+static constexpr int kReaderThreads = 2;
+// per interface, about 3.5 MB of counters once an interface has been up for the whole span
+static constexpr qint64 kMaxHotTierSamples = 64 * 1024;
+static constexpr qint64 kQueryReportIntervalMs = 60 * 1000;
+// wal files are truncated back to zero this often when no reader holds them
+static constexpr qint64 kWalCheckpointIntervalMs = 10 * 1000;
+// each tick hands at most this many free pages back to the filesystem
+static constexpr const char* kIncrementalVacuumSql = "PRAGMA incremental_vacuum(256)";
+// VACUUM copies every live page while the writer waits, about a second per 100 MB on a desktop disk, larger
+// files keep their mode and reuse freed pages instead of returning them
+static constexpr qint64 kMaxVacuumConversionBytes = 64LL * 1024 * 1024;
+
+static const std::string kInsertSnapshotSql =
+    "INSERT OR REPLACE INTO traffic_snapshots (interface_id, " TRAFFIC_POINT_COLUMNS ") "
+    "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+// each interface answers from the front of its own key range instead of a scan over every row
+static const std::string kOldestSnapshotSql =
+    "SELECT MIN(t) FROM (SELECT (SELECT timestamp FROM traffic_snapshots WHERE interface_id = i.id AND timestamp >= ?1 "
+    "ORDER BY timestamp LIMIT 1) AS t FROM interfaces i)";
+static const std::string kUpsertBlockSql =
+    "INSERT OR REPLACE INTO traffic_blocks (interface_id, block_start, samples, last_timestamp, data) VALUES (?1, ?2, ?3, ?4, ?5)";
+static const std::string kUpsertDnsBucketSql =
+    "INSERT INTO dns_buckets (bucket_start, direction, query_type, response_code, count) VALUES (?1, ?2, IFNULL(?3, ''), IFNULL(?4, ''), ?5) "
+    "ON CONFLICT (bucket_start, direction, query_type, response_code) DO UPDATE SET count = count + excluded.count";
+static const std::string kInsertDnsLogSql =
+    "INSERT INTO dns_logs (timestamp, transaction_id, direction, query_domain, query_type, response_code, response_data, resolver_ip) "
+    "VALUES (?, ?, ?, ?, ?, ?, ?, ?)";
+
+// a day of rows and the bucket increments they add commit in one transaction, so dns_buckets never counts rows
+// that were rolled back and never misses rows that made it to disk
+static bool write_dns_partition(sqlite_database& part, const QList<dns_query_info>& logs)
+{
+    sqlite_statement* insert = part.statement(kInsertDnsLogSql);
+    sqlite_statement* upsert = part.statement(kUpsertDnsBucketSql);
+    if (insert == nullptr || upsert == nullptr || !part.begin())
+    {
+        LOG_ERROR("no writable dns partition {}", part.last_error());
+        return false;
+    }
+    bool written = true;
+    for (qsizetype i = 0; written && i < logs.size(); ++i)
+    {
+        bind_dns_log(logs[i], *insert);
+        written = insert->execute();
+    }
+    // a batch touches a handful of buckets, so this costs a few upserts instead of a row each
+    const QList<dns_bucket_delta> deltas = written ? aggregate_dns_buckets(logs) : QList<dns_bucket_delta>();
+    for (qsizetype i = 0; written && i < deltas.size(); ++i)
+    {
+        bind_dns_bucket(deltas[i], *upsert);
+        written = upsert->execute();
+    }
+    if (!written)
+    {
+        LOG_ERROR("dns partition write failed {}", part.last_error());
+        if (!part.rollback())
+        {
+            LOG_ERROR("partition rollback failed {}", part.last_error());
+        }
+        return false;
+    }
+    if (!part.commit())
+    {
+        LOG_ERROR("partition commit failed {}", part.last_error());
+        return false;
+    }
+    return true;
+}
+
+// splits the batch into runs of rows that land in the same day partition, returns how many rows from the
+// front of logs were committed before a run failed
+static qsizetype write_dns_logs(partition_store& partitions, const QList<dns_query_info>& logs)
+{
+    qsizetype start = 0;
+    while (start < logs.size())
+    {
+        sqlite_database* part = partitions.partition(partition_kind::kDns, logs[start].timestamp.realtime_ms, true);
+        if (part == nullptr)
+        {
+            LOG_ERROR("no writable partition for timestamp {}", logs[start].timestamp.realtime_ms);
+            return start;
+        }
+        qsizetype end = start + 1;
+        while (end < logs.size() && partitions.partition(partition_kind::kDns, logs[end].timestamp.realtime_ms, true) == part)
+        {
+            ++end;
+        }
+        if (!write_dns_partition(*part, logs.mid(start, end - start)))
+        {
+            return start;
+        }
+        start = end;
+    }
+    return start;
+}
 
 database_manager::database_manager(QString db_path, QObject* parent) : QObject(parent), db_path_(std::move(db_path)) {}
 
 database_manager::~database_manager()
 {
-    if (db_.isOpen())
+    // readers hold snapshots of the files, they finish their current query before the writer closes
+    for (QThread* thread : reader_threads_)
     {
+        thread->quit();
+        thread->wait();
+    }
+    readers_.clear();
+    if (db_.is_open())
+    {
+        flush_snapshots();
+        checkpoint_open_blocks();
+        drain_dns_events();
+        flush_dns_logs();
+        partitions_.close();
         db_.close();
     }
     LOG_INFO("database manager destroyed");
@@ -24,56 +276,244 @@ database_manager::~database_manager()
 void database_manager::initialize()
 {
     LOG_INFO("initializing database manager in thread {}", QThread::currentThreadId());
-    db_ = QSqlDatabase::addDatabase("QSQLITE", connection_name());
-    db_.setDatabaseName(db_path_);
 
-    if (!open_database() || !create_tables())
+    const QFileInfo db_file(db_path_);
+    const QString partition_dir = db_file.dir().filePath(db_file.completeBaseName() + "_partitions");
+    if (!open_database() || !create_tables() || !partitions_.open(partition_dir))
     {
         LOG_ERROR("failed to initialize database aborting initialization");
+        db_.close();
+        emit initialization_failed();
+        return;
+    }
+
+    snapshot_flush_timer_ = new QTimer(this);
+    snapshot_flush_timer_->setSingleShot(true);
+    connect(snapshot_flush_timer_, &QTimer::timeout, this, &database_manager::flush_snapshots);
+
+    dns_flush_timer_ = new QTimer(this);
+    dns_flush_timer_->setSingleShot(true);
+    connect(dns_flush_timer_, &QTimer::timeout, this, &database_manager::flush_dns_logs);
+
+    legacy_migration_timer_ = new QTimer(this);
+    legacy_migration_timer_->setSingleShot(true);
+    connect(legacy_migration_timer_, &QTimer::timeout, this, &database_manager::migrate_legacy_chunk);
+    rollup_backfill_timer_ = new QTimer(this);
+    rollup_backfill_timer_->setSingleShot(true);
+    connect(rollup_backfill_timer_, &QTimer::timeout, this, &database_manager::backfill_rollup_chunk);
+
+    // backfill reads traffic_snapshots so it only starts once the legacy rows have moved in
+    if (legacy_migration_pending_)
+    {
+        legacy_migration_timer_->start(kLegacyMigrationTickMs);
+    }
+    else if (rollup_backfill_cursor_ < rollup_backfill_end_)
+    {
+        rollup_backfill_timer_->start(kRollupBackfillTickMs);
+    }
+
+    // today's partitions and writers are prepared up front so a bad schema fails here instead of on the first flush
+    const qint64 now_ms = sample_clock::realtime_ms();
+    sqlite_database* traffic_partition = partitions_.partition(partition_kind::kTraffic, now_ms, true);
+    sqlite_database* dns_partition = partitions_.partition(partition_kind::kDns, now_ms, true);
+    if (traffic_partition == nullptr || dns_partition == nullptr || traffic_partition->statement(kInsertSnapshotSql) == nullptr ||
+        dns_partition->statement(kInsertDnsLogSql) == nullptr || dns_partition->statement(kUpsertDnsBucketSql) == nullptr)
+    {
+        LOG_ERROR("prepare partition insert statements failed");
+        partitions_.close();
+        db_.close();
         emit initialization_failed();
         return;
     }
 
-    prune_old_data(30);
+    retention_timer_ = new QTimer(this);
+    retention_timer_->setSingleShot(true);
+    connect(retention_timer_, &QTimer::timeout, this, &database_manager::run_retention);
+    retention_timer_->start(kRetentionBusyTickMs);
+    wal_checkpoint_timer_.start();
+    query_report_timer_.start();
+
+    // history queries run on read only connections so a long range never stalls the inserts above
+    for (int i = 0; i < kReaderThreads; ++i)
+    {
+        auto* thread = new QThread(this);
+        auto* reader = new history_reader(db_path_, partition_dir, query_generations_);
+        reader->moveToThread(thread);
+        connect(thread, &QThread::finished, reader, &QObject::deleteLater);
+        connect(reader, &history_reader::snapshots_ready, this, &database_manager::snapshots_ready, Qt::DirectConnection);
+        connect(reader, &history_reader::qps_stats_ready, this, &database_manager::qps_stats_ready, Qt::DirectConnection);
+        connect(reader, &history_reader::all_domains_ready, this, &database_manager::all_domains_ready, Qt::DirectConnection);
+        connect(reader, &history_reader::dns_details_ready, this, &database_manager::dns_details_ready, Qt::DirectConnection);
+        connect(reader, &history_reader::dns_breakdown_ready, this, &database_manager::dns_breakdown_ready, Qt::DirectConnection);
+        thread->start();
+        reader_threads_.append(thread);
+        readers_.append(reader);
+    }
+
     LOG_INFO("database is ready.");
     emit database_ready();
+    // batches captured while the database was opening
+    drain_dns_events();
 }
 
 bool database_manager::open_database()
 {
-    if (!db_.open())
+    if (!db_.open(db_path_))
+    {
+        LOG_WARN("connection with database failed {}", db_.last_error());
+        return false;
+    }
+    if (!init_auto_vacuum())
     {
-        LOG_WARN("connection with database failed {}", db_.lastError().text().toStdString());
         return false;
     }
     db_.exec("PRAGMA journal_mode = WAL;");
     return true;
 }
 
+// a new file takes the mode directly, an existing one needs a full rewrite that waits for an idle retention tick
+bool database_manager::init_auto_vacuum()
+{
+    constexpr qint64 kAutoVacuumIncremental = 2;
+    auto mode = db_.prepare("SELECT m.auto_vacuum, p.page_count FROM pragma_auto_vacuum() m, pragma_page_count() p");
+    if (mode == nullptr || mode->step() != sqlite_statement::step_result::kRow)
+    {
+        return false;
+    }
+    const qint64 current_mode = mode->column_int64(0);
+    const qint64 page_count = mode->column_int64(1);
+    mode.reset();
+    if (current_mode == kAutoVacuumIncremental)
+    {
+        incremental_vacuum_ = true;
+        return true;
+    }
+    if (page_count == 0)
+    {
+        if (!db_.exec("PRAGMA auto_vacuum = INCREMENTAL"))
+        {
+            LOG_ERROR("enable incremental auto_vacuum failed {}", db_.last_error());
+            return false;
+        }
+        incremental_vacuum_ = true;
+        return true;
+    }
+    LOG_INFO("database uses auto_vacuum mode {}, switching to incremental once retention is idle", current_mode);
+    vacuum_conversion_pending_ = true;
+    return true;
+}
+
+void database_manager::convert_to_incremental_vacuum()
+{
+    vacuum_conversion_pending_ = false;
+    const qint64 live_bytes = used_bytes();
+    if (live_bytes > kMaxVacuumConversionBytes)
+    {
+        LOG_INFO("database holds {} bytes, over the {} byte rewrite limit, it keeps its auto_vacuum mode and reuses freed pages",
+                 live_bytes,
+                 kMaxVacuumConversionBytes);
+        return;
+    }
+    auto file_bytes = [this]()
+    {
+        auto pages = db_.prepare("SELECT p.page_count * s.page_size FROM pragma_page_count() p, pragma_page_size() s");
+        return pages != nullptr && pages->step() == sqlite_statement::step_result::kRow ? pages->column_int64(0) : 0;
+    };
+    const qint64 bytes_before = file_bytes();
+    const quint64 dropped_before = dns_event_queue_ != nullptr ? dns_event_queue_->dropped_events() : 0;
+    LOG_INFO("rewriting {} bytes for incremental auto_vacuum, snapshot and dns writes wait until it finishes", live_bytes);
+    QElapsedTimer vacuum_timer;
+    vacuum_timer.start();
+    if (!db_.exec("PRAGMA auto_vacuum = INCREMENTAL") || !db_.exec("VACUUM"))
+    {
+        LOG_ERROR("enable incremental auto_vacuum failed {}", db_.last_error());
+        return;
+    }
+    incremental_vacuum_ = true;
+    const quint64 dropped_after = dns_event_queue_ != nullptr ? dns_event_queue_->dropped_events() : 0;
+    LOG_INFO("database rewritten for incremental auto_vacuum in {} ms, {} bytes before and {} after, {} dns events dropped meanwhile",
+             vacuum_timer.elapsed(),
+             bytes_before,
+             file_bytes(),
+             dropped_after - dropped_before);
+}
+
 bool database_manager::create_tables()
 {
-    QSqlQuery query(db_);
-    bool success = query.exec(
+    if (table_columns("traffic_snapshots").contains("interface_name"))
+    {
+        if (!begin_legacy_migration())
+        {
+            return false;
+        }
+    }
+    else if (!table_columns("traffic_snapshots_legacy").isEmpty())
+    {
+        // a migration interrupted by shutdown resumes where it stopped
+        legacy_migration_pending_ = true;
+        legacy_bytes_before_ = used_bytes();
+    }
+
+    bool success = db_.exec(
+        "CREATE TABLE IF NOT EXISTS interfaces ("
+        "id INTEGER PRIMARY KEY, "
+        "name TEXT NOT NULL UNIQUE"
+        ")");
+    if (!success)
+    {
+        LOG_ERROR("create table interfaces failed {}", db_.last_error());
+        return false;
+    }
+
+    // clustered on (interface_id, timestamp) so one interface's range is a contiguous btree scan
+    success = db_.exec(
         "CREATE TABLE IF NOT EXISTS traffic_snapshots ("
+        "interface_id INTEGER NOT NULL, "
         "timestamp INTEGER NOT NULL, "
-        "interface_name TEXT NOT NULL, "
         "bytes_received INTEGER NOT NULL, "
         "bytes_sent INTEGER NOT NULL, "
-        "PRIMARY KEY (timestamp, interface_name)"
-        ")");
+        "rx_packets INTEGER NOT NULL DEFAULT 0, "
+        "tx_packets INTEGER NOT NULL DEFAULT 0, "
+        "rx_errors INTEGER NOT NULL DEFAULT 0, "
+        "tx_errors INTEGER NOT NULL DEFAULT 0, "
+        "rx_dropped INTEGER NOT NULL DEFAULT 0, "
+        "tx_dropped INTEGER NOT NULL DEFAULT 0, "
+        "rx_fifo_errors INTEGER NOT NULL DEFAULT 0, "
+        "tx_fifo_errors INTEGER NOT NULL DEFAULT 0, "
+        "multicast INTEGER NOT NULL DEFAULT 0, "
+        "PRIMARY KEY (interface_id, timestamp)"
+        ") WITHOUT ROWID");
     if (!success)
     {
-        LOG_ERROR("create table traffic_snapshots failed {}", query.lastError().text().toStdString());
+        LOG_ERROR("create table traffic_snapshots failed {}", db_.last_error());
         return false;
     }
 
-    success = query.exec("CREATE INDEX IF NOT EXISTS idx_snapshot_time ON traffic_snapshots (timestamp)");
-    if (!success)
+    if (!db_.exec(traffic_rollup::create_table_sql()))
+    {
+        LOG_ERROR("create table traffic_rollups failed {}", db_.last_error());
+        return false;
+    }
+
+    if (!db_.exec("CREATE TABLE IF NOT EXISTS storage_meta (key TEXT PRIMARY KEY, value INTEGER NOT NULL) WITHOUT ROWID"))
+    {
+        LOG_ERROR("create table storage_meta failed {}", db_.last_error());
+        return false;
+    }
+
+    if (!init_rollup_backfill())
+    {
+        return false;
+    }
+
+    if (legacy_migration_pending_ &&
+        !db_.exec("INSERT OR IGNORE INTO interfaces (name) SELECT DISTINCT interface_name FROM traffic_snapshots_legacy"))
     {
-        LOG_ERROR("create index on timestamp failed {}", query.lastError().text().toStdString());
+        LOG_ERROR("collect legacy interface names failed {}", db_.last_error());
+        return false;
     }
 
-    success = query.exec(
+    success = db_.exec(
         "CREATE TABLE IF NOT EXISTS dns_logs ("
         "timestamp INTEGER NOT NULL, "
         "transaction_id INTEGER NOT NULL, "
@@ -86,312 +526,1080 @@ bool database_manager::create_tables()
         ")");
     if (!success)
     {
-        LOG_ERROR("create table dns_logs failed {}", query.lastError().text().toStdString());
+        LOG_ERROR("create table dns_logs failed {}", db_.last_error());
         return false;
     }
 
-    success = query.exec("CREATE INDEX IF NOT EXISTS idx_dns_log_time ON dns_logs (timestamp)");
+    success = db_.exec("CREATE INDEX IF NOT EXISTS idx_dns_log_time ON dns_logs (timestamp)");
     if (!success)
     {
-        LOG_ERROR("create index on dns_logs timestamp failed {}", query.lastError().text().toStdString());
+        LOG_ERROR("create index on dns_logs timestamp failed {}", db_.last_error());
     }
 
     return success;
 }
 
-void database_manager::add_snapshots(const QList<interface_stats>& stats_list, const QDateTime& timestamp)
+QStringList database_manager::table_columns(const QString& table)
 {
-    if (stats_list.isEmpty() || !db_.isOpen())
+    QStringList columns;
+    auto table_info = db_.prepare(QString("PRAGMA table_info(%1)").arg(table).toStdString());
+    if (table_info == nullptr)
     {
-        return;
+        return columns;
     }
-
-    if (!db_.transaction())
+    sqlite_statement::step_result result;
+    while ((result = table_info->step()) == sqlite_statement::step_result::kRow)
     {
-        LOG_ERROR("db failed to start transaction {}", db_.lastError().text().toStdString());
-        return;
+        columns.append(table_info->column_text(1));
     }
-
-    QSqlQuery query(db_);
-    query.prepare(
-        "INSERT OR REPLACE INTO traffic_snapshots (timestamp, interface_name, bytes_received, bytes_sent) "
-        "VALUES (?, ?, ?, ?)");
-
-    qint64 ts_msecs = timestamp.toMSecsSinceEpoch();
-
-    QVariantList timestamps;
-    QVariantList interface_names;
-    QVariantList bytes_received_list;
-    QVariantList bytes_sent_list;
-
-    timestamps.reserve(stats_list.size());
-    interface_names.reserve(stats_list.size());
-    bytes_received_list.reserve(stats_list.size());
-    bytes_sent_list.reserve(stats_list.size());
-
-    for (const auto& stats : stats_list)
+    if (result == sqlite_statement::step_result::kError)
     {
-        timestamps.append(ts_msecs);
-        interface_names.append(stats.name);
-        bytes_received_list.append(static_cast<qlonglong>(stats.bytes_received));
-        bytes_sent_list.append(static_cast<qlonglong>(stats.bytes_sent));
+        LOG_ERROR("read {} columns failed {}", table.toStdString(), db_.last_error());
     }
+    return columns;
+}
 
-    query.addBindValue(timestamps);
-    query.addBindValue(interface_names);
-    query.addBindValue(bytes_received_list);
-    query.addBindValue(bytes_sent_list);
+bool database_manager::migrate_traffic_counters()
+{
+    static const QStringList kCounterColumns = {
+        "rx_packets", "tx_packets", "rx_errors", "tx_errors", "rx_dropped", "tx_dropped", "rx_fifo_errors", "tx_fifo_errors", "multicast"};
 
-    if (!query.execBatch())
+    const QStringList existing_columns = table_columns("traffic_snapshots");
+    for (const QString& column : kCounterColumns)
     {
-        LOG_ERROR("db batch add snapshot failed {}", query.lastError().text().toStdString());
-        if (!db_.rollback())
+        if (existing_columns.contains(column))
         {
-            LOG_ERROR("db rollback failed after batch error {}", db_.lastError().text().toStdString());
+            continue;
+        }
+        LOG_INFO("adding column {} to traffic_snapshots", column.toStdString());
+        const QByteArray alter = QString("ALTER TABLE traffic_snapshots ADD COLUMN %1 INTEGER NOT NULL DEFAULT 0").arg(column).toUtf8();
+        if (!db_.exec(alter.constData()))
+        {
+            LOG_ERROR("add column {} to traffic_snapshots failed {}", column.toStdString(), db_.last_error());
+            return false;
         }
-        return;
     }
+    return true;
+}
 
-    if (!db_.commit())
+bool database_manager::begin_legacy_migration()
+{
+    // the old table keeps its timestamp index so chunks can be cut from the newest end cheaply
+    if (!migrate_traffic_counters())
+    {
+        return false;
+    }
+    if (!db_.exec("ALTER TABLE traffic_snapshots RENAME TO traffic_snapshots_legacy"))
     {
-        LOG_ERROR("db transaction commit failed {}", db_.lastError().text().toStdString());
+        LOG_ERROR("rename legacy traffic_snapshots failed {}", db_.last_error());
+        return false;
     }
+    legacy_migration_pending_ = true;
+    legacy_bytes_before_ = used_bytes();
+    LOG_INFO("migrating traffic_snapshots to the interface major layout, {} bytes in use", legacy_bytes_before_);
+    return true;
 }
-void database_manager::add_dns_log(const dns_query_info& info)
+
+void database_manager::migrate_legacy_chunk()
 {
-    if (!db_.isOpen())
+    if (!legacy_migration_pending_ || !db_.is_open())
     {
-        LOG_WARN("cannot add dns log database is not open");
         return;
     }
 
-    QSqlQuery query(db_);
-    query.prepare(
-        "INSERT INTO dns_logs (timestamp, transaction_id, direction, query_domain, query_type, response_code, response_data, resolver_ip) "
-        "VALUES (?, ?, ?, ?, ?, ?, ?, ?)");
+    // not cached, the legacy table is dropped at the end and must not leave statements behind
+    auto newest = db_.prepare("SELECT MAX(timestamp) FROM traffic_snapshots_legacy");
+    if (newest == nullptr)
+    {
+        return;
+    }
+    qint64 chunk_start = 0;
+    bool empty = true;
+    if (newest->step() == sqlite_statement::step_result::kRow && !newest->column_is_null(0))
+    {
+        chunk_start = newest->column_int64(0) - kLegacyMigrationChunkMs;
+        empty = false;
+    }
+    newest.reset();
 
-    query.bindValue(0, info.timestamp.toMSecsSinceEpoch());
-    query.bindValue(1, info.transaction_id);
-    query.bindValue(2, static_cast<int>(info.direction));
-    query.bindValue(3, info.query_domain);
-    query.bindValue(4, info.query_type);
-    query.bindValue(5, info.response_code);
-    query.bindValue(6, info.response_data.join(", "));
-    query.bindValue(7, info.resolver_ip);
+    if (empty)
+    {
+        if (!db_.exec("DROP TABLE traffic_snapshots_legacy"))
+        {
+            LOG_ERROR("drop legacy traffic_snapshots failed {}", db_.last_error());
+            return;
+        }
+        legacy_migration_pending_ = false;
+        LOG_INFO("traffic_snapshots migration finished, {} bytes in use before and {} after", legacy_bytes_before_, used_bytes());
+        if (rollup_backfill_cursor_ < rollup_backfill_end_)
+        {
+            rollup_backfill_timer_->start(kRollupBackfillTickMs);
+        }
+        return;
+    }
 
-    if (!query.exec())
+    auto copy = db_.prepare(
+        "INSERT OR IGNORE INTO traffic_snapshots (interface_id, " TRAFFIC_POINT_COLUMNS ") "
+        "SELECT i.id, l.timestamp, l.bytes_received, l.bytes_sent, l.rx_packets, l.tx_packets, l.rx_errors, l.tx_errors, "
+        "l.rx_dropped, l.tx_dropped, l.rx_fifo_errors, l.tx_fifo_errors, l.multicast "
+        "FROM traffic_snapshots_legacy l JOIN interfaces i ON i.name = l.interface_name WHERE l.timestamp > ?1");
+    auto remove = db_.prepare("DELETE FROM traffic_snapshots_legacy WHERE timestamp > ?1");
+    if (copy == nullptr || remove == nullptr || !db_.begin())
     {
-        LOG_ERROR("db add dns log failed for {} {}", info.query_domain.toStdString(), query.lastError().text().toStdString());
+        return;
     }
-    else
+    copy->bind_int64(1, chunk_start);
+    remove->bind_int64(1, chunk_start);
+    if (!copy->execute() || !remove->execute())
+    {
+        LOG_ERROR("migrate legacy traffic chunk failed {}", db_.last_error());
+        db_.rollback();
+        return;
+    }
+    if (!db_.commit())
     {
-        LOG_TRACE("successfully added dns log for {} to database", info.query_domain.toStdString());
+        LOG_ERROR("commit legacy traffic chunk failed {}", db_.last_error());
+        return;
     }
+    legacy_migration_timer_->start(kLegacyMigrationTickMs);
 }
 
-void database_manager::get_snapshots_in_range(quint64 request_id, const QString& interface_name, const QDateTime& start, const QDateTime& end)
+qint64 database_manager::interface_id(const QString& name)
 {
-    QList<traffic_point> results;
-    if (!db_.isOpen())
+    if (const qint64 id = stored_interface_id(name); id >= 0)
     {
-        emit snapshots_ready(request_id, interface_name, results);
-        return;
+        return id;
     }
-
-    QSqlQuery query(db_);
-    qint64 start_ts = start.toMSecsSinceEpoch();
-    qint64 end_ts = end.toMSecsSinceEpoch();
-
-    query.prepare(
-        "SELECT timestamp, bytes_received, bytes_sent FROM traffic_snapshots "
-        "WHERE interface_name = :name AND timestamp < :start_ts "
-        "ORDER BY timestamp DESC LIMIT 1");
-    query.bindValue(":name", interface_name);
-    query.bindValue(":start_ts", start_ts);
-
-    if (!query.exec())
+    sqlite_statement* insert = db_.statement("INSERT OR IGNORE INTO interfaces (name) VALUES (?1)");
+    if (insert == nullptr)
     {
-        LOG_ERROR("db get snapshots pre-range failed for {} {}", interface_name.toStdString(), query.lastError().text().toStdString());
+        return -1;
     }
-    else if (query.next())
+    insert->bind_text(1, name);
+    if (!insert->execute())
     {
-        results.append({query.value(0).toLongLong(), query.value(1).toULongLong(), query.value(2).toULongLong()});
+        return -1;
     }
+    return stored_interface_id(name);
+}
 
-    query.prepare(
-        "SELECT timestamp, bytes_received, bytes_sent FROM traffic_snapshots "
-        "WHERE interface_name = :name AND timestamp BETWEEN :start_ts AND :end_ts "
-        "ORDER BY timestamp ASC");
-    query.bindValue(":name", interface_name);
-    query.bindValue(":start_ts", start_ts);
-    query.bindValue(":end_ts", end_ts);
+qint64 database_manager::stored_interface_id(const QString& name)
+{
+    auto it = interface_ids_.constFind(name);
+    if (it != interface_ids_.constEnd())
+    {
+        return it.value();
+    }
 
-    if (!query.exec())
+    sqlite_statement* select = db_.statement("SELECT id FROM interfaces WHERE name = ?1");
+    if (select == nullptr)
     {
-        LOG_ERROR("db get snapshots in-range failed for {} {}", interface_name.toStdString(), query.lastError().text().toStdString());
+        return -1;
     }
-    else
+    DEFER(select->reset());
+    select->bind_text(1, name);
+    if (select->step() != sqlite_statement::step_result::kRow)
     {
-        while (query.next())
-        {
-            results.append({query.value(0).toLongLong(), query.value(1).toULongLong(), query.value(2).toULongLong()});
-        }
+        return -1;
     }
-    emit snapshots_ready(request_id, interface_name, results);
+    const qint64 id = select->column_int64(0);
+    interface_ids_.insert(name, id);
+    return id;
 }
 
-void database_manager::prune_old_data(int days_to_keep)
+qint64 database_manager::used_bytes()
 {
-    QDateTime cutoff = QDateTime::currentDateTime().addDays(-days_to_keep);
-    QSqlQuery query(db_);
+    auto page_stats = db_.prepare(
+        "SELECT (p.page_count - f.freelist_count) * s.page_size FROM pragma_page_count() p, pragma_freelist_count() f, pragma_page_size() s");
+    if (page_stats == nullptr || page_stats->step() != sqlite_statement::step_result::kRow)
+    {
+        return 0;
+    }
+    return page_stats->column_int64(0);
+}
 
-    query.prepare("DELETE FROM traffic_snapshots WHERE timestamp < ?");
-    query.bindValue(0, cutoff.toMSecsSinceEpoch());
-    if (!query.exec())
+qint64 database_manager::meta_value(const char* key, qint64 fallback)
+{
+    sqlite_statement* select = db_.statement("SELECT value FROM storage_meta WHERE key = ?1");
+    if (select == nullptr)
     {
-        LOG_ERROR("prune old traffic data failed {}", query.lastError().text().toStdString());
+        return fallback;
     }
-    else
+    DEFER(select->reset());
+    select->bind_text(1, std::string_view(key));
+    if (select->step() != sqlite_statement::step_result::kRow)
+    {
+        return fallback;
+    }
+    return select->column_int64(0);
+}
+
+bool database_manager::set_meta_value(const char* key, qint64 value)
+{
+    sqlite_statement* upsert = db_.statement("INSERT OR REPLACE INTO storage_meta (key, value) VALUES (?1, ?2)");
+    if (upsert == nullptr)
     {
-        LOG_INFO("pruned traffic data older than {} days", days_to_keep);
+        return false;
     }
+    upsert->bind_text(1, std::string_view(key));
+    upsert->bind_int64(2, value);
+    return upsert->execute();
+}
 
-    query.prepare("DELETE FROM dns_logs WHERE timestamp < ?");
-    query.bindValue(0, cutoff.toMSecsSinceEpoch());
-    if (!query.exec())
+bool database_manager::init_rollup_backfill()
+{
+    // the first start with rollups fixes the hand over point, raw rows before it have never been rolled up
+    rollup_backfill_end_ = meta_value("rollup_backfill_end", -1);
+    if (rollup_backfill_end_ < 0)
     {
-        LOG_ERROR("prune old dns data failed {}", query.lastError().text().toStdString());
+        rollup_backfill_end_ = sample_clock::realtime_ms();
+        rollup_backfill_cursor_ = rollup_backfill_end_ - retention_.traffic_max_age_ms.back();
+        if (!set_meta_value("rollup_backfill_end", rollup_backfill_end_) || !set_meta_value("rollup_backfill_cursor", rollup_backfill_cursor_))
+        {
+            LOG_ERROR("store rollup backfill range failed {}", db_.last_error());
+            return false;
+        }
     }
     else
     {
-        LOG_INFO("pruned dns data older than {} days", days_to_keep);
+        rollup_backfill_cursor_ = meta_value("rollup_backfill_cursor", rollup_backfill_end_);
+    }
+    if (rollup_backfill_cursor_ < rollup_backfill_end_)
+    {
+        LOG_INFO("traffic rollups will be backfilled from raw rows up to {}", rollup_backfill_end_);
     }
+    return true;
 }
 
-void database_manager::get_qps_stats(quint64 request_id, const QDateTime& start, const QDateTime& end, int interval_secs)
+void database_manager::backfill_rollup_chunk()
 {
-    LOG_DEBUG("processing get_qps_stats request id {}", request_id);
-    QList<QPointF> results;
-    if (!db_.isOpen() || interval_secs <= 0)
+    if (!db_.is_open() || rollup_backfill_cursor_ >= rollup_backfill_end_)
     {
-        LOG_WARN("cannot get qps stats db not open or interval invalid");
-        emit qps_stats_ready(request_id, results);
         return;
     }
 
-    qint64 interval_ms = interval_secs * 1000L;
-
-    QSqlQuery query(db_);
-    query.prepare(
-        "SELECT "
-        "  (timestamp / :interval_ms) * :interval_ms AS time_window, "
-        "  COUNT(*) "
-        "FROM dns_logs "
-        "WHERE timestamp BETWEEN :start_ts AND :end_ts AND direction = 0 "
-        "GROUP BY time_window "
-        "ORDER BY time_window");
-
-    query.bindValue(":interval_ms", interval_ms);
-    query.bindValue(":start_ts", start.toMSecsSinceEpoch());
-    query.bindValue(":end_ts", end.toMSecsSinceEpoch());
+    // jump over empty stretches
+    sqlite_statement* next = db_.statement(kOldestSnapshotSql);
+    if (next == nullptr)
+    {
+        return;
+    }
+    qint64 chunk_start = rollup_backfill_end_;
+    {
+        DEFER(next->reset());
+        next->bind_int64(1, rollup_backfill_cursor_);
+        if (next->step() == sqlite_statement::step_result::kRow && !next->column_is_null(0))
+        {
+            chunk_start = std::min(next->column_int64(0), rollup_backfill_end_);
+        }
+    }
+    const qint64 chunk_end = std::min(chunk_start - chunk_start % kRollupBackfillChunkMs + kRollupBackfillChunkMs, rollup_backfill_end_);
 
-    if (!query.exec())
+    sqlite_statement* rows = db_.statement(
+        "SELECT interface_id, " TRAFFIC_POINT_COLUMNS " FROM traffic_snapshots "
+        "WHERE interface_id IN (SELECT id FROM interfaces) AND timestamp >= ?1 AND timestamp < ?2 "
+        "ORDER BY interface_id, timestamp");
+    if (rows == nullptr || !db_.begin())
     {
-        LOG_ERROR("db get qps stats failed {}", query.lastError().text().toStdString());
+        return;
     }
-    else
     {
-        while (query.next())
+        DEFER(rows->reset());
+        rows->bind_int64(1, chunk_start);
+        rows->bind_int64(2, chunk_end);
+        while (rows->step() == sqlite_statement::step_result::kRow)
         {
-            qreal timestamp = static_cast<qreal>(query.value(0).toLongLong());
-            qreal count = query.value(1).toInt();
-            results.append(QPointF(timestamp, count));
+            backfill_rollup_.add(rows->column_int64(0), read_traffic_point(*rows, 1));
         }
     }
+    if (!backfill_rollup_.write(db_) || !set_meta_value("rollup_backfill_cursor", chunk_end))
+    {
+        LOG_ERROR("backfill traffic rollups failed {}", db_.last_error());
+        db_.rollback();
+        return;
+    }
+    if (!db_.commit())
+    {
+        LOG_ERROR("commit traffic rollup backfill failed {}", db_.last_error());
+        return;
+    }
+    rollup_backfill_cursor_ = chunk_end;
+    if (rollup_backfill_cursor_ >= rollup_backfill_end_)
+    {
+        LOG_INFO("traffic rollup backfill finished");
+        backfill_rollup_.clear();
+        return;
+    }
+    rollup_backfill_timer_->start(kRollupBackfillTickMs);
+}
 
-    LOG_DEBUG("qps stats query finished for id {} found {} data points", request_id, results.size());
-    emit qps_stats_ready(request_id, results);
+void database_manager::set_hot_tier(qint64 span_ms, int sample_interval_ms)
+{
+    sample_interval_ms_ = std::max(sample_interval_ms, 1);
+    // high sampling rates would need hundreds of megabytes for long spans, the ring then covers less time
+    const qint64 samples = span_ms / std::max(sample_interval_ms, 1) + 1;
+    hot_tier_capacity_ = span_ms > 0 ? static_cast<qsizetype>(std::min(samples, kMaxHotTierSamples)) : 0;
+    LOG_INFO("hot tier keeps {} samples per interface", hot_tier_capacity_);
 }
 
-void database_manager::get_all_domains(quint64 request_id, const QDateTime& start, const QDateTime& end)
+void database_manager::add_snapshots(const QList<interface_stats>& stats_list, const sample_time& timestamp)
 {
-    LOG_DEBUG("all domains request id {}", request_id);
-    QStringList results;
-    if (!db_.isOpen())
+    if (stats_list.isEmpty() || !db_.is_open())
     {
-        LOG_WARN("cannot get all domains db not open");
-        emit all_domains_ready(request_id, results);
         return;
     }
 
-    QSqlQuery query(db_);
-    query.prepare(
-        "SELECT DISTINCT query_domain "
-        "FROM dns_logs "
-        "WHERE timestamp BETWEEN :start_ts AND :end_ts "
-        "ORDER BY query_domain ASC");
-
-    query.bindValue(":start_ts", start.toMSecsSinceEpoch());
-    query.bindValue(":end_ts", end.toMSecsSinceEpoch());
-
-    if (!query.exec())
+    for (const auto& stats : stats_list)
     {
-        LOG_ERROR("db get all domains failed {}", query.lastError().text().toStdString());
+        pending_snapshots_.append(stats);
+        pending_snapshots_.last().timestamp = timestamp;
+        if (hot_tier_capacity_ > 0)
+        {
+            auto ring = hot_tier_.find(stats.name);
+            if (ring == hot_tier_.end())
+            {
+                ring = hot_tier_.insert(stats.name, traffic_ring(hot_tier_capacity_));
+            }
+            ring.value().append(to_traffic_point(pending_snapshots_.last()));
+        }
     }
-    else
+    // every tick lists all interfaces, rings of veth or tun devices that went away are dropped with them
+    for (auto ring = hot_tier_.begin(); ring != hot_tier_.end();)
     {
-        while (query.next())
+        const QString& name = ring.key();
+        const bool listed =
+            std::any_of(stats_list.cbegin(), stats_list.cend(), [&name](const interface_stats& stats) { return stats.name == name; });
+        if (listed)
         {
-            results.append(query.value(0).toString());
+            ++ring;
+        }
+        else
+        {
+            ring = hot_tier_.erase(ring);
         }
     }
 
-    LOG_DEBUG("all domains query finished for id {} found {} domains", request_id, results.size());
-    emit all_domains_ready(request_id, results);
+    if (pending_snapshots_.size() >= kSnapshotBatchRows)
+    {
+        flush_snapshots();
+    }
+    else if (!snapshot_flush_timer_->isActive())
+    {
+        snapshot_flush_timer_->start(kSnapshotFlushIntervalMs);
+    }
 }
 
-void database_manager::get_dns_details_for_domain(quint64 request_id, const QString& domain, const QDateTime& start, const QDateTime& end)
+void database_manager::flush_snapshots()
 {
-    LOG_DEBUG("dns details request id {} for domain {}", request_id, domain.toStdString());
-    QList<dns_query_info> results;
-    if (!db_.isOpen())
+    if (snapshot_flush_timer_ != nullptr)
+    {
+        snapshot_flush_timer_->stop();
+    }
+    if (pending_snapshots_.isEmpty() || !db_.is_open())
     {
-        LOG_WARN("cannot get dns details db not open");
-        emit dns_details_ready(request_id, results);
         return;
     }
 
-    QSqlQuery query(db_);
-    query.prepare(
-        "SELECT timestamp, transaction_id, direction, query_domain, query_type, response_code, response_data, resolver_ip "
-        "FROM dns_logs "
-        "WHERE query_domain = :domain AND timestamp BETWEEN :start_ts AND :end_ts "
-        "ORDER BY timestamp DESC");
-
-    query.bindValue(":domain", domain);
-    query.bindValue(":start_ts", start.toMSecsSinceEpoch());
-    query.bindValue(":end_ts", end.toMSecsSinceEpoch());
+    QList<interface_stats> stats_list;
+    stats_list.swap(pending_snapshots_);
+    LOG_TRACE("flushing {} buffered snapshot rows", stats_list.size());
 
-    if (!query.exec())
+    auto bind_snapshot = [this](const interface_stats& stats, sqlite_statement& insert)
     {
-        LOG_ERROR("db get dns details for {} failed {}", domain.toStdString(), query.lastError().text().toStdString());
-    }
-    else
+        const qint64 id = interface_id(stats.name);
+        if (id < 0)
+        {
+            return false;
+        }
+        insert.bind_int64(1, id);
+        insert.bind_int64(2, stats.timestamp.realtime_ms);
+        const quint64 values[] = {stats.bytes_received,
+                                  stats.bytes_sent,
+                                  stats.rx_packets,
+                                  stats.tx_packets,
+                                  stats.rx_errors,
+                                  stats.tx_errors,
+                                  stats.rx_dropped,
+                                  stats.tx_dropped,
+                                  stats.rx_fifo_errors,
+                                  stats.tx_fifo_errors,
+                                  stats.multicast};
+        int index = 3;
+        for (quint64 value : values)
+        {
+            insert.bind_int64(index++, static_cast<qint64>(value));
+        }
+        if (stats.timestamp.realtime_ms >= rollup_backfill_end_)
+        {
+            live_rollup_.add(id, to_traffic_point(stats));
+        }
+        return true;
+    };
+    const bool written = traffic_storage_ == traffic_storage::kBlocks
+                             ? append_to_blocks(stats_list)
+                             : write_partitioned(partitions_, partition_kind::kTraffic, kInsertSnapshotSql, stats_list, bind_snapshot);
+    if (!written)
+    {
+        LOG_ERROR("db batch add snapshot failed");
+        live_rollup_.clear();
+        return;
+    }
+
+    // rollups live in the main file and commit on their own
+    if (!db_.begin())
     {
-        while (query.next())
+        LOG_ERROR("db failed to start rollup transaction {}", db_.last_error());
+        live_rollup_.clear();
+        return;
+    }
+    if (!live_rollup_.write(db_))
+    {
+        if (!db_.rollback())
         {
-            dns_query_info info;
-            info.timestamp = QDateTime::fromMSecsSinceEpoch(query.value(0).toLongLong());
-            info.transaction_id = static_cast<quint16>(query.value(1).toUInt());
-            info.direction = static_cast<dns_query_info::packet_direction>(query.value(2).toInt());
-            info.query_domain = query.value(3).toString();
-            info.query_type = query.value(4).toString();
-            info.response_code = query.value(5).toString();
-            info.response_data = query.value(6).toString().split(", ", Qt::SkipEmptyParts);
-            info.resolver_ip = query.value(7).toString();
-            results.append(info);
+            LOG_ERROR("db rollback failed after rollup error {}", db_.last_error());
         }
+        return;
+    }
+
+    if (!db_.commit())
+    {
+        LOG_ERROR("db transaction commit failed {}", db_.last_error());
+    }
+}
+
+bool database_manager::append_to_blocks(const QList<interface_stats>& stats_list)
+{
+    bool ok = true;
+    qint64 newest_ms = 0;
+    for (const auto& stats : stats_list)
+    {
+        const qint64 id = interface_id(stats.name);
+        if (id < 0)
+        {
+            continue;
+        }
+        const traffic_point point = to_traffic_point(stats);
+        const qint64 start_ms = traffic_block::block_start(point.timestamp_ms);
+        auto it = open_blocks_.find(id);
+        if (it != open_blocks_.end() && it.value().start_ms != start_ms)
+        {
+            ok = write_block(id, it.value().start_ms, it.value().block) && ok;
+            open_blocks_.erase(it);
+            it = open_blocks_.end();
+        }
+        if (it == open_blocks_.end())
+        {
+            // a restart within the hour carries on from the samples already checkpointed for it
+            it = open_blocks_.insert(id, open_block{start_ms, load_block(id, start_ms), false});
+        }
+        if (it.value().block.append(point))
+        {
+            it.value().dirty = true;
+        }
+        if (point.timestamp_ms >= rollup_backfill_end_)
+        {
+            live_rollup_.add(id, point);
+        }
+        newest_ms = std::max(newest_ms, point.timestamp_ms);
+    }
+
+    // interfaces that stopped reporting get their hour sealed once the clock has moved past it
+    for (auto it = open_blocks_.begin(); it != open_blocks_.end();)
+    {
+        if (it.value().start_ms < traffic_block::block_start(newest_ms))
+        {
+            ok = write_block(it.key(), it.value().start_ms, it.value().block) && ok;
+            it = open_blocks_.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    if (!block_checkpoint_timer_.isValid() || block_checkpoint_timer_.elapsed() >= kBlockCheckpointMs)
+    {
+        checkpoint_open_blocks();
+    }
+    return ok;
+}
+
+bool database_manager::write_block(qint64 interface_id, qint64 block_start, const traffic_block& block)
+{
+    sqlite_database* part = partitions_.partition(partition_kind::kTraffic, block_start, true);
+    sqlite_statement* upsert = part != nullptr ? part->statement(kUpsertBlockSql) : nullptr;
+    if (upsert == nullptr)
+    {
+        LOG_ERROR("no writable partition for traffic block {}", block_start);
+        return false;
+    }
+    const std::string data = block.encode();
+    upsert->bind_int64(1, interface_id);
+    upsert->bind_int64(2, block_start);
+    upsert->bind_int64(3, block.size());
+    upsert->bind_int64(4, block.last_timestamp_ms());
+    upsert->bind_blob(5, data.data(), static_cast<int>(data.size()));
+    if (!upsert->execute())
+    {
+        LOG_ERROR("write traffic block {} of interface {} failed {}", block_start, interface_id, part->last_error());
+        return false;
+    }
+    return true;
+}
+
+traffic_block database_manager::load_block(qint64 interface_id, qint64 block_start)
+{
+    traffic_block block;
+    sqlite_database* part = partitions_.partition(partition_kind::kTraffic, block_start, false);
+    sqlite_statement* select =
+        part != nullptr ? part->statement("SELECT data FROM traffic_blocks WHERE interface_id = ?1 AND block_start = ?2") : nullptr;
+    if (select == nullptr)
+    {
+        return block;
+    }
+    DEFER(select->reset());
+    select->bind_int64(1, interface_id);
+    select->bind_int64(2, block_start);
+    if (select->step() != sqlite_statement::step_result::kRow)
+    {
+        return block;
+    }
+    QList<traffic_point> points;
+    if (!traffic_block::decode(select->column_blob(0), block_start, block_start + traffic_block::kBlockMs - 1, points))
+    {
+        LOG_WARN("traffic block {} of interface {} is unreadable, starting it over", block_start, interface_id);
+    }
+    for (const auto& point : points)
+    {
+        block.append(point);
+    }
+    return block;
+}
+
+void database_manager::checkpoint_open_blocks()
+{
+    for (auto it = open_blocks_.begin(); it != open_blocks_.end(); ++it)
+    {
+        if (it.value().dirty && write_block(it.key(), it.value().start_ms, it.value().block))
+        {
+            it.value().dirty = false;
+        }
+    }
+    block_checkpoint_timer_.start();
+}
+
+void database_manager::add_dns_log(const dns_query_info& info)
+{
+    if (!db_.is_open())
+    {
+        LOG_WARN("cannot add dns log database is not open");
+        return;
+    }
+    dns_query_info formatted = info;
+    format_dns_addresses(formatted);
+    recent_dns_.append(formatted);
+    pending_dns_logs_.append(std::move(formatted));
+    schedule_dns_flush();
+}
+
+void database_manager::drain_dns_events()
+{
+    if (dns_event_queue_ == nullptr || !db_.is_open())
+    {
+        return;
+    }
+
+    for (auto& batch : dns_event_queue_->take_all())
+    {
+        // the capture threads leave addresses in binary, they are turned into text here off the packet path
+        for (auto& info : batch)
+        {
+            format_dns_addresses(info);
+            recent_dns_.append(info);
+        }
+        pending_dns_logs_.append(std::move(batch));
+    }
+    schedule_dns_flush();
+}
+
+void database_manager::schedule_dns_flush()
+{
+    if (pending_dns_logs_.size() >= kDnsFlushRows)
+    {
+        flush_dns_logs();
+    }
+    else if (!pending_dns_logs_.isEmpty() && dns_flush_timer_ != nullptr && !dns_flush_timer_->isActive())
+    {
+        dns_flush_timer_->start(kDnsFlushIntervalMs);
+    }
+}
+
+void database_manager::flush_dns_logs()
+{
+    if (dns_flush_timer_ != nullptr)
+    {
+        dns_flush_timer_->stop();
+    }
+    if (pending_dns_logs_.isEmpty() || !db_.is_open())
+    {
+        return;
+    }
+    QElapsedTimer flush_timer;
+    flush_timer.start();
+    QList<dns_query_info> logs;
+    logs.swap(pending_dns_logs_);
+    recent_dns_.evict(sample_clock::realtime_ms() - kDnsRecentSpanMs, kDnsRecentMaxEvents);
+
+    const qsizetype written = write_dns_logs(partitions_, logs);
+    if (written < logs.size())
+    {
+        // recent_dns_ already answers for these rows, so they are retried a few times and then reported as
+        // dropped rather than silently missing from storage
+        const qsizetype unwritten = logs.size() - written;
+        if (++dns_write_failures_ <= kDnsWriteRetries)
+        {
+            LOG_ERROR("db batch add dns logs failed, retrying {} rows", unwritten);
+            // pending_dns_logs_ was swapped out above and nothing was queued since, so the rows keep their order
+            pending_dns_logs_ = logs.mid(written);
+            if (dns_flush_timer_ != nullptr)
+            {
+                dns_flush_timer_->start(kDnsFlushIntervalMs);
+            }
+        }
+        else
+        {
+            LOG_ERROR("db batch add dns logs failed {} times, dropping {} rows", dns_write_failures_, unwritten);
+            dns_logs_lost_ += static_cast<quint64>(unwritten);
+            dns_write_failures_ = 0;
+        }
+    }
+    else
+    {
+        dns_write_failures_ = 0;
+    }
+
+    const qint64 latency_ns = flush_timer.nsecsElapsed();
+    dns_writer_stats_.commits++;
+    dns_writer_stats_.rows += static_cast<quint64>(written);
+    dns_writer_stats_.flush_ns_total += latency_ns;
+    dns_writer_stats_.flush_ns_max = std::max(dns_writer_stats_.flush_ns_max, latency_ns);
+    dns_logs_stored_ += static_cast<quint64>(written);
+    LOG_TRACE("committed {} dns logs in {} us", written, latency_ns / 1000);
+
+    if (!dns_report_timer_.isValid())
+    {
+        dns_report_timer_.start();
+    }
+    else if (dns_report_timer_.elapsed() >= kDnsWriterReportIntervalMs)
+    {
+        report_dns_writer_stats(dns_report_timer_.restart());
+    }
+    emit dns_logs_stored(dns_logs_stored_, dns_logs_lost_ + (dns_event_queue_ != nullptr ? dns_event_queue_->dropped_events() : 0));
+}
+
+void database_manager::report_dns_writer_stats(qint64 elapsed_ms)
+{
+    const quint64 backlog = static_cast<quint64>(pending_dns_logs_.size()) + (dns_event_queue_ != nullptr ? dns_event_queue_->queued_events() : 0);
+    if (dns_writer_stats_.commits > 0 && elapsed_ms > 0)
+    {
+        LOG_INFO("dns writer {} rows/s {} rows per commit flush latency avg {} us max {} us backlog {}",
+                 dns_writer_stats_.rows * 1000 / static_cast<quint64>(elapsed_ms),
+                 dns_writer_stats_.rows / dns_writer_stats_.commits,
+                 dns_writer_stats_.flush_ns_total / static_cast<qint64>(dns_writer_stats_.commits) / 1000,
+                 dns_writer_stats_.flush_ns_max / 1000,
+                 backlog);
+    }
+    dns_writer_stats_ = {};
+}
+
+history_reader* database_manager::next_reader()
+{
+    if (readers_.isEmpty())
+    {
+        return nullptr;
+    }
+    history_reader* reader = *std::min_element(
+        readers_.cbegin(), readers_.cend(), [](const history_reader* a, const history_reader* b) { return a->pending() < b->pending(); });
+    reader->queued();
+    return reader;
+}
+
+bool database_manager::answer_from_hot_tier(const snapshot_query& query)
+{
+    if (query.tier.resolution_ms != 0)
+    {
+        return false;
+    }
+    // every interface has to be covered, a partial answer would still need the readers
+    for (const QString& name : query.interface_names)
+    {
+        const auto ring = hot_tier_.constFind(name);
+        if (ring == hot_tier_.constEnd() || !ring.value().covers(query.start_ms))
+        {
+            return false;
+        }
+    }
+    QList<interface_history> histories;
+    histories.reserve(query.interface_names.size());
+    QList<traffic_point> points;
+    for (const QString& name : query.interface_names)
+    {
+        interface_history history;
+        history.interface_name = name;
+        points.clear();
+        // value() would hand back a copy of the whole ring
+        hot_tier_.constFind(name).value().read(query.start_ms, query.end_ms, points);
+        build_rate_series(history, points, query.pixel_width, query.sample_interval_ms);
+        histories.append(history);
+    }
+    LOG_TRACE("snapshots for {} interfaces answered from the hot tier", query.interface_names.size());
+    emit snapshots_ready(query.request_id, histories);
+    return true;
+}
+
+void database_manager::get_snapshots_in_range(
+    quint64 request_id, const QStringList& interface_names, qint64 start_ms, qint64 end_ms, int pixel_width)
+{
+    snapshot_query query;
+    query.request_id = request_id;
+    query.interface_names = interface_names;
+    query.start_ms = start_ms;
+    query.end_ms = end_ms;
+    query.pixel_width = pixel_width;
+    query.sample_interval_ms = sample_interval_ms_;
+    query.tier = traffic_rollup::pick_tier(start_ms, end_ms, pixel_width, sample_clock::realtime_ms(), retention_.traffic_max_age_ms);
+    query_generations_->advance(query_scope::kSnapshots, request_id);
+    if (!interface_names.isEmpty() && answer_from_hot_tier(query))
+    {
+        return;
+    }
+    history_reader* reader = db_.is_open() && !interface_names.isEmpty() ? next_reader() : nullptr;
+    if (reader == nullptr)
+    {
+        QList<interface_history> histories;
+        for (const QString& name : interface_names)
+        {
+            interface_history history;
+            history.interface_name = name;
+            history.resolution_ms = query.tier.resolution_ms;
+            histories.append(history);
+        }
+        emit snapshots_ready(request_id, histories);
+        return;
+    }
+
+    // ids, pending rows and the open hours are writer state, everything a reader needs is captured here
+    flush_snapshots();
+    query.interface_ids.reserve(interface_names.size());
+    for (const QString& name : interface_names)
+    {
+        const qint64 id = stored_interface_id(name);
+        query.interface_ids.append(id);
+        const auto open = open_blocks_.constFind(id);
+        if (query.tier.resolution_ms == 0 && open != open_blocks_.constEnd() && !open.value().block.empty())
+        {
+            query.open_blocks.insert(id, qMakePair(open.value().start_ms, open.value().block.encode()));
+        }
+    }
+    QMetaObject::invokeMethod(reader, [reader, query]() { reader->read_snapshots(query); }, Qt::QueuedConnection);
+}
+
+void database_manager::run_retention()
+{
+    if (!db_.is_open())
+    {
+        return;
+    }
+    QElapsedTimer budget;
+    budget.start();
+    const qint64 now_ms = sample_clock::realtime_ms();
+
+    // whole expired days are unlinked, the main file only holds rows from before partitioning
+    partitions_.drop_before(partition_kind::kTraffic, raw_prune_cutoff(now_ms));
+    partitions_.drop_before(partition_kind::kDns, now_ms - retention_.dns_max_age_ms);
+
+    bool more = prune_raw_slice(raw_prune_cutoff(now_ms));
+    if (budget.elapsed() < kRetentionBudgetMs)
+    {
+        more = prune_dns_slice(now_ms - retention_.dns_max_age_ms) || more;
+    }
+    if (budget.elapsed() < kRetentionBudgetMs)
+    {
+        prune_rollups(now_ms);
+    }
+    // one old dns partition per tick, readers only use dns_buckets in files the writer gave them to
+    if (budget.elapsed() < kRetentionBudgetMs)
+    {
+        more = partitions_.backfill_dns_buckets() || more;
+    }
+    if (!more && retention_.max_database_bytes > 0 && budget.elapsed() < kRetentionBudgetMs)
+    {
+        const qint64 used = used_bytes() + partitions_.disk_bytes();
+        if (used > retention_.max_database_bytes)
+        {
+            LOG_DEBUG("database uses {} bytes over the {} byte limit, dropping the oldest rows", used, retention_.max_database_bytes);
+            more = prune_raw_slice(rollup_backfill_cursor_ < rollup_backfill_end_ ? rollup_backfill_cursor_ : now_ms);
+            more = prune_dns_slice(now_ms) || more;
+            more = more || drop_oldest_partition(now_ms);
+        }
+    }
+    if (incremental_vacuum_ && budget.elapsed() < kRetentionBudgetMs && free_pages() > 0)
+    {
+        db_.exec(kIncrementalVacuumSql);
+        more = more || free_pages() > 0;
+    }
+    // the one time rewrite blocks writes for its whole run, so it waits until migration, backfill and pruning are done
+    if (!more && vacuum_conversion_pending_ && !legacy_migration_pending_ && rollup_backfill_cursor_ >= rollup_backfill_end_)
+    {
+        convert_to_incremental_vacuum();
+    }
+    if (wal_checkpoint_timer_.elapsed() >= kWalCheckpointIntervalMs)
+    {
+        checkpoint_wal();
+        wal_checkpoint_timer_.restart();
+    }
+    if (query_report_timer_.elapsed() >= kQueryReportIntervalMs)
+    {
+        report_query_stats(query_report_timer_.restart());
+    }
+    retention_timer_->start(more ? kRetentionBusyTickMs : kRetentionIdleTickMs);
+}
+
+qint64 database_manager::raw_prune_cutoff(qint64 now_ms) const
+{
+    const qint64 age_cutoff_ms = now_ms - retention_.traffic_max_age_ms.front();
+    // raw rows that have not been rolled up yet stay until the backfill passes them
+    if (rollup_backfill_cursor_ < rollup_backfill_end_)
+    {
+        return std::min(age_cutoff_ms, rollup_backfill_cursor_);
+    }
+    return age_cutoff_ms;
+}
+
+bool database_manager::drop_oldest_partition(qint64 now_ms)
+{
+    const auto oldest_traffic = partitions_.oldest_start_ms(partition_kind::kTraffic);
+    const auto oldest_dns = partitions_.oldest_start_ms(partition_kind::kDns);
+    const bool traffic_first = oldest_traffic.has_value() && (!oldest_dns.has_value() || *oldest_traffic < *oldest_dns);
+    const partition_kind kind = traffic_first ? partition_kind::kTraffic : partition_kind::kDns;
+    const auto oldest = traffic_first ? oldest_traffic : oldest_dns;
+    const qint64 cutoff_ms = oldest.value_or(now_ms) + partition_store::kPartitionMs;
+    // the partition being written today is never dropped for size
+    if (!oldest.has_value() || cutoff_ms > now_ms - now_ms % partition_store::kPartitionMs)
+    {
+        return false;
+    }
+    return partitions_.drop_before(kind, cutoff_ms) > 0;
+}
+
+bool database_manager::prune_raw_slice(qint64 cutoff_ms)
+{
+    sqlite_statement* oldest = db_.statement(kOldestSnapshotSql);
+    if (oldest == nullptr)
+    {
+        return false;
+    }
+    qint64 oldest_ms = 0;
+    {
+        DEFER(oldest->reset());
+        oldest->bind_int64(1, std::numeric_limits<qint64>::min());
+        if (oldest->step() != sqlite_statement::step_result::kRow || oldest->column_is_null(0))
+        {
+            return false;
+        }
+        oldest_ms = oldest->column_int64(0);
+    }
+    if (oldest_ms >= cutoff_ms)
+    {
+        return false;
+    }
+
+    // the IN list keeps the delete on the (interface_id, timestamp) key instead of a full scan
+    sqlite_statement* prune = db_.statement("DELETE FROM traffic_snapshots WHERE interface_id IN (SELECT id FROM interfaces) AND timestamp < ?1");
+    if (prune == nullptr)
+    {
+        return false;
+    }
+    prune->bind_int64(1, std::min(cutoff_ms, oldest_ms + kRetentionSliceMs));
+    if (!prune->execute())
+    {
+        LOG_ERROR("prune old traffic data failed {}", db_.last_error());
+        return false;
+    }
+    LOG_TRACE("pruned {} raw traffic rows", db_.changes());
+    return true;
+}
+
+bool database_manager::prune_dns_slice(qint64 cutoff_ms)
+{
+    sqlite_statement* oldest = db_.statement("SELECT MIN(timestamp) FROM dns_logs");
+    if (oldest == nullptr)
+    {
+        return false;
+    }
+    qint64 oldest_ms = 0;
+    {
+        DEFER(oldest->reset());
+        if (oldest->step() != sqlite_statement::step_result::kRow || oldest->column_is_null(0))
+        {
+            return false;
+        }
+        oldest_ms = oldest->column_int64(0);
+    }
+    if (oldest_ms >= cutoff_ms)
+    {
+        return false;
+    }
+
+    sqlite_statement* prune = db_.statement("DELETE FROM dns_logs WHERE timestamp < ?1");
+    if (prune == nullptr)
+    {
+        return false;
+    }
+    prune->bind_int64(1, std::min(cutoff_ms, oldest_ms + kRetentionSliceMs));
+    if (!prune->execute())
+    {
+        LOG_ERROR("prune old dns data failed {}", db_.last_error());
+        return false;
+    }
+    LOG_TRACE("pruned {} dns rows", db_.changes());
+    return true;
+}
+
+bool database_manager::prune_rollups(qint64 now_ms)
+{
+    sqlite_statement* prune =
+        db_.statement("DELETE FROM traffic_rollups WHERE tier = ?1 AND interface_id IN (SELECT id FROM interfaces) AND bucket_start < ?2");
+    if (prune == nullptr)
+    {
+        return false;
+    }
+    bool ok = true;
+    for (size_t i = 0; i < kRollupTiers.size(); ++i)
+    {
+        if (kRollupTiers[i].resolution_ms == 0)
+        {
+            continue;
+        }
+        prune->bind_int64(1, kRollupTiers[i].id);
+        prune->bind_int64(2, now_ms - retention_.traffic_max_age_ms[i]);
+        if (!prune->execute())
+        {
+            LOG_ERROR("prune traffic rollup tier {} failed {}", kRollupTiers[i].id, db_.last_error());
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+void database_manager::checkpoint_wal()
+{
+    // a reader inside an old snapshot pins the frames after it, the next round picks up where this one stopped
+    std::vector<sqlite_database*> connections = partitions_.open_connections();
+    connections.push_back(&db_);
+    int pinned_frames = 0;
+    for (sqlite_database* connection : connections)
+    {
+        pinned_frames += std::max(0, connection->wal_checkpoint());
+    }
+    if (pinned_frames > 0)
+    {
+        LOG_DEBUG("wal checkpoint left {} frames held by readers", pinned_frames);
+    }
+}
+
+void database_manager::report_query_stats(qint64 elapsed_ms)
+{
+    const auto counters = query_generations_->take_counters();
+    if (counters.dropped + counters.interrupted == 0)
+    {
+        return;
+    }
+    LOG_INFO("history queries in the last {} s: {} answered, {} superseded before running, {} interrupted while running",
+             elapsed_ms / 1000,
+             counters.completed,
+             counters.dropped,
+             counters.interrupted);
+}
+
+qint64 database_manager::free_pages()
+{
+    sqlite_statement* freelist = db_.statement("SELECT freelist_count FROM pragma_freelist_count()");
+    if (freelist == nullptr)
+    {
+        return 0;
+    }
+    DEFER(freelist->reset());
+    return freelist->step() == sqlite_statement::step_result::kRow ? freelist->column_int64(0) : 0;
+}
+
+void database_manager::get_qps_stats(quint64 request_id, qint64 start_ms, qint64 end_ms, int interval_secs)
+{
+    if (db_.is_open() && interval_secs > 0 && recent_dns_.covers(start_ms))
+    {
+        query_generations_->advance(query_scope::kQpsStats, request_id);
+        emit qps_stats_ready(request_id, recent_dns_.qps(start_ms, end_ms, interval_secs * 1000L));
+        return;
+    }
+    history_reader* reader = db_.is_open() ? next_reader() : nullptr;
+    if (reader == nullptr)
+    {
+        LOG_WARN("cannot get qps stats db not open");
+        emit qps_stats_ready(request_id, {});
+        return;
+    }
+    query_generations_->advance(query_scope::kQpsStats, request_id);
+    QMetaObject::invokeMethod(
+        reader, [=]() { reader->read_qps_stats(request_id, start_ms, end_ms, interval_secs); }, Qt::QueuedConnection);
+}
+
+void database_manager::get_all_domains(quint64 request_id, qint64 start_ms, qint64 end_ms)
+{
+    if (db_.is_open() && recent_dns_.covers(start_ms))
+    {
+        query_generations_->advance(query_scope::kAllDomains, request_id);
+        emit all_domains_ready(request_id, recent_dns_.domains(start_ms, end_ms));
+        return;
+    }
+    history_reader* reader = db_.is_open() ? next_reader() : nullptr;
+    if (reader == nullptr)
+    {
+        LOG_WARN("cannot get all domains db not open");
+        emit all_domains_ready(request_id, {});
+        return;
+    }
+    query_generations_->advance(query_scope::kAllDomains, request_id);
+    QMetaObject::invokeMethod(reader, [=]() { reader->read_all_domains(request_id, start_ms, end_ms); }, Qt::QueuedConnection);
+}
+
+void database_manager::get_dns_details_for_domain(quint64 request_id, const QString& domain, qint64 start_ms, qint64 end_ms)
+{
+    if (db_.is_open() && recent_dns_.covers(start_ms))
+    {
+        query_generations_->advance(query_scope::kDnsDetails, request_id);
+        emit dns_details_ready(request_id, recent_dns_.details(domain, start_ms, end_ms));
+        return;
+    }
+    history_reader* reader = db_.is_open() ? next_reader() : nullptr;
+    if (reader == nullptr)
+    {
+        LOG_WARN("cannot get dns details db not open");
+        emit dns_details_ready(request_id, {});
+        return;
+    }
+    query_generations_->advance(query_scope::kDnsDetails, request_id);
+    QMetaObject::invokeMethod(
+        reader, [=]() { reader->read_dns_details(request_id, domain, start_ms, end_ms); }, Qt::QueuedConnection);
+}
+
+void database_manager::get_dns_breakdown(quint64 request_id, qint64 start_ms, qint64 end_ms)
+{
+    history_reader* reader = db_.is_open() ? next_reader() : nullptr;
+    if (reader == nullptr)
+    {
+        LOG_WARN("cannot get dns breakdown db not open");
+        emit dns_breakdown_ready(request_id, {});
+        return;
     }
-    LOG_DEBUG("dns details query finished for id {} found {} records", request_id, results.size());
-    emit dns_details_ready(request_id, results);
+    query_generations_->advance(query_scope::kDnsBreakdown, request_id);
+    QMetaObject::invokeMethod(reader, [=]() { reader->read_dns_breakdown(request_id, start_ms, end_ms); }, Qt::QueuedConnection);
 }
@@ -1,21 +1,43 @@
 #ifndef DATABASE_MANAGER_H
 #define DATABASE_MANAGER_H
 
+#include <memory>
+#include <vector>
+#include <QHash>
 #include <QList>
 #include <QObject>
-#include <QDateTime>
+#include <QThread>
+#include <QTimer>
+#include <QElapsedTimer>
 #include <QPointF>
 #include <QPair>
 #include <QStringList>
-#include <QtSql/QSqlDatabase>
 #include "network_info.h"
+#include "sqlite_store.h"
+#include "partition_store.h"
+#include "traffic_point.h"
+#include "traffic_block.h"
+#include "traffic_ring.h"
+#include "traffic_rollup.h"
+#include "traffic_series.h"
 #include "dns_query_info.h"
+#include "dns_event_queue.h"
+#include "dns_recent_store.h"
+#include "history_reader.h"
 
-struct traffic_point
+struct retention_policy
 {
-    qint64 timestamp_ms;
-    quint64 bytes_received;
-    quint64 bytes_sent;
+    tier_ages traffic_max_age_ms = traffic_rollup::default_tier_ages();
+    qint64 dns_max_age_ms = 30 * 24 * kMillisPerHour;
+    // 0 leaves the file unbounded, above it the oldest raw traffic and dns rows go first
+    qint64 max_database_bytes = 0;
+};
+
+// how raw traffic samples are laid out in the day partitions, rows stay readable after switching to blocks
+enum class traffic_storage : uint8_t
+{
+    kRows,
+    kBlocks
 };
 
 class database_manager : public QObject
@@ -26,30 +48,143 @@ class database_manager : public QObject
     explicit database_manager(QString db_path, QObject* parent = nullptr);
     ~database_manager() override;
 
+    // must be set before the manager is moved to its thread
+    void set_dns_event_queue(std::shared_ptr<dns_event_queue> queue) { dns_event_queue_ = std::move(queue); }
+    void set_retention_policy(const retention_policy& policy) { retention_ = policy; }
+    void set_traffic_storage(traffic_storage storage) { traffic_storage_ = storage; }
+    // keeps about span_ms of samples per interface in memory to answer recent raw reads, 0 turns it off,
+    // sample_interval_ms is the collection interval history reads measure data gaps in
+    void set_hot_tier(qint64 span_ms, int sample_interval_ms);
+
    public slots:
     void initialize();
-    void add_snapshots(const QList<interface_stats>& stats_list, const QDateTime& timestamp);
-    void get_snapshots_in_range(quint64 request_id, const QString& interface_name, const QDateTime& start, const QDateTime& end);
+    void add_snapshots(const QList<interface_stats>& stats_list, const sample_time& timestamp);
+    // pixel_width picks the coarsest rollup tier that still has a point per pixel and caps the rates at two
+    // points per pixel, 0 reads raw rows undecimated, every interface is read by the same statements and
+    // answered in one snapshots_ready, the read itself runs on a history_reader thread
+    void get_snapshots_in_range(quint64 request_id, const QStringList& interface_names, qint64 start_ms, qint64 end_ms, int pixel_width);
     void add_dns_log(const dns_query_info& info);
-    void get_qps_stats(quint64 request_id, const QDateTime& start, const QDateTime& end, int interval_secs);
-    void get_all_domains(quint64 request_id, const QDateTime& start, const QDateTime& end);
-    void get_dns_details_for_domain(quint64 request_id, const QString& domain, const QDateTime& start, const QDateTime& end);
+    void drain_dns_events();
+    void get_qps_stats(quint64 request_id, qint64 start_ms, qint64 end_ms, int interval_secs);
+    void get_all_domains(quint64 request_id, qint64 start_ms, qint64 end_ms);
+    void get_dns_details_for_domain(quint64 request_id, const QString& domain, qint64 start_ms, qint64 end_ms);
+    // request and response totals per query type and response code, summed from dns_buckets
+    void get_dns_breakdown(quint64 request_id, qint64 start_ms, qint64 end_ms);
+
+   private slots:
+    void flush_snapshots();
+    void flush_dns_logs();
+    void migrate_legacy_chunk();
+    void backfill_rollup_chunk();
+    void run_retention();
 
    signals:
-    void snapshots_ready(quint64 request_id, const QString& interface_name, const QList<traffic_point>& data);
+    // one entry per requested interface in request order, empty for names never seen
+    void snapshots_ready(quint64 request_id, const QList<interface_history>& histories);
     void initialization_failed();
     void database_ready();
     void qps_stats_ready(quint64 request_id, const QList<QPointF>& data);
     void all_domains_ready(quint64 request_id, const QStringList& domains);
     void dns_details_ready(quint64 request_id, const QList<dns_query_info>& details);
+    void dns_breakdown_ready(quint64 request_id, const dns_breakdown& breakdown);
+    void dns_logs_stored(quint64 stored_total, quint64 dropped_total);
 
    private:
     bool open_database();
     bool create_tables();
-    void prune_old_data(int days_to_keep);
+    bool migrate_traffic_counters();
+    QStringList table_columns(const QString& table);
+    bool begin_legacy_migration();
+    // inserts the name when it is new, for the write paths
+    qint64 interface_id(const QString& name);
+    // -1 for a name never stored, reads must not create interfaces
+    qint64 stored_interface_id(const QString& name);
+    qint64 used_bytes();
+    qint64 meta_value(const char* key, qint64 fallback);
+    bool set_meta_value(const char* key, qint64 value);
+    bool init_rollup_backfill();
+    bool init_auto_vacuum();
+    void convert_to_incremental_vacuum();
+    bool prune_raw_slice(qint64 cutoff_ms);
+    bool prune_dns_slice(qint64 cutoff_ms);
+    bool prune_rollups(qint64 now_ms);
+    bool drop_oldest_partition(qint64 now_ms);
+    qint64 raw_prune_cutoff(qint64 now_ms) const;
+    bool append_to_blocks(const QList<interface_stats>& stats_list);
+    bool write_block(qint64 interface_id, qint64 block_start, const traffic_block& block);
+    traffic_block load_block(qint64 interface_id, qint64 block_start);
+    void checkpoint_open_blocks();
+    qint64 free_pages();
+    void checkpoint_wal();
+    void report_query_stats(qint64 elapsed_ms);
+    history_reader* next_reader();
+    bool answer_from_hot_tier(const snapshot_query& query);
+    void schedule_dns_flush();
+    void report_dns_writer_stats(qint64 elapsed_ms);
 
     QString db_path_;
-    QSqlDatabase db_;
+    sqlite_database db_;
+    // raw traffic and dns_logs rows by utc day, db_ keeps interfaces, rollups and rows from before partitioning
+    partition_store partitions_;
+    QTimer* snapshot_flush_timer_ = nullptr;
+    QList<interface_stats> pending_snapshots_;
+    QHash<QString, qint64> interface_ids_;
+    traffic_storage traffic_storage_ = traffic_storage::kRows;
+    // recent samples per interface name, raw reads starting inside it never reach sqlite
+    qsizetype hot_tier_capacity_ = 0;
+    int sample_interval_ms_ = 1000;
+    QHash<QString, traffic_ring> hot_tier_;
+    // the hour being filled per interface id, sealed when the next hour starts and checkpointed in between
+    struct open_block
+    {
+        qint64 start_ms = 0;
+        traffic_block block;
+        bool dirty = false;
+    };
+    QHash<qint64, open_block> open_blocks_;
+    QElapsedTimer block_checkpoint_timer_;
+    // rows of the old (timestamp, interface_name) layout are moved newest first, one chunk per tick
+    QTimer* legacy_migration_timer_ = nullptr;
+    bool legacy_migration_pending_ = false;
+    qint64 legacy_bytes_before_ = 0;
+    // live rows from rollup_backfill_end_ on feed live_rollup_, older raw rows are folded in by backfill_rollup_
+    traffic_rollup live_rollup_;
+    traffic_rollup backfill_rollup_;
+    QTimer* rollup_backfill_timer_ = nullptr;
+    qint64 rollup_backfill_cursor_ = 0;
+    qint64 rollup_backfill_end_ = 0;
+
+    // expired rows leave in short time slices between writes, freed pages are returned by incremental_vacuum
+    retention_policy retention_;
+    QTimer* retention_timer_ = nullptr;
+    bool incremental_vacuum_ = false;
+    bool vacuum_conversion_pending_ = false;
+    QElapsedTimer wal_checkpoint_timer_;
+    // reads are served by these, each on its own thread with its own read only connections
+    QList<QThread*> reader_threads_;
+    QList<history_reader*> readers_;
+    // superseded requests are skipped or interrupted by the readers, the counts are logged every minute
+    std::shared_ptr<query_generations> query_generations_ = std::make_shared<query_generations>();
+    QElapsedTimer query_report_timer_;
+    std::shared_ptr<dns_event_queue> dns_event_queue_;
+    quint64 dns_logs_stored_ = 0;
+    // rows given up after kDnsWriteRetries failed flushes, reported with the queue drops
+    quint64 dns_logs_lost_ = 0;
+    int dns_write_failures_ = 0;
+
+    // group commit of dns_logs, flushed at kDnsFlushRows rows or kDnsFlushIntervalMs
+    QList<dns_query_info> pending_dns_logs_;
+    // every event since startup or the last kDnsRecentSpanMs, recent dns page windows are answered from here
+    dns_recent_store recent_dns_{sample_clock::realtime_ms()};
+    QTimer* dns_flush_timer_ = nullptr;
+    struct dns_writer_stats
+    {
+        quint64 commits = 0;
+        quint64 rows = 0;
+        qint64 flush_ns_total = 0;
+        qint64 flush_ns_max = 0;
+    } dns_writer_stats_;
+    QElapsedTimer dns_report_timer_;
 };
 
 #endif
@@ -0,0 +1,20 @@
+#ifndef DNS_BREAKDOWN_H
+#define DNS_BREAKDOWN_H
+
+#include <QMap>
+#include <QMetaType>
+#include <QString>
+
+// dns messages in a range summed from dns_buckets, query types are counted over requests and response
+// codes over responses so neither counts a lookup twice
+struct dns_breakdown
+{
+    qint64 requests = 0;
+    qint64 responses = 0;
+    QMap<QString, qint64> query_types;
+    QMap<QString, qint64> response_codes;
+};
+
+Q_DECLARE_METATYPE(dns_breakdown)
+
+#endif
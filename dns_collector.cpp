@@ -1,3 +1,8 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <limits>
 #include <QThread>
 #include <Packet.h>
 #include <PcapFilter.h>
@@ -18,31 +23,33 @@ struct dns_info_registrar
     {
         qRegisterMetaType<dns_query_info::packet_direction>("dns_query_info::packet_direction");
         qRegisterMetaType<dns_query_info>("dns_query_info");
+        qRegisterMetaType<dns_rate_sample>("dns_rate_sample");
     }
 };
 dns_info_registrar registrar;
 }    // namespace
 
-static QString dns_type_to_string(pcpp::DnsType type)
+static QString dns_type_to_string(uint16_t type)
 {
+    // literals avoid a heap allocation for every packet
     switch (type)
     {
         case pcpp::DNS_TYPE_A:
-            return "A";
+            return QStringLiteral("A");
         case pcpp::DNS_TYPE_AAAA:
-            return "AAAA";
+            return QStringLiteral("AAAA");
         case pcpp::DNS_TYPE_NS:
-            return "NS";
+            return QStringLiteral("NS");
         case pcpp::DNS_TYPE_CNAME:
-            return "CNAME";
+            return QStringLiteral("CNAME");
         case pcpp::DNS_TYPE_PTR:
-            return "PTR";
+            return QStringLiteral("PTR");
         case pcpp::DNS_TYPE_MX:
-            return "MX";
+            return QStringLiteral("MX");
         case pcpp::DNS_TYPE_SRV:
-            return "SRV";
+            return QStringLiteral("SRV");
         case pcpp::DNS_TYPE_TXT:
-            return "TXT";
+            return QStringLiteral("TXT");
         default:
             return QString("Type %1").arg(type);
     }
@@ -53,110 +60,62 @@ static QString dns_response_code_to_string(uint8_t code)
     switch (code)
     {
         case 0:
-            return "NoError";
+            return QStringLiteral("NoError");
         case 1:
-            return "FormErr";
+            return QStringLiteral("FormErr");
         case 2:
-            return "ServFail";
+            return QStringLiteral("ServFail");
         case 3:
-            return "NXDomain";
+            return QStringLiteral("NXDomain");
         case 4:
-            return "NotImp";
+            return QStringLiteral("NotImp");
         case 5:
-            return "Refused";
+            return QStringLiteral("Refused");
         default:
             return QString("Code %1").arg(code);
     }
 }
-dns_collector::dns_collector(QObject* parent) : QObject(parent) {}
 
-dns_collector::~dns_collector() { stop_capture(); }
-
-void dns_collector::start_capture()
-{
-    LOG_INFO("attempting to start dns capture in thread {}", QThread::currentThreadId());
-    device_ = pcpp::PcapLiveDeviceList::getInstance().getPcapLiveDeviceByName("eno1");
-    if (device_ == nullptr)
-    {
-        LOG_ERROR("could not find a default pcap device. dns capture will not start");
-        return;
-    }
-
-    LOG_INFO("found device {}", device_->getName());
-
-    if (!device_->open())
-    {
-        LOG_ERROR("could not open pcap device {} dns capture will not start", device_->getName());
-        device_ = nullptr;
-        return;
-    }
-    LOG_INFO("device {} opened successfully", device_->getName());
-
-    pcpp::PortFilter dns_filter(53, pcpp::SRC_OR_DST);
-    if (!device_->setFilter(dns_filter))
-    {
-        LOG_ERROR("could not set dns filter on device {} dns capture will not start", device_->getName());
-        device_->close();
-        device_ = nullptr;
-        return;
-    }
-    LOG_INFO("dns filter set successfully on device {}", device_->getName());
-
-    LOG_INFO("starting capture", device_->getName());
-    device_->startCapture(packet_arrived_callback, this);
-}
-
-void dns_collector::stop_capture()
+static dns_link_type link_type_of(pcpp::LinkLayerType link_type)
 {
-    if (device_ != nullptr)
+    switch (link_type)
     {
-        LOG_INFO("stopping dns capture on device {}", device_->getName());
-        device_->stopCapture();
-        device_->close();
-        device_ = nullptr;
-    }
-}
-
-void dns_collector::packet_arrived_callback(pcpp::RawPacket* raw_packet, pcpp::PcapLiveDevice* dev, void* cookie)
-{
-    (void)dev;
-    LOG_TRACE("packet_arrived_callback triggered");
-    auto* collector = static_cast<dns_collector*>(cookie);
-    if (collector != nullptr)
-    {
-        collector->process_packet(raw_packet);
+        case pcpp::LINKTYPE_LINUX_SLL:
+            return dns_link_type::kLinuxSll;
+        case pcpp::LINKTYPE_RAW:
+        case pcpp::LINKTYPE_DLT_RAW1:
+        case pcpp::LINKTYPE_DLT_RAW2:
+        case pcpp::LINKTYPE_IPV4:
+        case pcpp::LINKTYPE_IPV6:
+            return dns_link_type::kRawIp;
+        default:
+            return dns_link_type::kEthernet;
     }
 }
 
-void dns_collector::process_packet(pcpp::RawPacket* raw_packet)
+// the original pcpp::DnsLayer path, kept to cross check the wire parser when DNS_PARSER_VERIFY is set
+static bool parse_with_pcpp(pcpp::RawPacket* raw_packet, dns_query_info& info)
 {
-    LOG_TRACE("processing a new packet");
     pcpp::Packet parsed_packet(raw_packet);
     auto* dns_layer = parsed_packet.getLayerOfType<pcpp::DnsLayer>();
 
     if (dns_layer == nullptr)
     {
-        LOG_TRACE("packet does not contain a dns layer skipping");
-        return;
+        return false;
     }
-    LOG_DEBUG("dns layer found in packet");
 
     pcpp::dnshdr* dns_header = dns_layer->getDnsHeader();
-    dns_query_info info;
-
-    info.timestamp = QDateTime::currentDateTime();
     info.transaction_id = be16toh(dns_header->transactionID);
 
     pcpp::DnsQuery* query = dns_layer->getFirstQuery();
     if (query != nullptr)
     {
         info.query_domain = QString::fromStdString(query->getName());
-        info.query_type = dns_type_to_string(query->getDnsType());
+        info.query_type = dns_type_to_string(static_cast<uint16_t>(query->getDnsType()));
     }
     else
     {
-        LOG_WARN("dns layer found but it contains no query section");
-        return;
+        return false;
     }
 
     if (dns_header->queryOrResponse == 0)
@@ -166,7 +125,6 @@ void dns_collector::process_packet(pcpp::RawPacket* raw_packet)
         {
             info.resolver_ip = QString::fromStdString(ipLayer->getDstIPAddress().toString());
         }
-        LOG_DEBUG("parsed dns request for {} id {}", info.query_domain.toStdString(), info.transaction_id);
     }
     else
     {
@@ -199,9 +157,554 @@ void dns_collector::process_packet(pcpp::RawPacket* raw_packet)
         {
             info.resolver_ip = QString::fromStdString(ipLayer->getSrcIPAddress().toString());
         }
-        LOG_DEBUG("parsed dns response for {} id {} code {}", info.query_domain.toStdString(), info.transaction_id, info.response_code.toStdString());
     }
 
-    LOG_DEBUG("emitting dns_packet_collected signal");
-    emit dns_packet_collected(info);
+    return true;
+}
+
+static constexpr int kReorderDrainIntervalMs = 100;
+static constexpr qint64 kReorderWindowNs = 200LL * 1000 * 1000;
+static constexpr qint64 kCaptureReportIntervalMs = 60000;
+static constexpr size_t kDnsBatchSize = 512;
+static constexpr size_t kMaxReorderEvents = 8 * kDnsBatchSize;
+static constexpr int kRatePublishIntervalMs = 1000;
+static constexpr uint8_t kRcodeServFail = 2;
+static constexpr uint8_t kRcodeNxDomain = 3;
+
+static dns_collector::capture_backend capture_backend_from_env()
+{
+    const char* backend = getenv("DNS_CAPTURE_BACKEND");
+    if (backend != nullptr && strcmp(backend, "ring") == 0)
+    {
+        return dns_collector::capture_backend::kPacketRing;
+    }
+    return dns_collector::capture_backend::kPcap;
+}
+
+static QStringList configured_devices_from_env()
+{
+    QStringList devices;
+    const char* configured = getenv("DNS_CAPTURE_DEVICES");
+    if (configured == nullptr)
+    {
+        return devices;
+    }
+    for (const auto& name : QString::fromLocal8Bit(configured).split(',', Qt::SkipEmptyParts))
+    {
+        const QString trimmed = name.trimmed();
+        if (!trimmed.isEmpty() && !devices.contains(trimmed))
+        {
+            devices.append(trimmed);
+        }
+    }
+    return devices;
+}
+
+dns_collector::dns_collector(std::shared_ptr<dns_event_queue> event_queue, QObject* parent)
+    : QObject(parent),
+      event_queue_(std::move(event_queue)),
+      backend_(capture_backend_from_env()),
+      configured_devices_(configured_devices_from_env()),
+      verify_parser_(getenv("DNS_PARSER_VERIFY") != nullptr)
+{
+    if (verify_parser_)
+    {
+        LOG_INFO("dns wire parser output will be cross checked against pcpp");
+    }
+}
+
+dns_collector::~dns_collector() { stop_capture(); }
+
+void dns_collector::start_capture()
+{
+    if (capture_started_)
+    {
+        return;
+    }
+    LOG_INFO("attempting to start dns capture in thread {} backend {}",
+             QThread::currentThreadId(),
+             backend_ == capture_backend::kPacketRing ? "packet ring" : "pcap");
+    capture_started_ = true;
+    report_timer_.start();
+
+    if (drain_timer_ == nullptr)
+    {
+        drain_timer_ = new QTimer(this);
+        connect(drain_timer_, &QTimer::timeout, this, &dns_collector::drain_reorder_buffer);
+    }
+    drain_timer_->start(kReorderDrainIntervalMs);
+
+    if (rate_timer_ == nullptr)
+    {
+        rate_timer_ = new QTimer(this);
+        connect(rate_timer_, &QTimer::timeout, this, &dns_collector::publish_rates);
+    }
+    rate_timer_->start(kRatePublishIntervalMs);
+
+    if (!configured_devices_.isEmpty())
+    {
+        LOG_INFO("dns capture restricted to configured devices {}", configured_devices_.join(",").toStdString());
+        for (const auto& name : configured_devices_)
+        {
+            open_device(name);
+        }
+        return;
+    }
+
+    for (const auto& name : known_devices_)
+    {
+        open_device(name);
+    }
+    if (known_devices_.isEmpty())
+    {
+        LOG_INFO("no capture devices known yet waiting for interface notifications");
+    }
+}
+
+void dns_collector::stop_capture()
+{
+    while (!devices_.empty())
+    {
+        close_device(devices_.begin()->first);
+    }
+    while (!ring_devices_.empty())
+    {
+        close_device(ring_devices_.begin()->first);
+    }
+    if (drain_timer_ != nullptr)
+    {
+        drain_timer_->stop();
+    }
+    if (rate_timer_ != nullptr)
+    {
+        rate_timer_->stop();
+    }
+    capture_started_ = false;
+
+    // flush everything that is still waiting for reordering
+    std::vector<dns_query_info> remaining;
+    {
+        QMutexLocker locker(&reorder_mutex_);
+        remaining.swap(reorder_buffer_);
+    }
+    std::stable_sort(remaining.begin(),
+                     remaining.end(),
+                     [](const dns_query_info& a, const dns_query_info& b) { return a.timestamp.monotonic_ns < b.timestamp.monotonic_ns; });
+    deliver_batches(remaining);
+}
+
+void dns_collector::add_device(const QString& device_name)
+{
+    if (!known_devices_.contains(device_name))
+    {
+        known_devices_.append(device_name);
+    }
+    if (capture_started_ && is_wanted_device(device_name))
+    {
+        open_device(device_name);
+    }
+}
+
+void dns_collector::remove_device(const QString& device_name)
+{
+    known_devices_.removeAll(device_name);
+    close_device(device_name);
+}
+
+void dns_collector::rename_device(const QString& old_name, const QString& new_name)
+{
+    remove_device(old_name);
+    add_device(new_name);
+}
+
+bool dns_collector::is_wanted_device(const QString& device_name) const
+{
+    return configured_devices_.isEmpty() || configured_devices_.contains(device_name);
+}
+
+bool dns_collector::open_device(const QString& device_name)
+{
+    if (backend_ == capture_backend::kPacketRing)
+    {
+        return open_ring_device(device_name);
+    }
+    if (devices_.count(device_name) != 0)
+    {
+        return true;
+    }
+
+    const std::string name = device_name.toStdString();
+    auto& device_list = pcpp::PcapLiveDeviceList::getInstance();
+    pcpp::PcapLiveDevice* listed = device_list.getPcapLiveDeviceByName(name);
+    if (listed == nullptr)
+    {
+        // the list is a snapshot taken at startup so interfaces created later need a rescan
+        device_list.reset();
+        listed = device_list.getPcapLiveDeviceByName(name);
+    }
+    if (listed == nullptr)
+    {
+        LOG_ERROR("could not find pcap device {} dns capture will not start on it", name);
+        return false;
+    }
+    if (listed->getLoopback())
+    {
+        LOG_INFO("skipping loopback device {} for dns capture", name);
+        return false;
+    }
+
+    std::unique_ptr<pcpp::PcapLiveDevice> device(listed->clone());
+    if (device == nullptr)
+    {
+        LOG_ERROR("could not clone pcap device {} dns capture will not start on it", name);
+        return false;
+    }
+
+    if (!device->open())
+    {
+        LOG_ERROR("could not open pcap device {} dns capture will not start on it", name);
+        return false;
+    }
+    LOG_INFO("device {} opened successfully", name);
+
+    pcpp::PortFilter dns_filter(53, pcpp::SRC_OR_DST);
+    if (!device->setFilter(dns_filter))
+    {
+        LOG_ERROR("could not set dns filter on device {} dns capture will not start on it", name);
+        device->close();
+        return false;
+    }
+
+    if (!device->startCapture(packet_arrived_callback, this))
+    {
+        LOG_ERROR("could not start capture on device {}", name);
+        device->close();
+        return false;
+    }
+    LOG_INFO("started dns capture on device {} {} devices active", name, devices_.size() + 1);
+    devices_.emplace(device_name, std::move(device));
+    return true;
+}
+
+bool dns_collector::open_ring_device(const QString& device_name)
+{
+    if (ring_devices_.count(device_name) != 0)
+    {
+        return true;
+    }
+
+    auto ring = std::make_unique<packet_ring_capture>();
+    if (!ring->open(device_name.toStdString()))
+    {
+        LOG_ERROR("could not open packet ring on {} dns capture will not start on it", device_name.toStdString());
+        return false;
+    }
+    if (!ring->start(ring_frame_callback, this))
+    {
+        LOG_ERROR("could not start packet ring capture on {}", device_name.toStdString());
+        return false;
+    }
+    LOG_INFO("started dns ring capture on device {} {} devices active", device_name.toStdString(), ring_devices_.size() + 1);
+    ring_devices_.emplace(device_name, std::move(ring));
+    return true;
+}
+
+void dns_collector::close_device(const QString& device_name)
+{
+    auto ring_it = ring_devices_.find(device_name);
+    if (ring_it != ring_devices_.end())
+    {
+        ring_it->second->stop();
+        packet_ring_stats stats;
+        if (ring_it->second->read_statistics(stats))
+        {
+            LOG_INFO("stopping dns ring capture on device {} packets {} dropped {} freezes {} blocks {}",
+                     ring_it->second->name(),
+                     stats.packets,
+                     stats.drops,
+                     stats.freeze_count,
+                     stats.blocks);
+        }
+        ring_devices_.erase(ring_it);
+        return;
+    }
+
+    auto it = devices_.find(device_name);
+    if (it == devices_.end())
+    {
+        return;
+    }
+
+    pcpp::PcapLiveDevice::PcapStats stats = {};
+    it->second->getStatistics(stats);
+    LOG_INFO("stopping dns capture on device {} received {} dropped {} dropped by interface {}",
+             it->second->getName(),
+             stats.packetsRecv,
+             stats.packetsDrop,
+             stats.packetsDropByInterface);
+    it->second->stopCapture();
+    it->second->close();
+    devices_.erase(it);
+}
+
+void dns_collector::report_capture_stats()
+{
+    LOG_INFO("dns parser handled {} messages {} malformed {} interned names generation {} {} queued {} dropped",
+             parsed_packets_.load(std::memory_order_relaxed),
+             malformed_packets_.load(std::memory_order_relaxed),
+             name_table_.size(),
+             name_table_.generation(),
+             event_queue_->queued_events(),
+             event_queue_->dropped_events());
+    const uint64_t verified = verified_packets_.load(std::memory_order_relaxed);
+    if (verified > 0)
+    {
+        LOG_INFO("dns parser verification {} messages {} mismatches wire {} ns per message pcpp {} ns per message",
+                 verified,
+                 verify_mismatches_.load(std::memory_order_relaxed),
+                 wire_parse_ns_.load(std::memory_order_relaxed) / verified,
+                 pcpp_parse_ns_.load(std::memory_order_relaxed) / verified);
+    }
+    for (auto& [name, ring] : ring_devices_)
+    {
+        packet_ring_stats stats;
+        if (ring->read_statistics(stats))
+        {
+            LOG_INFO("dns ring capture on {} packets {} dropped {} freezes {} blocks {}",
+                     ring->name(),
+                     stats.packets,
+                     stats.drops,
+                     stats.freeze_count,
+                     stats.blocks);
+        }
+    }
+    for (auto& [name, device] : devices_)
+    {
+        pcpp::PcapLiveDevice::PcapStats stats = {};
+        device->getStatistics(stats);
+        LOG_INFO("dns pcap capture on {} received {} dropped {} dropped by interface {}",
+                 device->getName(),
+                 stats.packetsRecv,
+                 stats.packetsDrop,
+                 stats.packetsDropByInterface);
+    }
+}
+
+void dns_collector::drain_reorder_buffer()
+{
+    drain_requested_.store(false, std::memory_order_relaxed);
+    if (report_timer_.isValid() && report_timer_.elapsed() >= kCaptureReportIntervalMs)
+    {
+        report_capture_stats();
+        report_timer_.restart();
+    }
+
+    std::vector<dns_query_info> ready;
+    {
+        QMutexLocker locker(&reorder_mutex_);
+        if (reorder_buffer_.empty())
+        {
+            return;
+        }
+        std::stable_sort(reorder_buffer_.begin(),
+                         reorder_buffer_.end(),
+                         [](const dns_query_info& a, const dns_query_info& b) { return a.timestamp.monotonic_ns < b.timestamp.monotonic_ns; });
+
+        // packets younger than the window may still be overtaken by another device's capture thread,
+        // a buffer past its bound is released whole so a burst cannot grow it without limit
+        const qint64 cutoff_ns =
+            reorder_buffer_.size() >= kMaxReorderEvents ? std::numeric_limits<qint64>::max() : sample_clock::monotonic_ns() - kReorderWindowNs;
+        auto split = std::partition_point(reorder_buffer_.begin(),
+                                          reorder_buffer_.end(),
+                                          [cutoff_ns](const dns_query_info& info) { return info.timestamp.monotonic_ns <= cutoff_ns; });
+        ready.assign(std::make_move_iterator(reorder_buffer_.begin()), std::make_move_iterator(split));
+        reorder_buffer_.erase(reorder_buffer_.begin(), split);
+    }
+
+    deliver_batches(ready);
+}
+
+void dns_collector::deliver_batches(std::vector<dns_query_info>& events)
+{
+    for (size_t begin = 0; begin < events.size(); begin += kDnsBatchSize)
+    {
+        const size_t end = std::min(events.size(), begin + kDnsBatchSize);
+        QList<dns_query_info> batch;
+        batch.reserve(static_cast<qsizetype>(end - begin));
+        for (size_t i = begin; i < end; ++i)
+        {
+            batch.append(std::move(events[i]));
+        }
+
+        // the live rates only count what reaches storage, a batch the full queue drops is left out
+        QList<dns_query_info> counted = batch;
+        bool was_empty = false;
+        if (!event_queue_->try_push(std::move(batch), was_empty))
+        {
+            continue;
+        }
+        count_rates(counted);
+        if (was_empty)
+        {
+            emit dns_batch_queued();
+        }
+    }
+}
+
+void dns_collector::packet_arrived_callback(pcpp::RawPacket* raw_packet, pcpp::PcapLiveDevice* dev, void* cookie)
+{
+    (void)dev;
+    LOG_TRACE("packet_arrived_callback triggered");
+    auto* collector = static_cast<dns_collector*>(cookie);
+    if (collector != nullptr)
+    {
+        collector->process_packet(raw_packet);
+    }
+}
+
+void dns_collector::ring_frame_callback(
+    const uint8_t* data, uint32_t length, const timespec& timestamp, uint16_t link_type, void* cookie)
+{
+    auto* collector = static_cast<dns_collector*>(cookie);
+    if (collector != nullptr)
+    {
+        // wraps the frame in the mapped ring without copying, it is only valid for this call
+        pcpp::RawPacket raw_packet(data, static_cast<int>(length), timestamp, false, static_cast<pcpp::LinkLayerType>(link_type));
+        collector->process_packet(&raw_packet);
+    }
+}
+
+void dns_collector::process_packet(pcpp::RawPacket* raw_packet)
+{
+    LOG_TRACE("processing a new packet");
+    const qint64 parse_start_ns = verify_parser_ ? sample_clock::monotonic_ns() : 0;
+    dns_wire_message message;
+    const dns_parse_result result = dns_wire_parser::parse_frame(raw_packet->getRawData(),
+                                                                 static_cast<size_t>(raw_packet->getRawDataLen()),
+                                                                 link_type_of(raw_packet->getLinkLayerType()),
+                                                                 name_table_,
+                                                                 message);
+    if (result == dns_parse_result::kMalformed)
+    {
+        malformed_packets_.fetch_add(1, std::memory_order_relaxed);
+        LOG_TRACE("malformed dns message skipping");
+        return;
+    }
+    if (result != dns_parse_result::kOk)
+    {
+        LOG_TRACE("packet does not contain a dns message skipping");
+        return;
+    }
+
+    dns_query_info info;
+    info.timestamp = sample_clock::now();
+    build_query_info(message, info);
+    parsed_packets_.fetch_add(1, std::memory_order_relaxed);
+
+    if (verify_parser_)
+    {
+        verify_against_pcpp(raw_packet, info, info.timestamp.monotonic_ns - parse_start_ns);
+    }
+
+    QMutexLocker locker(&reorder_mutex_);
+    reorder_buffer_.push_back(std::move(info));
+    // a burst fills the buffer before the drain timer fires
+    if (reorder_buffer_.size() >= kMaxReorderEvents && !drain_requested_.exchange(true, std::memory_order_relaxed))
+    {
+        QMetaObject::invokeMethod(this, &dns_collector::drain_reorder_buffer, Qt::QueuedConnection);
+    }
+}
+
+void dns_collector::count_rates(const QList<dns_query_info>& batch)
+{
+    static const QString kNxDomain = dns_response_code_to_string(kRcodeNxDomain);
+    static const QString kServFail = dns_response_code_to_string(kRcodeServFail);
+    quint32 requests = 0;
+    quint32 nxdomain = 0;
+    quint32 servfail = 0;
+    for (const dns_query_info& info : batch)
+    {
+        requests += info.direction == dns_query_info::packet_direction::kRequest ? 1 : 0;
+        nxdomain += info.response_code == kNxDomain ? 1 : 0;
+        servfail += info.response_code == kServFail ? 1 : 0;
+    }
+    rate_requests_.fetch_add(requests, std::memory_order_relaxed);
+    rate_responses_.fetch_add(static_cast<quint32>(batch.size()) - requests, std::memory_order_relaxed);
+    rate_nxdomain_.fetch_add(nxdomain, std::memory_order_relaxed);
+    rate_servfail_.fetch_add(servfail, std::memory_order_relaxed);
+}
+
+void dns_collector::publish_rates()
+{
+    dns_rate_sample sample;
+    sample.timestamp_ms = sample_clock::realtime_ms();
+    sample.requests = rate_requests_.exchange(0, std::memory_order_relaxed);
+    sample.responses = rate_responses_.exchange(0, std::memory_order_relaxed);
+    sample.nxdomain = rate_nxdomain_.exchange(0, std::memory_order_relaxed);
+    sample.servfail = rate_servfail_.exchange(0, std::memory_order_relaxed);
+    emit dns_rates_sampled(sample);
+}
+
+void dns_collector::build_query_info(const dns_wire_message& message, dns_query_info& info)
+{
+    info.transaction_id = message.transaction_id;
+    info.query_domain = message.query_name != kInvalidNameHandle
+                            ? name_table_.to_qstring(message.query_name)
+                            : QString::fromUtf8(message.query_name_text, static_cast<qsizetype>(message.query_name_length));
+    info.query_type = dns_type_to_string(message.query_type);
+
+    if (!message.is_response)
+    {
+        info.direction = dns_query_info::packet_direction::kRequest;
+        pack_dns_address(info.wire_addresses, message.destination_address);
+        return;
+    }
+
+    info.direction = dns_query_info::packet_direction::kResponse;
+    info.response_code = dns_response_code_to_string(message.response_code);
+    // addresses are formatted by the writer, a typical answer of one or two A records fits the inline string buffer
+    pack_dns_address(info.wire_addresses, message.source_address);
+    for (uint8_t i = 0; i < message.answer_count; ++i)
+    {
+        const dns_wire_answer& answer = message.answers[i];
+        if (!answer.address.empty())
+        {
+            pack_dns_address(info.wire_addresses, answer.address);
+            info.response_data.append(QString());
+        }
+        else if (answer.name != kInvalidNameHandle)
+        {
+            pack_dns_address(info.wire_addresses, {});
+            info.response_data.append(name_table_.to_qstring(answer.name));
+        }
+    }
+}
+
+void dns_collector::verify_against_pcpp(pcpp::RawPacket* raw_packet, const dns_query_info& wire_info, qint64 wire_parse_ns)
+{
+    // the pcpp path formats addresses right away, compare against the text the writer will produce
+    dns_query_info info = wire_info;
+    format_dns_addresses(info);
+    const qint64 pcpp_start_ns = sample_clock::monotonic_ns();
+    dns_query_info expected;
+    const bool parsed = parse_with_pcpp(raw_packet, expected);
+    pcpp_parse_ns_.fetch_add(static_cast<uint64_t>(sample_clock::monotonic_ns() - pcpp_start_ns), std::memory_order_relaxed);
+    wire_parse_ns_.fetch_add(static_cast<uint64_t>(wire_parse_ns), std::memory_order_relaxed);
+    verified_packets_.fetch_add(1, std::memory_order_relaxed);
+
+    if (parsed && expected.transaction_id == info.transaction_id && expected.direction == info.direction &&
+        expected.query_domain == info.query_domain && expected.query_type == info.query_type && expected.response_code == info.response_code &&
+        expected.response_data == info.response_data && expected.resolver_ip == info.resolver_ip)
+    {
+        return;
+    }
+    verify_mismatches_.fetch_add(1, std::memory_order_relaxed);
+    LOG_WARN("dns wire parser disagrees with pcpp for id {} wire {} {} [{}] pcpp {} {} [{}]",
+             info.transaction_id,
+             info.query_domain.toStdString(),
+             info.query_type.toStdString(),
+             info.response_data.join(",").toStdString(),
+             expected.query_domain.toStdString(),
+             expected.query_type.toStdString(),
+             expected.response_data.join(",").toStdString());
 }
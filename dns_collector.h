@@ -1,32 +1,104 @@
 #ifndef DNS_COLLECTOR_H
 #define DNS_COLLECTOR_H
 
+#include <atomic>
+#include <map>
+#include <memory>
+#include <vector>
 #include <QObject>
+#include <QMutex>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QStringList>
 #include <PcapLiveDevice.h>
 #include <RawPacket.h>
 #include "dns_query_info.h"
+#include "packet_ring_capture.h"
+#include "dns_wire_parser.h"
+#include "dns_event_queue.h"
+#include "dns_rate_sample.h"
 
+// opens one capture per device, each capture runs on its own thread,
+// packets from all devices are merged into one timestamp ordered stream
 class dns_collector : public QObject
 {
     Q_OBJECT
 
    public:
-    explicit dns_collector(QObject* parent = nullptr);
+    enum class capture_backend : uint8_t
+    {
+        kPcap,
+        kPacketRing
+    };
+
+    explicit dns_collector(std::shared_ptr<dns_event_queue> event_queue, QObject* parent = nullptr);
     ~dns_collector() override;
 
    public slots:
     void start_capture();
     void stop_capture();
+    void add_device(const QString& device_name);
+    void remove_device(const QString& device_name);
+    void rename_device(const QString& old_name, const QString& new_name);
 
    signals:
-    void dns_packet_collected(const dns_query_info& info);
+    // only emitted when the queue goes from empty to non empty
+    void dns_batch_queued();
+    // once a second while capturing
+    void dns_rates_sampled(const dns_rate_sample& sample);
+
+   private slots:
+    void drain_reorder_buffer();
+    void publish_rates();
 
    private:
+    bool open_device(const QString& device_name);
+    bool open_ring_device(const QString& device_name);
+    void close_device(const QString& device_name);
+    bool is_wanted_device(const QString& device_name) const;
     void process_packet(pcpp::RawPacket* raw_packet);
+    void deliver_batches(std::vector<dns_query_info>& events);
+    void build_query_info(const dns_wire_message& message, dns_query_info& info);
+    void count_rates(const QList<dns_query_info>& batch);
+    void verify_against_pcpp(pcpp::RawPacket* raw_packet, const dns_query_info& info, qint64 wire_parse_ns);
+    void report_capture_stats();
     static void packet_arrived_callback(pcpp::RawPacket* raw_packet, pcpp::PcapLiveDevice* dev, void* cookie);
+    static void ring_frame_callback(const uint8_t* data, uint32_t length, const timespec& timestamp, uint16_t link_type, void* cookie);
 
    private:
-    pcpp::PcapLiveDevice* device_ = nullptr;
+    std::shared_ptr<dns_event_queue> event_queue_;
+    // DNS_CAPTURE_BACKEND=ring selects the TPACKET_V3 ring instead of libpcap
+    capture_backend backend_;
+    // DNS_CAPTURE_DEVICES pins the device set, otherwise devices follow interface notifications
+    QStringList configured_devices_;
+    QStringList known_devices_;
+    bool capture_started_ = false;
+    // clones stay valid across PcapLiveDeviceList::reset
+    std::map<QString, std::unique_ptr<pcpp::PcapLiveDevice>> devices_;
+    std::map<QString, std::unique_ptr<packet_ring_capture>> ring_devices_;
+    QElapsedTimer report_timer_;
+    QTimer* drain_timer_ = nullptr;
+    QTimer* rate_timer_ = nullptr;
+
+    // DNS_PARSER_VERIFY runs the pcpp parser on every message as well and logs disagreements
+    bool verify_parser_;
+    dns_name_table name_table_;
+    std::atomic<uint64_t> parsed_packets_{0};
+    std::atomic<uint64_t> malformed_packets_{0};
+    std::atomic<uint64_t> verified_packets_{0};
+    std::atomic<uint64_t> verify_mismatches_{0};
+    std::atomic<uint64_t> wire_parse_ns_{0};
+    std::atomic<uint64_t> pcpp_parse_ns_{0};
+
+    // bumped for every batch handed to the event queue and swapped to zero by publish_rates
+    std::atomic<quint32> rate_requests_{0};
+    std::atomic<quint32> rate_responses_{0};
+    std::atomic<quint32> rate_nxdomain_{0};
+    std::atomic<quint32> rate_servfail_{0};
+
+    QMutex reorder_mutex_;
+    std::vector<dns_query_info> reorder_buffer_;
+    std::atomic<bool> drain_requested_{false};
 };
 
 #endif
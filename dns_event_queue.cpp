@@ -0,0 +1,43 @@
+#include "log.h"
+#include "dns_event_queue.h"
+
+dns_event_queue::dns_event_queue(qsizetype capacity_events) : capacity_events_(capacity_events) {}
+
+bool dns_event_queue::try_push(QList<dns_query_info>&& batch, bool& was_empty)
+{
+    was_empty = false;
+    if (batch.isEmpty())
+    {
+        return true;
+    }
+
+    QMutexLocker locker(&mutex_);
+    if (queued_events_ + batch.size() > capacity_events_)
+    {
+        const quint64 dropped = dropped_events_.fetch_add(static_cast<quint64>(batch.size()), std::memory_order_relaxed);
+        LOG_WARN("dns event queue full {} events queued dropping batch of {} total dropped {}",
+                 queued_events_,
+                 batch.size(),
+                 dropped + static_cast<quint64>(batch.size()));
+        return false;
+    }
+    was_empty = batches_.isEmpty();
+    queued_events_ += batch.size();
+    batches_.append(std::move(batch));
+    return true;
+}
+
+QList<QList<dns_query_info>> dns_event_queue::take_all()
+{
+    QList<QList<dns_query_info>> batches;
+    QMutexLocker locker(&mutex_);
+    batches.swap(batches_);
+    queued_events_ = 0;
+    return batches;
+}
+
+quint64 dns_event_queue::queued_events() const
+{
+    QMutexLocker locker(&mutex_);
+    return static_cast<quint64>(queued_events_);
+}
@@ -0,0 +1,35 @@
+#ifndef DNS_EVENT_QUEUE_H
+#define DNS_EVENT_QUEUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <QList>
+#include <QMutex>
+#include "dns_query_info.h"
+
+// bounded hand off of dns batches from the capture side straight to the database thread,
+// a full queue drops the incoming batch instead of blocking the capture threads
+class dns_event_queue
+{
+   public:
+    explicit dns_event_queue(qsizetype capacity_events);
+
+    dns_event_queue(const dns_event_queue&) = delete;
+    dns_event_queue& operator=(const dns_event_queue&) = delete;
+
+    // was_empty tells the producer a wakeup is needed, later pushes ride on the pending one
+    bool try_push(QList<dns_query_info>&& batch, bool& was_empty);
+    QList<QList<dns_query_info>> take_all();
+
+    quint64 dropped_events() const { return dropped_events_.load(std::memory_order_relaxed); }
+    quint64 queued_events() const;
+
+   private:
+    const qsizetype capacity_events_;
+    mutable QMutex mutex_;
+    QList<QList<dns_query_info>> batches_;
+    qsizetype queued_events_ = 0;
+    std::atomic<quint64> dropped_events_{0};
+};
+
+#endif
@@ -0,0 +1,88 @@
+#include "dns_name_table.h"
+#include <algorithm>
+#include <numeric>
+#include "log.h"
+
+dns_name_table::dns_name_table(size_t capacity) : shard_capacity_(std::clamp<size_t>(capacity / kShards, 1, kSlotMask)) {}
+
+uint32_t dns_name_table::intern(std::string_view name)
+{
+    const auto shard_index = static_cast<uint32_t>(std::hash<std::string_view>{}(name) & (kShards - 1));
+    shard& names = shards_[shard_index];
+    std::lock_guard<std::mutex> lock(names.mutex);
+    auto it = names.current.index.find(name);
+    if (it != names.current.index.end())
+    {
+        return it->second;
+    }
+    if (names.current.names.size() >= shard_capacity_)
+    {
+        // the previous generation stays readable so handles handed out just before the switch still resolve
+        names.previous = std::move(names.current);
+        names.current = name_generation();
+        ++names.generation;
+        LOG_DEBUG("dns name table shard {} full with {} names starting generation {}", shard_index, shard_capacity_, names.generation);
+    }
+
+    const auto handle = static_cast<uint32_t>(((names.generation & 0xFF) << kGenerationShift) | (shard_index << kSlotBits) |
+                                              names.current.names.size());
+    const std::string& stored = names.current.names.emplace_back(name);
+    names.current.qt_names.push_back(QString::fromUtf8(stored.data(), static_cast<qsizetype>(stored.size())));
+    names.current.index.emplace(std::string_view(stored), handle);
+    return handle;
+}
+
+const dns_name_table::name_generation* dns_name_table::generation_of(const shard& names, uint32_t handle)
+{
+    const uint64_t handle_generation = handle >> kGenerationShift;
+    if (handle_generation == (names.generation & 0xFF))
+    {
+        return &names.current;
+    }
+    if (names.generation > 0 && handle_generation == ((names.generation - 1) & 0xFF))
+    {
+        return &names.previous;
+    }
+    return nullptr;
+}
+
+QString dns_name_table::to_qstring(uint32_t handle) const
+{
+    if (handle == kInvalidNameHandle)
+    {
+        return {};
+    }
+    const shard& names = shards_[(handle >> kSlotBits) & (kShards - 1)];
+    std::lock_guard<std::mutex> lock(names.mutex);
+    const name_generation* generation = generation_of(names, handle);
+    const uint32_t slot = handle & kSlotMask;
+    if (generation == nullptr || slot >= generation->qt_names.size())
+    {
+        return {};
+    }
+    return generation->qt_names[slot];
+}
+
+size_t dns_name_table::size() const
+{
+    return std::accumulate(shards_.begin(),
+                           shards_.end(),
+                           size_t{0},
+                           [](size_t total, const shard& names)
+                           {
+                               std::lock_guard<std::mutex> lock(names.mutex);
+                               return total + names.current.names.size();
+                           });
+}
+
+uint64_t dns_name_table::generation() const
+{
+    return std::accumulate(shards_.begin(),
+                           shards_.end(),
+                           uint64_t{0},
+                           [](uint64_t total, const shard& names)
+                           {
+                               std::lock_guard<std::mutex> lock(names.mutex);
+                               return total + names.generation;
+                           });
+}
@@ -0,0 +1,63 @@
+#ifndef DNS_NAME_TABLE_H
+#define DNS_NAME_TABLE_H
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <QString>
+
+static constexpr uint32_t kInvalidNameHandle = UINT32_MAX;
+
+// interns domain names into stable handles shared by every capture thread,
+// each handle also keeps a QString so repeated names cost a reference count instead of an allocation,
+// names are spread over shards by hash and each shard has its own lock so capture threads rarely wait
+class dns_name_table
+{
+   public:
+    // capacity is split evenly over the shards
+    explicit dns_name_table(size_t capacity = 1U << 16);
+
+    dns_name_table(const dns_name_table&) = delete;
+    dns_name_table& operator=(const dns_name_table&) = delete;
+
+    // once a shard is full it starts a new generation, names still in use are interned again on their next lookup
+    uint32_t intern(std::string_view name);
+    // resolves handles of the current and the previous generation of their shard, older handles return an empty string
+    QString to_qstring(uint32_t handle) const;
+    size_t size() const;
+    // generations started over all shards
+    uint64_t generation() const;
+
+   private:
+    struct name_generation
+    {
+        // deque keeps element addresses stable so the index can key on views into names
+        std::deque<std::string> names;
+        std::deque<QString> qt_names;
+        std::unordered_map<std::string_view, uint32_t> index;
+    };
+    struct shard
+    {
+        mutable std::mutex mutex;
+        name_generation current;
+        name_generation previous;
+        uint64_t generation = 0;
+    };
+    // a handle keeps the low byte of its shard's generation and the shard above the slot
+    static constexpr uint32_t kSlotBits = 20;
+    static constexpr uint32_t kSlotMask = (1U << kSlotBits) - 1;
+    static constexpr uint32_t kShardBits = 4;
+    static constexpr size_t kShards = size_t{1} << kShardBits;
+    static constexpr uint32_t kGenerationShift = kSlotBits + kShardBits;
+
+    static const name_generation* generation_of(const shard& names, uint32_t handle);
+
+    size_t shard_capacity_;
+    std::array<shard, kShards> shards_;
+};
+
+#endif
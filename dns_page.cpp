@@ -1,4 +1,6 @@
 #include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QLabel>
 #include <QHeaderView>
 #include <QTimer>
 #include <QTableView>
@@ -21,6 +23,8 @@ static constexpr auto kRefreshIntervalSecs = 10;
 static constexpr auto kChartIntervalSecs = 10L;
 static constexpr auto kHistoryDurationSecs = 180;
 static constexpr auto kSnapBackTimeoutMs = 5000;
+// query types and response codes listed in the breakdown line, the rest only count in the totals
+static constexpr auto kBreakdownTopEntries = 4;
 
 enum class dns_details_column : uint8_t
 {
@@ -57,7 +61,7 @@ void dns_page::trigger_initial_load()
     LOG_INFO("initial load triggered");
     if (!refresh_timer_->isActive())
     {
-        on_refresh_timer_timeout();
+        request_data_for_current_view();
         refresh_timer_->start(kRefreshIntervalSecs * 1000);
     }
 }
@@ -94,12 +98,101 @@ void dns_page::setup_ui()
     splitter_->addWidget(domain_details_view_);
     splitter_->setSizes({300, 700});
 
+    capture_status_label_ = new QLabel("等待 DNS 报文", this);
+    live_rate_label_ = new QLabel(this);
+    breakdown_label_ = new QLabel(this);
+
+    auto* status_layout = new QHBoxLayout();
+    status_layout->addWidget(capture_status_label_);
+    status_layout->addStretch();
+    status_layout->addWidget(live_rate_label_);
+
     auto* main_layout = new QVBoxLayout(this);
     main_layout->addWidget(chart_view_, 3);
+    main_layout->addLayout(status_layout);
+    main_layout->addWidget(breakdown_label_);
     main_layout->addWidget(splitter_, 2);
     setLayout(main_layout);
 }
 
+void dns_page::handle_dns_logs_stored(quint64 stored_total, quint64 dropped_total)
+{
+    capture_status_label_->setText(QString("已记录 %1 条 DNS 报文，丢弃 %2 条").arg(stored_total).arg(dropped_total));
+}
+
+void dns_page::handle_dns_rates(const dns_rate_sample& sample)
+{
+    live_rate_label_->setText(
+        QString("每秒 请求 %1 响应 %2 NXDOMAIN %3 SERVFAIL %4").arg(sample.requests).arg(sample.responses).arg(sample.nxdomain).arg(sample.servfail));
+    if (is_manual_view_active_)
+    {
+        return;
+    }
+    if (sample.requests > 0)
+    {
+        track_history_span(sample.timestamp_ms);
+    }
+
+    // the sample lands in the chart bucket it ended in, buckets skipped while idle are filled with zero
+    const qint64 interval_msecs = kChartIntervalSecs * 1000;
+    const qint64 bucket_msecs = (sample.timestamp_ms / interval_msecs) * interval_msecs;
+    const auto requests = static_cast<qreal>(sample.requests);
+    const int count = qps_series_->count();
+    const qint64 last_msecs = count > 0 ? static_cast<qint64>(qps_series_->at(count - 1).x()) : bucket_msecs - interval_msecs;
+    // the last stored reply already counted part of its newest bucket, live counts resume after it
+    const bool stored = sample.timestamp_ms <= live_from_ms_;
+    if (!stored && last_msecs == bucket_msecs)
+    {
+        qps_series_->replace(count - 1, QPointF(static_cast<qreal>(bucket_msecs), qps_series_->at(count - 1).y() + requests));
+    }
+    else if (!stored && last_msecs < bucket_msecs)
+    {
+        QList<QPointF> fresh;
+        const qint64 window_msecs = static_cast<qint64>(kHistoryDurationSecs) * 1000;
+        for (qint64 msecs = std::max(last_msecs + interval_msecs, bucket_msecs - window_msecs); msecs < bucket_msecs; msecs += interval_msecs)
+        {
+            fresh.append(QPointF(static_cast<qreal>(msecs), 0));
+        }
+        fresh.append(QPointF(static_cast<qreal>(bucket_msecs), requests));
+        qps_series_->append(fresh);
+    }
+
+    const QDateTime end_time = QDateTime::fromMSecsSinceEpoch(sample.timestamp_ms);
+    const QDateTime start_time = end_time.addSecs(-kHistoryDurationSecs);
+    const qint64 first_bucket_msecs = (start_time.toMSecsSinceEpoch() / interval_msecs) * interval_msecs;
+    int expired = 0;
+    while (expired < qps_series_->count() && static_cast<qint64>(qps_series_->at(expired).x()) < first_bucket_msecs)
+    {
+        ++expired;
+    }
+    if (expired > 0)
+    {
+        qps_series_->removePoints(0, expired);
+    }
+    update_chart_axes(start_time, end_time);
+}
+
+void dns_page::track_history_span(qint64 first_ms)
+{
+    if (drag_enabled_)
+    {
+        return;
+    }
+    if (!first_timestamp_.isValid())
+    {
+        first_timestamp_ = QDateTime::fromMSecsSinceEpoch(first_ms);
+        LOG_INFO("first timestamp recorded {}", first_timestamp_.toString("hh:mm:ss").toStdString());
+    }
+
+    qint64 total_duration = first_timestamp_.secsTo(QDateTime::currentDateTime());
+    if (total_duration > kHistoryDurationSecs)
+    {
+        LOG_INFO("sufficient data collected {}s > {}s enabling chart dragging", total_duration, kHistoryDurationSecs);
+        chart_view_->set_drag_enabled(true);
+        drag_enabled_ = true;
+    }
+}
+
 void dns_page::setup_chart()
 {
     chart_ = new QChart();
@@ -138,7 +231,23 @@ void dns_page::on_refresh_timer_timeout()
     {
         return;
     }
-    request_data_for_current_view();
+    // the chart follows handle_dns_rates, only the domain list still comes from storage
+    request_live_domains();
+}
+
+void dns_page::request_live_domains()
+{
+    current_domains_request_id_++;
+    const QDateTime end_time = QDateTime::currentDateTime();
+    const QDateTime start_time = end_time.addSecs(-kHistoryDurationSecs);
+    emit request_all_domains(current_domains_request_id_, start_time.toMSecsSinceEpoch(), end_time.toMSecsSinceEpoch());
+    request_breakdown(start_time.toMSecsSinceEpoch(), end_time.toMSecsSinceEpoch());
+}
+
+void dns_page::request_breakdown(qint64 start_ms, qint64 end_ms)
+{
+    current_breakdown_request_id_++;
+    emit request_dns_breakdown(current_breakdown_request_id_, start_ms, end_ms);
 }
 
 void dns_page::request_data_for_current_view()
@@ -160,8 +269,10 @@ void dns_page::request_data_for_current_view()
         start_time = end_time.addSecs(-kHistoryDurationSecs);
     }
 
-    emit request_qps_stats(current_request_id_, start_time, end_time, kChartIntervalSecs);
-    emit request_all_domains(current_request_id_, start_time, end_time);
+    current_domains_request_id_++;
+    emit request_qps_stats(current_request_id_, start_time.toMSecsSinceEpoch(), end_time.toMSecsSinceEpoch(), kChartIntervalSecs);
+    emit request_all_domains(current_domains_request_id_, start_time.toMSecsSinceEpoch(), end_time.toMSecsSinceEpoch());
+    request_breakdown(start_time.toMSecsSinceEpoch(), end_time.toMSecsSinceEpoch());
 }
 
 void dns_page::handle_qps_stats_ready(quint64 request_id, const QList<QPointF>& data)
@@ -173,21 +284,9 @@ void dns_page::handle_qps_stats_ready(quint64 request_id, const QList<QPointF>&
     }
     LOG_DEBUG("received qps stats ready for id {} data points from db {}", request_id, data.size());
 
-    if (!drag_enabled_ && !data.isEmpty())
+    if (!data.isEmpty())
     {
-        if (!first_timestamp_.isValid())
-        {
-            first_timestamp_ = QDateTime::fromMSecsSinceEpoch(static_cast<qint64>(data.first().x()));
-            LOG_INFO("first timestamp recorded {}", first_timestamp_.toString("hh:mm:ss").toStdString());
-        }
-
-        qint64 total_duration = first_timestamp_.secsTo(QDateTime::currentDateTime());
-        if (total_duration > kHistoryDurationSecs)
-        {
-            LOG_INFO("sufficient data collected {}s > {}s enabling chart dragging", total_duration, kHistoryDurationSecs);
-            chart_view_->set_drag_enabled(true);
-            drag_enabled_ = true;
-        }
+        track_history_span(static_cast<qint64>(data.first().x()));
     }
 
     QMap<qint64, qreal> data_map;
@@ -214,6 +313,7 @@ void dns_page::handle_qps_stats_ready(quint64 request_id, const QList<QPointF>&
     }
 
     qps_series_->replace(full_data);
+    live_from_ms_ = full_data.isEmpty() ? 0 : static_cast<qint64>(full_data.last().x()) + interval_msecs;
 
     if (!is_manual_view_active_)
     {
@@ -223,7 +323,7 @@ void dns_page::handle_qps_stats_ready(quint64 request_id, const QList<QPointF>&
 
 void dns_page::handle_all_domains_ready(quint64 request_id, const QStringList& domains)
 {
-    if (request_id != current_request_id_)
+    if (request_id != current_domains_request_id_)
     {
         return;
     }
@@ -275,7 +375,7 @@ void dns_page::handle_dns_details_ready(quint64 request_id, const QList<dns_quer
     {
         const auto& info = details[i];
         QList<QStandardItem*> row_items;
-        row_items.append(new QStandardItem(info.timestamp.toString("yyyy-MM-dd hh:mm:ss.zzz")));
+        row_items.append(new QStandardItem(QDateTime::fromMSecsSinceEpoch(info.timestamp.realtime_ms).toString("yyyy-MM-dd hh:mm:ss.zzz")));
 
         bool is_request = (info.direction == dns_query_info::packet_direction::kRequest);
         row_items.append(new QStandardItem(is_request ? "请求" : "响应"));
@@ -305,6 +405,37 @@ void dns_page::handle_dns_details_ready(quint64 request_id, const QList<dns_quer
     }
 }
 
+// the most frequent entries first, e.g. "A 120 AAAA 80"
+static QString top_entries(const QMap<QString, qint64>& counts)
+{
+    QList<QPair<qint64, QString>> entries;
+    for (auto it = counts.cbegin(); it != counts.cend(); ++it)
+    {
+        entries.append(qMakePair(it.value(), it.key().isEmpty() ? QString("—") : it.key()));
+    }
+    std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+    QStringList parts;
+    for (qsizetype i = 0; i < std::min<qsizetype>(entries.size(), kBreakdownTopEntries); ++i)
+    {
+        parts.append(QString("%1 %2").arg(entries[i].second).arg(entries[i].first));
+    }
+    return parts.join(" ");
+}
+
+void dns_page::handle_dns_breakdown_ready(quint64 request_id, const dns_breakdown& breakdown)
+{
+    if (request_id != current_breakdown_request_id_)
+    {
+        return;
+    }
+    LOG_DEBUG("received dns breakdown for id {} requests {} responses {}", request_id, breakdown.requests, breakdown.responses);
+    breakdown_label_->setText(QString("当前范围 请求 %1 响应 %2 | 类型 %3 | 响应码 %4")
+                                  .arg(breakdown.requests)
+                                  .arg(breakdown.responses)
+                                  .arg(top_entries(breakdown.query_types))
+                                  .arg(top_entries(breakdown.response_codes)));
+}
+
 void dns_page::handle_series_hovered(const QPointF& point, bool state)
 {
     if (!state || tooltip_ == nullptr)
@@ -387,5 +518,5 @@ void dns_page::on_domain_selected(const QModelIndex& current, const QModelIndex&
         start_time = end_time.addSecs(-kHistoryDurationSecs);
     }
 
-    emit request_dns_details_for_domain(current_details_request_id_, domain, start_time, end_time);
+    emit request_dns_details_for_domain(current_details_request_id_, domain, start_time.toMSecsSinceEpoch(), end_time.toMSecsSinceEpoch());
 }
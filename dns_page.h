@@ -12,8 +12,11 @@
 #include <QModelIndex>
 #include "draggable_chart_view.h"
 #include "dns_query_info.h"
+#include "dns_rate_sample.h"
+#include "dns_breakdown.h"
 
 class QChart;
+class QLabel;
 class QTimer;
 class QLineSeries;
 class QDateTimeAxis;
@@ -29,14 +32,20 @@ class dns_page : public QWidget
     explicit dns_page(QWidget* parent = nullptr);
 
    signals:
-    void request_qps_stats(quint64 request_id, const QDateTime& start, const QDateTime& end, int interval_secs);
-    void request_all_domains(quint64 request_id, const QDateTime& start, const QDateTime& end);
-    void request_dns_details_for_domain(quint64 request_id, const QString& domain, const QDateTime& start, const QDateTime& end);
+    void request_qps_stats(quint64 request_id, qint64 start_ms, qint64 end_ms, int interval_secs);
+    void request_all_domains(quint64 request_id, qint64 start_ms, qint64 end_ms);
+    void request_dns_details_for_domain(quint64 request_id, const QString& domain, qint64 start_ms, qint64 end_ms);
+    void request_dns_breakdown(quint64 request_id, qint64 start_ms, qint64 end_ms);
 
    public slots:
     void handle_qps_stats_ready(quint64 request_id, const QList<QPointF>& data);
     void handle_all_domains_ready(quint64 request_id, const QStringList& domains);
     void handle_dns_details_ready(quint64 request_id, const QList<dns_query_info>& details);
+    void handle_dns_breakdown_ready(quint64 request_id, const dns_breakdown& breakdown);
+    // aggregated per stored batch, individual messages never reach the gui thread
+    void handle_dns_logs_stored(quint64 stored_total, quint64 dropped_total);
+    // extends the live chart straight from the capture counters
+    void handle_dns_rates(const dns_rate_sample& sample);
     void trigger_initial_load();
 
    private slots:
@@ -52,6 +61,9 @@ class dns_page : public QWidget
     void setup_chart();
     void update_chart_axes(const QDateTime& start, const QDateTime& end);
     void request_data_for_current_view();
+    void request_live_domains();
+    void request_breakdown(qint64 start_ms, qint64 end_ms);
+    void track_history_span(qint64 first_ms);
 
    private:
     draggable_chartview* chart_view_ = nullptr;
@@ -60,6 +72,9 @@ class dns_page : public QWidget
     QDateTimeAxis* axis_x_ = nullptr;
     QValueAxis* axis_y_ = nullptr;
     QGraphicsSimpleTextItem* tooltip_ = nullptr;
+    QLabel* capture_status_label_ = nullptr;
+    QLabel* live_rate_label_ = nullptr;
+    QLabel* breakdown_label_ = nullptr;
 
     QSplitter* splitter_ = nullptr;
 
@@ -72,7 +87,12 @@ class dns_page : public QWidget
     QTimer* refresh_timer_ = nullptr;
     QTimer* snap_back_timer_ = nullptr;
     quint64 current_request_id_ = 0;
+    // the live view refreshes the domain list on its own, so it counts separately from the chart
+    quint64 current_domains_request_id_ = 0;
     quint64 current_details_request_id_ = 0;
+    quint64 current_breakdown_request_id_ = 0;
+    // end of the newest bucket the last qps reply filled, live samples up to it are already counted there
+    qint64 live_from_ms_ = 0;
     bool drag_enabled_ = false;
     bool is_manual_view_active_ = false;
     QDateTime first_timestamp_;
@@ -0,0 +1,60 @@
+#include <arpa/inet.h>
+#include "dns_query_info.h"
+
+static QString format_address(std::string_view address)
+{
+    char text[INET6_ADDRSTRLEN] = {};
+    if (address.size() != 4 && address.size() != 16)
+    {
+        return {};
+    }
+    if (inet_ntop(address.size() == 4 ? AF_INET : AF_INET6, address.data(), text, sizeof(text)) == nullptr)
+    {
+        return {};
+    }
+    return QString::fromLatin1(text);
+}
+
+void pack_dns_address(std::string& packed, std::string_view address)
+{
+    const bool valid = address.size() == 4 || address.size() == 16;
+    packed.push_back(static_cast<char>(valid ? address.size() : 0));
+    if (valid)
+    {
+        packed.append(address);
+    }
+}
+
+void format_dns_addresses(dns_query_info& info)
+{
+    if (info.wire_addresses.empty())
+    {
+        return;
+    }
+    std::string_view packed(info.wire_addresses);
+    auto format_next = [&packed](QString& text)
+    {
+        if (packed.empty())
+        {
+            return;
+        }
+        const auto length = static_cast<size_t>(static_cast<uint8_t>(packed.front()));
+        packed.remove_prefix(1);
+        if (length > packed.size())
+        {
+            packed = {};
+            return;
+        }
+        if (length > 0)
+        {
+            text = format_address(packed.substr(0, length));
+        }
+        packed.remove_prefix(length);
+    };
+    format_next(info.resolver_ip);
+    for (QString& answer : info.response_data)
+    {
+        format_next(answer);
+    }
+    std::string().swap(info.wire_addresses);
+}
@@ -1,9 +1,11 @@
 #ifndef DNS_QUERY_INFO_H
 #define DNS_QUERY_INFO_H
 
-#include <QDateTime>
+#include <string>
+#include <string_view>
 #include <QString>
 #include <QStringList>
+#include "sample_clock.h"
 
 struct dns_query_info
 {
@@ -13,7 +15,7 @@ struct dns_query_info
         kResponse
     };
 
-    QDateTime timestamp;
+    sample_time timestamp;
     quint16 transaction_id;
     packet_direction direction;
     QString query_domain;
@@ -21,8 +23,16 @@ struct dns_query_info
     QString response_code;
     QStringList response_data;
     QString resolver_ip;
+    // the capture threads leave addresses in binary here instead of formatting them, the resolver first and
+    // then one entry per response_data item, each a length byte of 4, 16 or 0 for an item that is already text
+    std::string wire_addresses;
 };
 
+// appends one wire_addresses entry, an address that is not 4 or 16 bytes long is packed as 0
+void pack_dns_address(std::string& packed, std::string_view address);
+// fills resolver_ip and the address items of response_data from wire_addresses and clears it, run by the writer
+void format_dns_addresses(dns_query_info& info);
+
 Q_DECLARE_METATYPE(dns_query_info::packet_direction)
 Q_DECLARE_METATYPE(dns_query_info)
 
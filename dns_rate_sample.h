@@ -0,0 +1,21 @@
+#ifndef DNS_RATE_SAMPLE_H
+#define DNS_RATE_SAMPLE_H
+
+#include <QMetaType>
+#include <QtGlobal>
+
+// messages counted by the capture threads since the previous sample, published once a second so the
+// live dns chart never waits for the database
+struct dns_rate_sample
+{
+    // realtime end of the counted interval
+    qint64 timestamp_ms = 0;
+    quint32 requests = 0;
+    quint32 responses = 0;
+    quint32 nxdomain = 0;
+    quint32 servfail = 0;
+};
+
+Q_DECLARE_METATYPE(dns_rate_sample)
+
+#endif
@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <QMap>
+#include "dns_recent_store.h"
+
+quint32 dns_recent_store::intern(QStringList& values, QHash<QString, quint32>& index, const QString& value)
+{
+    const auto it = index.constFind(value);
+    if (it != index.constEnd())
+    {
+        return it.value();
+    }
+    const auto id = static_cast<quint32>(values.size());
+    values.append(value);
+    index.insert(value, id);
+    return id;
+}
+
+void dns_recent_store::append(const dns_query_info& info)
+{
+    if (chunks_.empty() || static_cast<qsizetype>(chunks_.back().timestamps.size()) >= kChunkEvents)
+    {
+        chunks_.emplace_back();
+        chunks_.back().min_ms = info.timestamp.realtime_ms;
+        chunks_.back().max_ms = info.timestamp.realtime_ms;
+    }
+    chunk& tail = chunks_.back();
+    tail.min_ms = std::min(tail.min_ms, info.timestamp.realtime_ms);
+    tail.max_ms = std::max(tail.max_ms, info.timestamp.realtime_ms);
+    tail.timestamps.push_back(info.timestamp.realtime_ms);
+    tail.transaction_ids.push_back(info.transaction_id);
+    tail.directions.push_back(info.direction);
+    tail.domain_ids.push_back(intern(tail.domains, tail.domain_index, info.query_domain));
+    tail.type_ids.push_back(intern(tail.labels, tail.label_index, info.query_type));
+    tail.rcode_ids.push_back(intern(tail.labels, tail.label_index, info.response_code));
+    tail.resolver_ids.push_back(intern(tail.labels, tail.label_index, info.resolver_ip));
+    tail.response_data.push_back(info.response_data.join(", "));
+    events_++;
+}
+
+void dns_recent_store::evict(qint64 cutoff_ms, qsizetype max_events)
+{
+    // the chunk being filled stays even when it is old, otherwise every append would start a new one
+    while (chunks_.size() > 1 && (chunks_.front().max_ms < cutoff_ms || events_ > max_events))
+    {
+        covered_from_ms_ = std::max(covered_from_ms_, chunks_.front().max_ms + 1);
+        events_ -= static_cast<qsizetype>(chunks_.front().timestamps.size());
+        chunks_.pop_front();
+    }
+}
+
+QList<QPointF> dns_recent_store::qps(qint64 start_ms, qint64 end_ms, qint64 interval_ms) const
+{
+    QMap<qint64, qint64> counts;
+    for (const chunk& part : chunks_)
+    {
+        if (!part.overlaps(start_ms, end_ms))
+        {
+            continue;
+        }
+        for (size_t i = 0; i < part.timestamps.size(); ++i)
+        {
+            const qint64 ms = part.timestamps[i];
+            if (ms >= start_ms && ms <= end_ms && part.directions[i] == dns_query_info::packet_direction::kRequest)
+            {
+                counts[(ms / interval_ms) * interval_ms]++;
+            }
+        }
+    }
+    QList<QPointF> results;
+    results.reserve(counts.size());
+    for (auto it = counts.cbegin(); it != counts.cend(); ++it)
+    {
+        results.append(QPointF(static_cast<qreal>(it.key()), static_cast<qreal>(it.value())));
+    }
+    return results;
+}
+
+QStringList dns_recent_store::domains(qint64 start_ms, qint64 end_ms) const
+{
+    QStringList results;
+    std::vector<bool> seen;
+    for (const chunk& part : chunks_)
+    {
+        if (!part.overlaps(start_ms, end_ms))
+        {
+            continue;
+        }
+        // a chunk wholly inside the window contributes its dictionary without looking at a single event
+        if (part.inside(start_ms, end_ms))
+        {
+            results.append(part.domains);
+            continue;
+        }
+        seen.assign(static_cast<size_t>(part.domains.size()), false);
+        for (size_t i = 0; i < part.timestamps.size(); ++i)
+        {
+            if (part.timestamps[i] >= start_ms && part.timestamps[i] <= end_ms)
+            {
+                seen[part.domain_ids[i]] = true;
+            }
+        }
+        for (size_t id = 0; id < seen.size(); ++id)
+        {
+            if (seen[id])
+            {
+                results.append(part.domains[static_cast<qsizetype>(id)]);
+            }
+        }
+    }
+    results.sort();
+    results.removeDuplicates();
+    return results;
+}
+
+QList<dns_query_info> dns_recent_store::details(const QString& domain, qint64 start_ms, qint64 end_ms) const
+{
+    QList<dns_query_info> results;
+    for (const chunk& part : chunks_)
+    {
+        const auto id = part.domain_index.constFind(domain);
+        if (!part.overlaps(start_ms, end_ms) || id == part.domain_index.constEnd())
+        {
+            continue;
+        }
+        for (size_t i = 0; i < part.timestamps.size(); ++i)
+        {
+            if (part.domain_ids[i] != id.value() || part.timestamps[i] < start_ms || part.timestamps[i] > end_ms)
+            {
+                continue;
+            }
+            dns_query_info info;
+            info.timestamp.realtime_ms = part.timestamps[i];
+            info.transaction_id = part.transaction_ids[i];
+            info.direction = part.directions[i];
+            info.query_domain = domain;
+            info.query_type = part.labels[part.type_ids[i]];
+            info.response_code = part.labels[part.rcode_ids[i]];
+            info.response_data = part.response_data[i].split(", ", Qt::SkipEmptyParts);
+            info.resolver_ip = part.labels[part.resolver_ids[i]];
+            results.append(info);
+        }
+    }
+    std::stable_sort(results.begin(),
+                     results.end(),
+                     [](const dns_query_info& a, const dns_query_info& b) { return a.timestamp.realtime_ms > b.timestamp.realtime_ms; });
+    return results;
+}
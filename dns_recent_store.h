@@ -0,0 +1,67 @@
+#ifndef DNS_RECENT_STORE_H
+#define DNS_RECENT_STORE_H
+
+#include <deque>
+#include <vector>
+#include <QHash>
+#include <QList>
+#include <QPointF>
+#include <QStringList>
+#include "dns_query_info.h"
+
+// the last minutes of dns events in memory, in time ordered chunks of columns with a domain dictionary per
+// chunk, so the dns page refresh is answered without a GROUP BY or DISTINCT over dns_logs
+class dns_recent_store
+{
+   public:
+    static constexpr qsizetype kChunkEvents = 4096;
+
+    // events from covered_from_ms on are all held, older ones may only be in sqlite
+    explicit dns_recent_store(qint64 covered_from_ms = 0) : covered_from_ms_(covered_from_ms) {}
+
+    void append(const dns_query_info& info);
+    // drops whole chunks that end before cutoff_ms, then the oldest chunks until at most max_events remain
+    void evict(qint64 cutoff_ms, qsizetype max_events);
+
+    bool covers(qint64 start_ms) const { return start_ms >= covered_from_ms_; }
+    qsizetype size() const { return events_; }
+
+    // requests per interval_ms bucket in [start_ms, end_ms], same buckets as the dns_logs query
+    QList<QPointF> qps(qint64 start_ms, qint64 end_ms, qint64 interval_ms) const;
+    // sorted distinct domains seen in [start_ms, end_ms]
+    QStringList domains(qint64 start_ms, qint64 end_ms) const;
+    // events for domain in [start_ms, end_ms], newest first
+    QList<dns_query_info> details(const QString& domain, qint64 start_ms, qint64 end_ms) const;
+
+   private:
+    struct chunk
+    {
+        qint64 min_ms = 0;
+        qint64 max_ms = 0;
+        std::vector<qint64> timestamps;
+        std::vector<quint16> transaction_ids;
+        std::vector<dns_query_info::packet_direction> directions;
+        std::vector<quint32> domain_ids;
+        std::vector<quint32> type_ids;
+        std::vector<quint32> rcode_ids;
+        std::vector<quint32> resolver_ids;
+        std::vector<QString> response_data;
+        // domains and the short repeated labels each get their own dictionary
+        QStringList domains;
+        QHash<QString, quint32> domain_index;
+        QStringList labels;
+        QHash<QString, quint32> label_index;
+
+        bool inside(qint64 start_ms, qint64 end_ms) const { return min_ms >= start_ms && max_ms <= end_ms; }
+        bool overlaps(qint64 start_ms, qint64 end_ms) const { return max_ms >= start_ms && min_ms <= end_ms; }
+    };
+
+    static quint32 intern(QStringList& values, QHash<QString, quint32>& index, const QString& value);
+
+    // events may arrive slightly out of order, each chunk keeps its own time bounds
+    std::deque<chunk> chunks_;
+    qsizetype events_ = 0;
+    qint64 covered_from_ms_;
+};
+
+#endif
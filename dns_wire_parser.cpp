@@ -0,0 +1,351 @@
+#include "dns_wire_parser.h"
+
+static constexpr uint16_t kEtherTypeIpv4 = 0x0800;
+static constexpr uint16_t kEtherTypeIpv6 = 0x86dd;
+static constexpr uint16_t kEtherTypeVlan = 0x8100;
+static constexpr uint16_t kEtherTypeQinQ = 0x88a8;
+static constexpr size_t kEthernetHeaderSize = 14;
+static constexpr size_t kVlanTagSize = 4;
+static constexpr size_t kMaxVlanTags = 2;
+static constexpr size_t kLinuxSllHeaderSize = 16;
+
+static constexpr uint8_t kProtocolTcp = 6;
+static constexpr uint8_t kProtocolUdp = 17;
+static constexpr uint8_t kIpv6HopByHop = 0;
+static constexpr uint8_t kIpv6Routing = 43;
+static constexpr uint8_t kIpv6Fragment = 44;
+static constexpr uint8_t kIpv6DestinationOptions = 60;
+static constexpr size_t kMaxIpv6ExtensionHeaders = 4;
+
+static constexpr uint16_t kDnsPort = 53;
+static constexpr size_t kDnsHeaderSize = 12;
+static constexpr int kMaxPointerHops = 32;
+
+static constexpr uint16_t kDnsTypeA = 1;
+static constexpr uint16_t kDnsTypeNs = 2;
+static constexpr uint16_t kDnsTypeCname = 5;
+static constexpr uint16_t kDnsTypePtr = 12;
+static constexpr uint16_t kDnsTypeAaaa = 28;
+
+static uint16_t read_u16(const uint8_t* data) { return static_cast<uint16_t>((data[0] << 8) | data[1]); }
+
+static std::string_view bytes_view(const uint8_t* data, size_t length) { return {reinterpret_cast<const char*>(data), length}; }
+
+// decodes the possibly compressed name at offset into dotted form, offset ends after the name as it appears in place
+static bool read_name(const uint8_t* message, size_t length, size_t& offset, char* out, size_t& out_length)
+{
+    out_length = 0;
+    size_t cursor = offset;
+    bool jumped = false;
+    for (int hops = 0;;)
+    {
+        if (cursor >= length)
+        {
+            return false;
+        }
+        const uint8_t label_length = message[cursor];
+        if (label_length == 0)
+        {
+            if (!jumped)
+            {
+                offset = cursor + 1;
+            }
+            return true;
+        }
+
+        if ((label_length & 0xc0) == 0xc0)
+        {
+            if (cursor + 1 >= length || ++hops > kMaxPointerHops)
+            {
+                return false;
+            }
+            if (!jumped)
+            {
+                offset = cursor + 2;
+                jumped = true;
+            }
+            cursor = static_cast<size_t>(read_u16(message + cursor) & 0x3fff);
+            continue;
+        }
+        if ((label_length & 0xc0) != 0)
+        {
+            return false;
+        }
+
+        const size_t separator = out_length == 0 ? 0 : 1;
+        if (cursor + 1 + label_length > length || out_length + separator + label_length > kMaxDnsNameLength)
+        {
+            return false;
+        }
+        if (separator != 0)
+        {
+            out[out_length++] = '.';
+        }
+        for (size_t i = 0; i < label_length; ++i)
+        {
+            out[out_length++] = static_cast<char>(message[cursor + 1 + i]);
+        }
+        cursor += 1 + label_length;
+    }
+}
+
+static bool skip_name(const uint8_t* message, size_t length, size_t& offset)
+{
+    while (offset < length)
+    {
+        const uint8_t label_length = message[offset];
+        if (label_length == 0)
+        {
+            offset += 1;
+            return true;
+        }
+        if ((label_length & 0xc0) == 0xc0)
+        {
+            offset += 2;
+            return offset <= length;
+        }
+        if ((label_length & 0xc0) != 0)
+        {
+            return false;
+        }
+        offset += 1 + label_length;
+    }
+    return false;
+}
+
+dns_parse_result dns_wire_parser::parse_frame(
+    const uint8_t* data, size_t length, dns_link_type link_type, dns_name_table& names, dns_wire_message& message)
+{
+    size_t offset = 0;
+    uint16_t ether_type = 0;
+    switch (link_type)
+    {
+        case dns_link_type::kEthernet:
+            if (length < kEthernetHeaderSize)
+            {
+                return dns_parse_result::kNotDns;
+            }
+            ether_type = read_u16(data + 12);
+            offset = kEthernetHeaderSize;
+            for (size_t tags = 0; tags < kMaxVlanTags && (ether_type == kEtherTypeVlan || ether_type == kEtherTypeQinQ); ++tags)
+            {
+                if (offset + kVlanTagSize > length)
+                {
+                    return dns_parse_result::kNotDns;
+                }
+                ether_type = read_u16(data + offset + 2);
+                offset += kVlanTagSize;
+            }
+            break;
+        case dns_link_type::kLinuxSll:
+            if (length < kLinuxSllHeaderSize)
+            {
+                return dns_parse_result::kNotDns;
+            }
+            ether_type = read_u16(data + 14);
+            offset = kLinuxSllHeaderSize;
+            break;
+        case dns_link_type::kRawIp:
+            if (length < 1)
+            {
+                return dns_parse_result::kNotDns;
+            }
+            ether_type = (data[0] >> 4) == 6 ? kEtherTypeIpv6 : kEtherTypeIpv4;
+            break;
+    }
+
+    uint8_t protocol = 0;
+    size_t ip_end = length;
+    if (ether_type == kEtherTypeIpv4)
+    {
+        if (offset + 20 > length || (data[offset] >> 4) != 4)
+        {
+            return dns_parse_result::kNotDns;
+        }
+        const size_t header_length = static_cast<size_t>(data[offset] & 0x0f) * 4;
+        const size_t total_length = read_u16(data + offset + 2);
+        // later fragments carry no transport header
+        if (header_length < 20 || (read_u16(data + offset + 6) & 0x1fff) != 0)
+        {
+            return dns_parse_result::kNotDns;
+        }
+        protocol = data[offset + 9];
+        message.source_address = bytes_view(data + offset + 12, 4);
+        message.destination_address = bytes_view(data + offset + 16, 4);
+        // the capture may pad short frames past the ip payload
+        if (total_length >= header_length && offset + total_length < length)
+        {
+            ip_end = offset + total_length;
+        }
+        offset += header_length;
+    }
+    else if (ether_type == kEtherTypeIpv6)
+    {
+        if (offset + 40 > length || (data[offset] >> 4) != 6)
+        {
+            return dns_parse_result::kNotDns;
+        }
+        const size_t payload_length = read_u16(data + offset + 4);
+        protocol = data[offset + 6];
+        message.source_address = bytes_view(data + offset + 8, 16);
+        message.destination_address = bytes_view(data + offset + 24, 16);
+        if (offset + 40 + payload_length < length)
+        {
+            ip_end = offset + 40 + payload_length;
+        }
+        offset += 40;
+        for (size_t headers = 0; headers < kMaxIpv6ExtensionHeaders; ++headers)
+        {
+            if (protocol != kIpv6HopByHop && protocol != kIpv6Routing && protocol != kIpv6DestinationOptions)
+            {
+                break;
+            }
+            if (offset + 8 > ip_end)
+            {
+                return dns_parse_result::kNotDns;
+            }
+            protocol = data[offset];
+            offset += (static_cast<size_t>(data[offset + 1]) + 1) * 8;
+        }
+        if (protocol == kIpv6Fragment)
+        {
+            return dns_parse_result::kNotDns;
+        }
+    }
+    else
+    {
+        return dns_parse_result::kNotDns;
+    }
+
+    if (protocol == kProtocolUdp)
+    {
+        if (offset + 8 > ip_end)
+        {
+            return dns_parse_result::kNotDns;
+        }
+        if (read_u16(data + offset) != kDnsPort && read_u16(data + offset + 2) != kDnsPort)
+        {
+            return dns_parse_result::kNotDns;
+        }
+        offset += 8;
+    }
+    else if (protocol == kProtocolTcp)
+    {
+        if (offset + 20 > ip_end)
+        {
+            return dns_parse_result::kNotDns;
+        }
+        if (read_u16(data + offset) != kDnsPort && read_u16(data + offset + 2) != kDnsPort)
+        {
+            return dns_parse_result::kNotDns;
+        }
+        const size_t header_length = static_cast<size_t>(data[offset + 12] >> 4) * 4;
+        if (header_length < 20)
+        {
+            return dns_parse_result::kNotDns;
+        }
+        // dns over tcp prefixes every message with its length
+        offset += header_length + 2;
+    }
+    else
+    {
+        return dns_parse_result::kNotDns;
+    }
+
+    if (offset + kDnsHeaderSize > ip_end)
+    {
+        return dns_parse_result::kNotDns;
+    }
+    return parse_message(data + offset, ip_end - offset, names, message);
+}
+
+dns_parse_result dns_wire_parser::parse_message(const uint8_t* data, size_t length, dns_name_table& names, dns_wire_message& message)
+{
+    if (length < kDnsHeaderSize)
+    {
+        return dns_parse_result::kNotDns;
+    }
+
+    const uint16_t flags = read_u16(data + 2);
+    message.transaction_id = read_u16(data);
+    message.is_response = (flags & 0x8000) != 0;
+    message.response_code = static_cast<uint8_t>(flags & 0x000f);
+    message.answer_count = 0;
+    message.query_name = kInvalidNameHandle;
+
+    const uint16_t question_count = read_u16(data + 4);
+    const uint16_t answer_count = read_u16(data + 6);
+    if (question_count == 0)
+    {
+        return dns_parse_result::kNotDns;
+    }
+
+    size_t offset = kDnsHeaderSize;
+    if (!read_name(data, length, offset, message.query_name_text, message.query_name_length) || offset + 4 > length)
+    {
+        return dns_parse_result::kMalformed;
+    }
+    message.query_name = names.intern(std::string_view(message.query_name_text, message.query_name_length));
+    message.query_type = read_u16(data + offset);
+    offset += 4;
+
+    for (uint16_t i = 1; i < question_count; ++i)
+    {
+        if (!skip_name(data, length, offset) || offset + 4 > length)
+        {
+            return dns_parse_result::kOk;
+        }
+        offset += 4;
+    }
+
+    // a truncated answer section ends the walk but keeps what was decoded so far
+    for (uint16_t i = 0; i < answer_count && message.answer_count < kMaxDnsAnswers; ++i)
+    {
+        if (!skip_name(data, length, offset) || offset + 10 > length)
+        {
+            break;
+        }
+        const uint16_t type = read_u16(data + offset);
+        const size_t data_length = read_u16(data + offset + 8);
+        offset += 10;
+        if (offset + data_length > length)
+        {
+            break;
+        }
+
+        dns_wire_answer& answer = message.answers[message.answer_count];
+        answer.type = type;
+        answer.name = kInvalidNameHandle;
+        answer.address = {};
+        switch (type)
+        {
+            case kDnsTypeA:
+            case kDnsTypeAaaa:
+                if (data_length != (type == kDnsTypeA ? 4U : 16U))
+                {
+                    return dns_parse_result::kMalformed;
+                }
+                answer.address = bytes_view(data + offset, data_length);
+                break;
+            case kDnsTypeCname:
+            case kDnsTypeNs:
+            case kDnsTypePtr:
+            {
+                char name[kMaxDnsNameLength + 1];
+                size_t name_length = 0;
+                size_t name_offset = offset;
+                if (!read_name(data, length, name_offset, name, name_length))
+                {
+                    return dns_parse_result::kMalformed;
+                }
+                answer.name = names.intern(std::string_view(name, name_length));
+                break;
+            }
+            default:
+                break;
+        }
+        message.answer_count++;
+        offset += data_length;
+    }
+    return dns_parse_result::kOk;
+}
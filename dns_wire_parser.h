@@ -0,0 +1,62 @@
+#ifndef DNS_WIRE_PARSER_H
+#define DNS_WIRE_PARSER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include "dns_name_table.h"
+
+static constexpr size_t kMaxDnsAnswers = 16;
+static constexpr size_t kMaxDnsNameLength = 255;
+
+enum class dns_link_type : uint8_t
+{
+    kEthernet,
+    kRawIp,
+    kLinuxSll
+};
+
+enum class dns_parse_result : uint8_t
+{
+    kOk,
+    kNotDns,
+    kMalformed
+};
+
+struct dns_wire_answer
+{
+    uint16_t type = 0;
+    // CNAME NS and PTR targets
+    uint32_t name = kInvalidNameHandle;
+    // A and AAAA rdata, points into the frame
+    std::string_view address;
+};
+
+// everything except interned names points into the frame and is only valid while the frame is
+struct dns_wire_message
+{
+    uint16_t transaction_id = 0;
+    bool is_response = false;
+    uint8_t response_code = 0;
+    uint16_t query_type = 0;
+    uint32_t query_name = kInvalidNameHandle;
+    // decoded copy of the question name
+    char query_name_text[kMaxDnsNameLength + 1] = {};
+    size_t query_name_length = 0;
+    std::string_view source_address;
+    std::string_view destination_address;
+    uint8_t answer_count = 0;
+    dns_wire_answer answers[kMaxDnsAnswers];
+};
+
+// parses Ethernet/VLAN, IPv4/IPv6, UDP/TCP port 53 and the DNS header, first question and
+// answers in place, only names are copied because compressed names are not contiguous on the wire
+class dns_wire_parser
+{
+   public:
+    static dns_parse_result parse_frame(
+        const uint8_t* data, size_t length, dns_link_type link_type, dns_name_table& names, dns_wire_message& message);
+    static dns_parse_result parse_message(const uint8_t* data, size_t length, dns_name_table& names, dns_wire_message& message);
+};
+
+#endif
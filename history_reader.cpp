@@ -0,0 +1,689 @@
+#include <algorithm>
+#include <limits>
+#include <QMap>
+#include <QThread>
+
+#include "log.h"
+#include "scoped_exit.h"
+#include "traffic_block.h"
+#include "history_reader.h"
+
+namespace
+{
+struct dns_breakdown_registrar
+{
+    dns_breakdown_registrar() { qRegisterMetaType<dns_breakdown>("dns_breakdown"); }
+};
+dns_breakdown_registrar registrar;
+}    // namespace
+
+traffic_point read_traffic_point(const sqlite_statement& stmt, int first_column)
+{
+    traffic_point point;
+    point.timestamp_ms = stmt.column_int64(first_column);
+    quint64* counters[] = {&point.bytes_received,
+                           &point.bytes_sent,
+                           &point.rx_packets,
+                           &point.tx_packets,
+                           &point.rx_errors,
+                           &point.tx_errors,
+                           &point.rx_dropped,
+                           &point.tx_dropped,
+                           &point.rx_fifo_errors,
+                           &point.tx_fifo_errors,
+                           &point.multicast};
+    int column = first_column + 1;
+    for (quint64* counter : counters)
+    {
+        *counter = static_cast<quint64>(stmt.column_int64(column++));
+    }
+    return point;
+}
+
+// the envelope follows interface_id and the TRAFFIC_POINT_COLUMNS in the rollup queries
+static constexpr int kRateEnvelopeColumn = 13;
+
+static rate_envelope read_rate_envelope(const sqlite_statement& stmt, int first_column)
+{
+    rate_envelope envelope;
+    envelope.rx_min = stmt.column_double(first_column);
+    envelope.rx_max = stmt.column_double(first_column + 1);
+    envelope.tx_min = stmt.column_double(first_column + 2);
+    envelope.tx_max = stmt.column_double(first_column + 3);
+    return envelope;
+}
+
+// sorts a merge of rows and blocks and keeps only the newest point before start_ms, which seeds the first rate
+static void keep_latest_before(QList<traffic_point>& points, qint64 start_ms)
+{
+    auto by_time = [](const traffic_point& a, const traffic_point& b) { return a.timestamp_ms < b.timestamp_ms; };
+    if (!std::is_sorted(points.begin(), points.end(), by_time))
+    {
+        // rows and blocks interleave when the storage format was switched within the range
+        std::stable_sort(points.begin(), points.end(), by_time);
+    }
+    const auto first_in_range =
+        std::find_if(points.begin(), points.end(), [start_ms](const traffic_point& p) { return p.timestamp_ms >= start_ms; });
+    const qsizetype before_count = first_in_range - points.begin();
+    if (before_count > 1)
+    {
+        points.erase(points.begin(), points.begin() + (before_count - 1));
+    }
+}
+
+// statements check for a newer request this often, cheap next to the row work in between
+static constexpr int kInterruptCheckInstructions = 1000;
+
+history_reader::history_reader(QString db_path, QString partition_dir, std::shared_ptr<query_generations> generations, QObject* parent)
+    : QObject(parent), db_path_(std::move(db_path)), partition_dir_(std::move(partition_dir)), generations_(std::move(generations))
+{
+}
+
+history_reader::~history_reader()
+{
+    partitions_.close();
+    db_.close();
+}
+
+bool history_reader::ensure_open()
+{
+    if (!db_.is_open())
+    {
+        if (!db_.open(db_path_, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX) || !partitions_.open(partition_dir_, true))
+        {
+            LOG_ERROR("history reader cannot open {} read only {}", db_path_.toStdString(), db_.last_error());
+            db_.close();
+            return false;
+        }
+        db_.set_progress_handler(kInterruptCheckInstructions, &history_reader::interrupt_if_superseded, this);
+        LOG_INFO("history reader opened in thread {}", QThread::currentThreadId());
+        return true;
+    }
+    // the writer creates and drops day partitions while this connection stays open
+    partitions_.rescan();
+    return true;
+}
+
+bool history_reader::begin_request(query_scope scope, quint64 request_id)
+{
+    current_scope_ = scope;
+    current_request_id_ = request_id;
+    if (generations_->superseded(scope, request_id))
+    {
+        LOG_TRACE("dropping superseded request {} of scope {} before it ran", request_id, static_cast<int>(scope));
+        generations_->count_dropped();
+        return false;
+    }
+    return true;
+}
+
+bool history_reader::abandoned()
+{
+    if (!generations_->superseded(current_scope_, current_request_id_))
+    {
+        generations_->count_completed();
+        return false;
+    }
+    LOG_TRACE("request {} of scope {} superseded while running", current_request_id_, static_cast<int>(current_scope_));
+    generations_->count_interrupted();
+    return true;
+}
+
+std::vector<sqlite_database*> history_reader::interruptible(std::vector<sqlite_database*> sources)
+{
+    for (sqlite_database* source : sources)
+    {
+        interruptible(*source);
+    }
+    return sources;
+}
+
+sqlite_database& history_reader::interruptible(sqlite_database& source)
+{
+    source.set_progress_handler(kInterruptCheckInstructions, &history_reader::interrupt_if_superseded, this);
+    return source;
+}
+
+int history_reader::interrupt_if_superseded(void* context)
+{
+    const auto* reader = static_cast<const history_reader*>(context);
+    return reader->generations_->superseded(reader->current_scope_, reader->current_request_id_) ? 1 : 0;
+}
+
+void history_reader::read_snapshots(const snapshot_query& query)
+{
+    DEFER(finished());
+    if (!begin_request(query_scope::kSnapshots, query.request_id))
+    {
+        return;
+    }
+    const bool raw = query.tier.resolution_ms == 0;
+    QList<interface_history> histories;
+    histories.reserve(query.interface_names.size());
+    for (const QString& name : query.interface_names)
+    {
+        interface_history history;
+        history.interface_name = name;
+        history.resolution_ms = query.tier.resolution_ms;
+        histories.append(history);
+    }
+    if (!ensure_open())
+    {
+        emit snapshots_ready(query.request_id, histories);
+        return;
+    }
+    LOG_TRACE("snapshots for {} interfaces read from tier {} resolution {} ms",
+              query.interface_names.size(),
+              query.tier.id,
+              query.tier.resolution_ms);
+
+    // the requested ids go in as one json array so every statement below covers all interfaces in a single pass
+    QHash<qint64, qsizetype> history_index;
+    std::string id_list = "[";
+    for (qsizetype i = 0; i < query.interface_ids.size(); ++i)
+    {
+        const qint64 id = query.interface_ids[i];
+        if (id < 0 || history_index.contains(id))
+        {
+            continue;
+        }
+        id_list += (history_index.isEmpty() ? "" : ",") + std::to_string(id);
+        history_index.insert(id, i);
+    }
+    id_list += "]";
+    std::vector<QList<traffic_point>> samples(static_cast<size_t>(query.interface_names.size()));
+    // rollup rows also carry the rate range inside their bucket, kept index aligned with samples
+    std::vector<QList<rate_envelope>> envelopes(raw ? 0 : samples.size());
+
+    const char* before_sql = raw ? "SELECT interface_id, " TRAFFIC_POINT_COLUMNS " FROM json_each(?1) j JOIN traffic_snapshots t "
+                                   "ON t.interface_id = j.value AND t.timestamp = (SELECT MAX(timestamp) FROM traffic_snapshots "
+                                   "WHERE interface_id = j.value AND timestamp < ?2)"
+                                 : "SELECT interface_id, " TRAFFIC_POINT_COLUMNS ", " RATE_ENVELOPE_COLUMNS " FROM json_each(?1) j "
+                                   "JOIN traffic_rollups r ON r.tier = ?4 AND r.interface_id = j.value AND r.bucket_start = "
+                                   "(SELECT MAX(bucket_start) FROM traffic_rollups WHERE tier = ?4 AND interface_id = j.value AND bucket_start < ?2)";
+    const char* range_sql = raw ? "SELECT interface_id, " TRAFFIC_POINT_COLUMNS " FROM traffic_snapshots "
+                                  "WHERE interface_id IN (SELECT value FROM json_each(?1)) AND timestamp BETWEEN ?2 AND ?3 "
+                                  "ORDER BY interface_id, timestamp"
+                                : "SELECT interface_id, " TRAFFIC_POINT_COLUMNS ", " RATE_ENVELOPE_COLUMNS " FROM traffic_rollups "
+                                  "WHERE tier = ?4 AND interface_id IN (SELECT value FROM json_each(?1)) AND bucket_start BETWEEN ?2 AND ?3 "
+                                  "ORDER BY interface_id, bucket_start";
+
+    // sources are newest first, an interface takes the first pre-range point found for it
+    qsizetype before_found = 0;
+    auto read_before = [&](sqlite_database& source)
+    {
+        sqlite_statement* before = source.statement(before_sql);
+        if (before == nullptr)
+        {
+            return false;
+        }
+        DEFER(before->reset());
+        before->bind_text(1, std::string_view(id_list));
+        before->bind_int64(2, query.start_ms);
+        if (!raw)
+        {
+            before->bind_int64(4, query.tier.id);
+        }
+        sqlite_statement::step_result result;
+        while ((result = before->step()) == sqlite_statement::step_result::kRow)
+        {
+            const auto index = static_cast<size_t>(history_index.value(before->column_int64(0)));
+            QList<traffic_point>& points = samples[index];
+            if (points.isEmpty())
+            {
+                points.append(read_traffic_point(*before, 1));
+                if (!raw)
+                {
+                    envelopes[index].append(read_rate_envelope(*before, kRateEnvelopeColumn));
+                }
+                before_found++;
+            }
+        }
+        if (result == sqlite_statement::step_result::kError)
+        {
+            LOG_ERROR("db get snapshots pre-range failed {}", source.last_error());
+        }
+        return before_found == history_index.size() || generations_->superseded(current_scope_, current_request_id_);
+    };
+
+    // raw rows live in the day partitions, anything older than partitioning is still in the main file
+    std::vector<sqlite_database*> range_sources{&db_};
+    if (raw)
+    {
+        const auto overlapping = interruptible(partitions_.overlapping(partition_kind::kTraffic, query.start_ms, query.end_ms));
+        range_sources.insert(range_sources.end(), overlapping.begin(), overlapping.end());
+    }
+    if (!raw || !partitions_.find_at_or_before(partition_kind::kTraffic,
+                                               query.start_ms,
+                                               [&](sqlite_database& source) { return read_before(interruptible(source)); }))
+    {
+        read_before(db_);
+    }
+
+    for (sqlite_database* source : range_sources)
+    {
+        sqlite_statement* range = source->statement(range_sql);
+        if (range == nullptr)
+        {
+            continue;
+        }
+        DEFER(range->reset());
+        range->bind_text(1, std::string_view(id_list));
+        range->bind_int64(2, query.start_ms);
+        range->bind_int64(3, query.end_ms);
+        if (!raw)
+        {
+            range->bind_int64(4, query.tier.id);
+        }
+        sqlite_statement::step_result result;
+        while ((result = range->step()) == sqlite_statement::step_result::kRow)
+        {
+            const auto index = static_cast<size_t>(history_index.value(range->column_int64(0)));
+            samples[index].append(read_traffic_point(*range, 1));
+            if (!raw)
+            {
+                envelopes[index].append(read_rate_envelope(*range, kRateEnvelopeColumn));
+            }
+        }
+        if (result == sqlite_statement::step_result::kError)
+        {
+            LOG_ERROR("db get snapshots in-range failed {}", source->last_error());
+        }
+    }
+
+    if (raw)
+    {
+        for (auto it = history_index.cbegin(); it != history_index.cend() && !generations_->superseded(current_scope_, current_request_id_); ++it)
+        {
+            QList<traffic_point>& points = samples[static_cast<size_t>(it.value())];
+            read_blocks(query, it.key(), points);
+            keep_latest_before(points, query.start_ms);
+        }
+    }
+    if (abandoned())
+    {
+        return;
+    }
+    // rates and decimation happen here so the gui thread only swaps the finished series in
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        build_rate_series(histories[static_cast<qsizetype>(i)],
+                          samples[i],
+                          query.pixel_width,
+                          query.sample_interval_ms,
+                          raw ? QList<rate_envelope>() : envelopes[i]);
+    }
+    emit snapshots_ready(query.request_id, histories);
+}
+
+void history_reader::read_blocks(const snapshot_query& query, qint64 interface_id, QList<traffic_point>& results)
+{
+    const qint64 start_ms = query.start_ms;
+    const qint64 end_ms = query.end_ms;
+    // the open hour is newer in memory than its last checkpoint, so the stored copy is skipped
+    const auto open = query.open_blocks.constFind(interface_id);
+    const bool has_open = open != query.open_blocks.constEnd();
+    const qint64 open_start = has_open ? open.value().first : std::numeric_limits<qint64>::min();
+    const std::string_view open_data = has_open ? std::string_view(open.value().second) : std::string_view();
+
+    // the sample before the range seeds the first rate and may sit in any older block
+    QList<traffic_point> before;
+    if (has_open && open_start < start_ms)
+    {
+        traffic_block::decode(open_data, std::numeric_limits<qint64>::min(), start_ms - 1, before);
+    }
+    auto read_older_blocks = [&](sqlite_database& source)
+    {
+        sqlite_statement* older = source.statement(
+            "SELECT data FROM traffic_blocks WHERE interface_id = ?1 AND block_start < ?2 AND block_start <> ?3 ORDER BY block_start DESC");
+        if (older == nullptr)
+        {
+            return false;
+        }
+        DEFER(older->reset());
+        older->bind_int64(1, interface_id);
+        older->bind_int64(2, start_ms);
+        older->bind_int64(3, open_start);
+        while (before.isEmpty() && older->step() == sqlite_statement::step_result::kRow)
+        {
+            traffic_block::decode(older->column_blob(0), std::numeric_limits<qint64>::min(), start_ms - 1, before);
+        }
+        return !before.isEmpty() || generations_->superseded(current_scope_, current_request_id_);
+    };
+    if (before.isEmpty())
+    {
+        partitions_.find_at_or_before(
+            partition_kind::kTraffic, start_ms, [&](sqlite_database& source) { return read_older_blocks(interruptible(source)); });
+    }
+    if (!before.isEmpty())
+    {
+        results.append(before.last());
+    }
+
+    for (sqlite_database* source :
+         interruptible(partitions_.overlapping(partition_kind::kTraffic, start_ms - traffic_block::kBlockMs + 1, end_ms)))
+    {
+        sqlite_statement* range = source->statement(
+            "SELECT block_start, data FROM traffic_blocks WHERE interface_id = ?1 AND block_start > ?2 AND block_start <= ?3 "
+            "ORDER BY block_start");
+        if (range == nullptr)
+        {
+            continue;
+        }
+        DEFER(range->reset());
+        range->bind_int64(1, interface_id);
+        range->bind_int64(2, start_ms - traffic_block::kBlockMs);
+        range->bind_int64(3, end_ms);
+        sqlite_statement::step_result result;
+        while ((result = range->step()) == sqlite_statement::step_result::kRow)
+        {
+            if (range->column_int64(0) == open_start)
+            {
+                continue;
+            }
+            if (!traffic_block::decode(range->column_blob(1), start_ms, end_ms, results))
+            {
+                LOG_WARN("skipping unreadable traffic block {} of interface {}", range->column_int64(0), interface_id);
+            }
+        }
+        if (result == sqlite_statement::step_result::kError)
+        {
+            LOG_ERROR("db get traffic blocks failed for interface {} {}", interface_id, source->last_error());
+        }
+    }
+    if (has_open && open_start <= end_ms && open_start + traffic_block::kBlockMs > start_ms)
+    {
+        traffic_block::decode(open_data, start_ms, end_ms, results);
+    }
+}
+
+std::vector<sqlite_database*> history_reader::dns_sources(qint64 start_ms, qint64 end_ms)
+{
+    // rows written before partitioning stay in the main file until retention empties it
+    std::vector<sqlite_database*> sources{&db_};
+    const auto overlapping = interruptible(partitions_.overlapping(partition_kind::kDns, start_ms, end_ms));
+    sources.insert(sources.end(), overlapping.begin(), overlapping.end());
+    return sources;
+}
+
+struct dns_count_range
+{
+    bool from_buckets;
+    qint64 start_ms;
+    qint64 end_ms;
+};
+
+// the dns_buckets rows lying wholly inside [start_ms, end_ms] answer that span, the partial buckets at
+// either end are counted from the raw dns_logs rows so nothing outside the range is counted
+static std::vector<dns_count_range> dns_count_ranges(qint64 start_ms, qint64 end_ms, bool has_buckets)
+{
+    const qint64 first_whole = (start_ms + partition_store::kDnsBucketMs - 1) / partition_store::kDnsBucketMs * partition_store::kDnsBucketMs;
+    const qint64 past_whole = (end_ms + 1) / partition_store::kDnsBucketMs * partition_store::kDnsBucketMs;
+    if (!has_buckets || first_whole >= past_whole)
+    {
+        return {{false, start_ms, end_ms}};
+    }
+    std::vector<dns_count_range> ranges{{true, first_whole, past_whole - 1}};
+    if (start_ms < first_whole)
+    {
+        ranges.push_back({false, start_ms, first_whole - 1});
+    }
+    if (past_whole <= end_ms)
+    {
+        ranges.push_back({false, past_whole, end_ms});
+    }
+    return ranges;
+}
+
+void history_reader::read_qps_stats(quint64 request_id, qint64 start_ms, qint64 end_ms, int interval_secs)
+{
+    DEFER(finished());
+    LOG_DEBUG("processing get_qps_stats request id {}", request_id);
+    if (!begin_request(query_scope::kQpsStats, request_id))
+    {
+        return;
+    }
+    QList<QPointF> results;
+    if (interval_secs <= 0 || !ensure_open())
+    {
+        LOG_WARN("cannot get qps stats db not open or interval invalid");
+        emit qps_stats_ready(request_id, results);
+        return;
+    }
+
+    qint64 interval_ms = interval_secs * 1000L;
+
+    // a window that straddles midnight is counted in two partitions and summed here, partitions with
+    // dns_buckets answer from those and only older files fall back to grouping the raw rows
+    const bool bucketed = interval_ms % partition_store::kDnsBucketMs == 0;
+    QMap<qint64, qint64> counts;
+    for (sqlite_database* source : dns_sources(start_ms, end_ms))
+    {
+        const bool has_buckets = bucketed && partition_store::has_table(*source, "dns_buckets");
+        for (const dns_count_range& range : dns_count_ranges(start_ms, end_ms, has_buckets))
+        {
+            sqlite_statement* query = source->statement(
+                range.from_buckets ? "SELECT "
+                                     "  (bucket_start / ?1) * ?1 AS time_window, "
+                                     "  SUM(count) "
+                                     "FROM dns_buckets "
+                                     "WHERE bucket_start BETWEEN ?2 AND ?3 AND direction = 0 "
+                                     "GROUP BY time_window "
+                                     "ORDER BY time_window"
+                                   : "SELECT "
+                                     "  (timestamp / ?1) * ?1 AS time_window, "
+                                     "  COUNT(*) "
+                                     "FROM dns_logs "
+                                     "WHERE timestamp BETWEEN ?2 AND ?3 AND direction = 0 "
+                                     "GROUP BY time_window "
+                                     "ORDER BY time_window");
+            if (query == nullptr)
+            {
+                continue;
+            }
+            DEFER(query->reset());
+            query->bind_int64(1, interval_ms);
+            query->bind_int64(2, range.start_ms);
+            query->bind_int64(3, range.end_ms);
+            sqlite_statement::step_result result;
+            while ((result = query->step()) == sqlite_statement::step_result::kRow)
+            {
+                counts[query->column_int64(0)] += query->column_int64(1);
+            }
+            if (result == sqlite_statement::step_result::kError)
+            {
+                LOG_ERROR("db get qps stats failed {}", source->last_error());
+            }
+        }
+    }
+    if (abandoned())
+    {
+        return;
+    }
+    results.reserve(counts.size());
+    for (auto it = counts.cbegin(); it != counts.cend(); ++it)
+    {
+        results.append(QPointF(static_cast<qreal>(it.key()), static_cast<qreal>(it.value())));
+    }
+
+    LOG_DEBUG("qps stats query finished for id {} found {} data points", request_id, results.size());
+    emit qps_stats_ready(request_id, results);
+}
+
+void history_reader::read_dns_breakdown(quint64 request_id, qint64 start_ms, qint64 end_ms)
+{
+    DEFER(finished());
+    LOG_DEBUG("dns breakdown request id {}", request_id);
+    if (!begin_request(query_scope::kDnsBreakdown, request_id))
+    {
+        return;
+    }
+    dns_breakdown breakdown;
+    if (!ensure_open())
+    {
+        LOG_WARN("cannot get dns breakdown db not open");
+        emit dns_breakdown_ready(request_id, breakdown);
+        return;
+    }
+
+    for (sqlite_database* source : dns_sources(start_ms, end_ms))
+    {
+        const bool has_buckets = partition_store::has_table(*source, "dns_buckets");
+        for (const dns_count_range& range : dns_count_ranges(start_ms, end_ms, has_buckets))
+        {
+            sqlite_statement* query = source->statement(
+                range.from_buckets ? "SELECT direction, query_type, response_code, SUM(count) "
+                                     "FROM dns_buckets "
+                                     "WHERE bucket_start BETWEEN ?1 AND ?2 "
+                                     "GROUP BY direction, query_type, response_code"
+                                   : "SELECT direction, IFNULL(query_type, ''), IFNULL(response_code, ''), COUNT(*) "
+                                     "FROM dns_logs "
+                                     "WHERE timestamp BETWEEN ?1 AND ?2 "
+                                     "GROUP BY 1, 2, 3");
+            if (query == nullptr)
+            {
+                continue;
+            }
+            DEFER(query->reset());
+            query->bind_int64(1, range.start_ms);
+            query->bind_int64(2, range.end_ms);
+            sqlite_statement::step_result result;
+            while ((result = query->step()) == sqlite_statement::step_result::kRow)
+            {
+                const qint64 count = query->column_int64(3);
+                if (static_cast<dns_query_info::packet_direction>(query->column_int64(0)) == dns_query_info::packet_direction::kRequest)
+                {
+                    breakdown.requests += count;
+                    breakdown.query_types[query->column_text(1)] += count;
+                }
+                else
+                {
+                    breakdown.responses += count;
+                    breakdown.response_codes[query->column_text(2)] += count;
+                }
+            }
+            if (result == sqlite_statement::step_result::kError)
+            {
+                LOG_ERROR("db get dns breakdown failed {}", source->last_error());
+            }
+        }
+    }
+    if (abandoned())
+    {
+        return;
+    }
+
+    LOG_DEBUG("dns breakdown query finished for id {} counted {} requests {} responses", request_id, breakdown.requests, breakdown.responses);
+    emit dns_breakdown_ready(request_id, breakdown);
+}
+
+void history_reader::read_all_domains(quint64 request_id, qint64 start_ms, qint64 end_ms)
+{
+    DEFER(finished());
+    LOG_DEBUG("all domains request id {}", request_id);
+    if (!begin_request(query_scope::kAllDomains, request_id))
+    {
+        return;
+    }
+    QStringList results;
+    if (!ensure_open())
+    {
+        LOG_WARN("cannot get all domains db not open");
+        emit all_domains_ready(request_id, results);
+        return;
+    }
+
+    for (sqlite_database* source : dns_sources(start_ms, end_ms))
+    {
+        sqlite_statement* query = source->statement(
+            "SELECT DISTINCT query_domain "
+            "FROM dns_logs "
+            "WHERE timestamp BETWEEN ?1 AND ?2");
+        if (query == nullptr)
+        {
+            continue;
+        }
+        DEFER(query->reset());
+        query->bind_int64(1, start_ms);
+        query->bind_int64(2, end_ms);
+        sqlite_statement::step_result result;
+        while ((result = query->step()) == sqlite_statement::step_result::kRow)
+        {
+            results.append(query->column_text(0));
+        }
+        if (result == sqlite_statement::step_result::kError)
+        {
+            LOG_ERROR("db get all domains failed {}", source->last_error());
+        }
+    }
+    if (abandoned())
+    {
+        return;
+    }
+    results.sort();
+    results.removeDuplicates();
+
+    LOG_DEBUG("all domains query finished for id {} found {} domains", request_id, results.size());
+    emit all_domains_ready(request_id, results);
+}
+
+void history_reader::read_dns_details(quint64 request_id, const QString& domain, qint64 start_ms, qint64 end_ms)
+{
+    DEFER(finished());
+    LOG_DEBUG("dns details request id {} for domain {}", request_id, domain.toStdString());
+    if (!begin_request(query_scope::kDnsDetails, request_id))
+    {
+        return;
+    }
+    QList<dns_query_info> results;
+    if (!ensure_open())
+    {
+        LOG_WARN("cannot get dns details db not open");
+        emit dns_details_ready(request_id, results);
+        return;
+    }
+
+    // newest partition first so the concatenated rows stay in descending time order
+    auto sources = dns_sources(start_ms, end_ms);
+    std::reverse(sources.begin(), sources.end());
+    for (sqlite_database* source : sources)
+    {
+        sqlite_statement* query = source->statement(
+            "SELECT timestamp, transaction_id, direction, query_domain, query_type, response_code, response_data, resolver_ip "
+            "FROM dns_logs "
+            "WHERE query_domain = ?1 AND timestamp BETWEEN ?2 AND ?3 "
+            "ORDER BY timestamp DESC");
+        if (query == nullptr)
+        {
+            continue;
+        }
+        DEFER(query->reset());
+        query->bind_text(1, domain);
+        query->bind_int64(2, start_ms);
+        query->bind_int64(3, end_ms);
+        sqlite_statement::step_result result;
+        while ((result = query->step()) == sqlite_statement::step_result::kRow)
+        {
+            dns_query_info info;
+            info.timestamp.realtime_ms = query->column_int64(0);
+            info.transaction_id = static_cast<quint16>(query->column_int64(1));
+            info.direction = static_cast<dns_query_info::packet_direction>(query->column_int64(2));
+            info.query_domain = query->column_text(3);
+            info.query_type = query->column_text(4);
+            info.response_code = query->column_text(5);
+            info.response_data = query->column_text(6).split(", ", Qt::SkipEmptyParts);
+            info.resolver_ip = query->column_text(7);
+            results.append(info);
+        }
+        if (result == sqlite_statement::step_result::kError)
+        {
+            LOG_ERROR("db get dns details for {} failed {}", domain.toStdString(), source->last_error());
+        }
+    }
+    if (abandoned())
+    {
+        return;
+    }
+    LOG_DEBUG("dns details query finished for id {} found {} records", request_id, results.size());
+    emit dns_details_ready(request_id, results);
+}
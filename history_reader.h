@@ -0,0 +1,152 @@
+#ifndef HISTORY_READER_H
+#define HISTORY_READER_H
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPair>
+#include <QPointF>
+#include <QStringList>
+#include "sqlite_store.h"
+#include "partition_store.h"
+#include "traffic_point.h"
+#include "traffic_rollup.h"
+#include "traffic_series.h"
+#include "dns_query_info.h"
+#include "dns_breakdown.h"
+
+#define TRAFFIC_POINT_COLUMNS                                                                                                    \
+    "timestamp, bytes_received, bytes_sent, rx_packets, tx_packets, rx_errors, tx_errors, rx_dropped, tx_dropped, rx_fifo_errors, " \
+    "tx_fifo_errors, multicast"
+
+#define RATE_ENVELOPE_COLUMNS "rx_rate_min, rx_rate_max, tx_rate_min, tx_rate_max"
+
+// reads the TRAFFIC_POINT_COLUMNS starting at first_column
+traffic_point read_traffic_point(const sqlite_statement& stmt, int first_column = 0);
+
+// each consumer only keeps the answer to its newest request of a scope, so older ids of that scope are dead
+enum class query_scope : uint8_t
+{
+    kSnapshots,
+    kQpsStats,
+    kAllDomains,
+    kDnsDetails,
+    kDnsBreakdown,
+    kCount
+};
+
+// newest request id per scope, advanced by the writer on dispatch and polled by readers so superseded
+// requests are dropped from the queue or interrupted mid statement
+class query_generations
+{
+   public:
+    void advance(query_scope scope, quint64 request_id)
+    {
+        auto& latest = latest_[static_cast<size_t>(scope)];
+        quint64 current = latest.load(std::memory_order_relaxed);
+        while (current < request_id && !latest.compare_exchange_weak(current, request_id, std::memory_order_relaxed))
+        {
+        }
+    }
+    bool superseded(query_scope scope, quint64 request_id) const
+    {
+        return latest_[static_cast<size_t>(scope)].load(std::memory_order_relaxed) > request_id;
+    }
+
+    struct counters
+    {
+        quint64 completed = 0;
+        quint64 dropped = 0;
+        quint64 interrupted = 0;
+    };
+    void count_completed() { completed_.fetch_add(1, std::memory_order_relaxed); }
+    void count_dropped() { dropped_.fetch_add(1, std::memory_order_relaxed); }
+    void count_interrupted() { interrupted_.fetch_add(1, std::memory_order_relaxed); }
+    // totals since the last call
+    counters take_counters()
+    {
+        return {completed_.exchange(0, std::memory_order_relaxed),
+                dropped_.exchange(0, std::memory_order_relaxed),
+                interrupted_.exchange(0, std::memory_order_relaxed)};
+    }
+
+   private:
+    std::array<std::atomic<quint64>, static_cast<size_t>(query_scope::kCount)> latest_{};
+    std::atomic<quint64> completed_{0};
+    std::atomic<quint64> dropped_{0};
+    std::atomic<quint64> interrupted_{0};
+};
+
+// everything the writer resolved for a history read, so the reader never touches writer state
+struct snapshot_query
+{
+    quint64 request_id = 0;
+    QStringList interface_names;
+    // parallel to interface_names, -1 for names that were never stored
+    QList<qint64> interface_ids;
+    qint64 start_ms = 0;
+    qint64 end_ms = 0;
+    int pixel_width = 0;
+    // collection interval of the samples, gaps longer than a few of these are drawn as zero
+    int sample_interval_ms = 0;
+    rollup_tier tier{};
+    // the encoded hour still being filled per interface id, keyed by id with its block start
+    QHash<qint64, QPair<qint64, std::string>> open_blocks;
+};
+
+// runs history queries on its own thread over read only connections, so a long read never holds up the
+// writer, wal mode lets it see every committed row while ingest carries on
+class history_reader : public QObject
+{
+    Q_OBJECT
+
+   public:
+    history_reader(QString db_path, QString partition_dir, std::shared_ptr<query_generations> generations, QObject* parent = nullptr);
+    ~history_reader() override;
+
+    // requests queued and not finished yet, the writer hands new work to the least busy reader
+    int pending() const { return pending_.load(std::memory_order_relaxed); }
+    void queued() { pending_.fetch_add(1, std::memory_order_relaxed); }
+
+    void read_snapshots(const snapshot_query& query);
+    void read_qps_stats(quint64 request_id, qint64 start_ms, qint64 end_ms, int interval_secs);
+    void read_all_domains(quint64 request_id, qint64 start_ms, qint64 end_ms);
+    void read_dns_details(quint64 request_id, const QString& domain, qint64 start_ms, qint64 end_ms);
+    void read_dns_breakdown(quint64 request_id, qint64 start_ms, qint64 end_ms);
+
+   signals:
+    void snapshots_ready(quint64 request_id, const QList<interface_history>& histories);
+    void qps_stats_ready(quint64 request_id, const QList<QPointF>& data);
+    void all_domains_ready(quint64 request_id, const QStringList& domains);
+    void dns_details_ready(quint64 request_id, const QList<dns_query_info>& details);
+    void dns_breakdown_ready(quint64 request_id, const dns_breakdown& breakdown);
+
+   private:
+    bool ensure_open();
+    void finished() { pending_.fetch_sub(1, std::memory_order_relaxed); }
+    // false when a newer request of the scope came in while this one waited in the queue
+    bool begin_request(query_scope scope, quint64 request_id);
+    // true when the request was superseded while running, its partial result is thrown away
+    bool abandoned();
+    // arms the interrupt check on connections opened lazily by the partition store
+    std::vector<sqlite_database*> interruptible(std::vector<sqlite_database*> sources);
+    sqlite_database& interruptible(sqlite_database& source);
+    static int interrupt_if_superseded(void* context);
+    void read_blocks(const snapshot_query& query, qint64 interface_id, QList<traffic_point>& results);
+    std::vector<sqlite_database*> dns_sources(qint64 start_ms, qint64 end_ms);
+
+    QString db_path_;
+    QString partition_dir_;
+    sqlite_database db_;
+    partition_store partitions_;
+    std::atomic<int> pending_{0};
+    std::shared_ptr<query_generations> generations_;
+    query_scope current_scope_ = query_scope::kSnapshots;
+    quint64 current_request_id_ = 0;
+};
+
+#endif
@@ -0,0 +1,119 @@
+#include "log.h"
+#include "network_info.h"
+#include "interface_registry.h"
+
+bool interface_registry::should_track(const link_info& info)
+{
+    if (info.operstate != kOperStateUp && info.operstate != kOperStateUnknown)
+    {
+        return false;
+    }
+    return !network_info::is_ignored_interface(info.name);
+}
+
+void interface_registry::apply(const link_event& event, QList<interface_change>& changes)
+{
+    if (event.removed)
+    {
+        remove(event.info.index, changes);
+        return;
+    }
+    update(event.info, changes);
+}
+
+void interface_registry::sync(const std::vector<link_info>& links, QList<interface_change>& changes)
+{
+    QList<int> vanished;
+    for (auto it = entries_.constBegin(); it != entries_.constEnd(); ++it)
+    {
+        bool present = false;
+        for (const auto& link : links)
+        {
+            if (link.index == it.key())
+            {
+                present = true;
+                break;
+            }
+        }
+        if (!present)
+        {
+            vanished.append(it.key());
+        }
+    }
+    for (int index : vanished)
+    {
+        remove(index, changes);
+    }
+    for (const auto& link : links)
+    {
+        update(link, changes);
+    }
+}
+
+QStringList interface_registry::tracked_names() const
+{
+    QStringList names;
+    for (auto it = entries_.constBegin(); it != entries_.constEnd(); ++it)
+    {
+        if (it.value().tracked)
+        {
+            names.append(it.value().name);
+        }
+    }
+    return names;
+}
+
+void interface_registry::update(const link_info& info, QList<interface_change>& changes)
+{
+    const QString name = QString::fromLatin1(info.name);
+    const bool track = should_track(info);
+    auto it = entries_.find(info.index);
+    if (it == entries_.end())
+    {
+        entries_.insert(info.index, entry{name, info.operstate, track});
+        if (track)
+        {
+            LOG_INFO("interface {} index {} appeared", name.toStdString(), info.index);
+            changes.append(interface_change{interface_change::kind::kAdded, name, {}});
+        }
+        return;
+    }
+
+    entry& current = it.value();
+    if (current.operstate != info.operstate)
+    {
+        LOG_INFO("interface {} operstate changed {} -> {}", name.toStdString(), current.operstate, info.operstate);
+        current.operstate = info.operstate;
+    }
+
+    if (current.tracked && track && current.name != name)
+    {
+        LOG_INFO("interface {} renamed to {}", current.name.toStdString(), name.toStdString());
+        changes.append(interface_change{interface_change::kind::kRenamed, name, current.name});
+    }
+    else if (current.tracked && !track)
+    {
+        changes.append(interface_change{interface_change::kind::kRemoved, current.name, {}});
+    }
+    else if (!current.tracked && track)
+    {
+        changes.append(interface_change{interface_change::kind::kAdded, name, {}});
+    }
+    current.name = name;
+    current.tracked = track;
+}
+
+void interface_registry::remove(int index, QList<interface_change>& changes)
+{
+    auto it = entries_.find(index);
+    if (it == entries_.end())
+    {
+        return;
+    }
+    LOG_INFO("interface {} index {} disappeared", it.value().name.toStdString(), index);
+    if (it.value().tracked)
+    {
+        changes.append(interface_change{interface_change::kind::kRemoved, it.value().name, {}});
+    }
+    entries_.erase(it);
+}
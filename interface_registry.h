@@ -0,0 +1,51 @@
+#ifndef INTERFACE_REGISTRY_H
+#define INTERFACE_REGISTRY_H
+
+#include <vector>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include "netlink_link_reader.h"
+
+struct interface_change
+{
+    enum class kind : uint8_t
+    {
+        kAdded,
+        kRemoved,
+        kRenamed
+    };
+
+    kind type;
+    QString name;
+    QString previous_name;
+};
+
+class interface_registry
+{
+   public:
+    // applies one RTM_NEWLINK or RTM_DELLINK notification
+    void apply(const link_event& event, QList<interface_change>& changes);
+
+    // reconciles against a full dump, used at startup and after a notification overrun
+    void sync(const std::vector<link_info>& links, QList<interface_change>& changes);
+
+    QStringList tracked_names() const;
+
+   private:
+    struct entry
+    {
+        QString name;
+        uint8_t operstate = 0;
+        bool tracked = false;
+    };
+
+    void update(const link_info& info, QList<interface_change>& changes);
+    void remove(int index, QList<interface_change>& changes);
+    static bool should_track(const link_info& info);
+
+   private:
+    QHash<int, entry> entries_;
+};
+
+#endif
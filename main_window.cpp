@@ -11,36 +11,80 @@
 #include <QLabel>
 
 #include <algorithm>
+#include <cstdlib>
+#include <cstring>
 
 #include "log.h"
 #include "main_window.h"
 
-static constexpr int kMaxDataGapSeconds = 5;
 static constexpr int kDataBufferFactor = 2;
 static constexpr int kVisibleWindowMinutes = 15L;
 static constexpr int kSnapBackTimeoutMs = 5000;
 static constexpr int kCollectionIntervalMs = 1000;
-static QPair<double, double> calculate_traffic_speeds(qint64 prev_timestamp_ms,
-                                                      quint64 prev_bytes_sent,
-                                                      quint64 prev_bytes_received,
-                                                      qint64 curr_timestamp_ms,
-                                                      quint64 curr_bytes_sent,
-                                                      quint64 curr_bytes_received)
+static constexpr int kMinCollectionIntervalMs = 10;
+static constexpr int kMaxCollectionIntervalMs = 60000;
+static constexpr qint64 kMinAxisUpdateIntervalMs = 100;
+static constexpr qsizetype kDnsQueueCapacityEvents = 64 * 1024;
+static constexpr int kHotTierHours = 2;
+
+static int collection_interval_from_env()
+{
+    const char* interval = getenv("COLLECTION_INTERVAL_MS");
+    if (interval == nullptr)
+    {
+        return kCollectionIntervalMs;
+    }
+    return qBound(kMinCollectionIntervalMs, atoi(interval), kMaxCollectionIntervalMs);
+}
+static retention_policy retention_policy_from_env()
 {
-    double interval_seconds = static_cast<double>(curr_timestamp_ms - prev_timestamp_ms) / 1000.0;
-    if (interval_seconds <= 0)
+    constexpr qint64 kMillisPerDay = 24 * kMillisPerHour;
+    retention_policy policy;
+    if (const char* raw_days = getenv("RETENTION_RAW_DAYS"); raw_days != nullptr && atoi(raw_days) > 0)
     {
-        return {0.0, 0.0};
+        policy.traffic_max_age_ms.front() = atoi(raw_days) * kMillisPerDay;
     }
+    if (const char* dns_days = getenv("RETENTION_DNS_DAYS"); dns_days != nullptr && atoi(dns_days) > 0)
+    {
+        policy.dns_max_age_ms = atoi(dns_days) * kMillisPerDay;
+    }
+    if (const char* max_mb = getenv("DATABASE_MAX_MB"); max_mb != nullptr && atoi(max_mb) > 0)
+    {
+        policy.max_database_bytes = atoll(max_mb) * 1024 * 1024;
+    }
+    return policy;
+}
 
-    quint64 sent_diff = (curr_bytes_sent >= prev_bytes_sent) ? (curr_bytes_sent - prev_bytes_sent) : curr_bytes_sent;
-    quint64 recv_diff = (curr_bytes_received >= prev_bytes_received) ? (curr_bytes_received - prev_bytes_received) : curr_bytes_received;
+static traffic_storage traffic_storage_from_env()
+{
+    const char* storage = getenv("TRAFFIC_STORAGE");
+    return storage != nullptr && strcmp(storage, "blocks") == 0 ? traffic_storage::kBlocks : traffic_storage::kRows;
+}
 
-    double upload_speed_kb = (static_cast<double>(sent_diff) / interval_seconds) / 1024.0;
-    double download_speed_kb = (static_cast<double>(recv_diff) / interval_seconds) / 1024.0;
+static qint64 hot_tier_span_from_env()
+{
+    const char* hours = getenv("HOT_TIER_HOURS");
+    if (hours == nullptr)
+    {
+        return kHotTierHours * kMillisPerHour;
+    }
+    return qMax(0, atoi(hours)) * kMillisPerHour;
+}
 
-    return {upload_speed_kb, download_speed_kb};
+static void trim_series_before(QLineSeries* series, qreal cutoff)
+{
+    const auto points = series->points();
+    qsizetype expired = 0;
+    while (expired < points.size() && points[expired].x() < cutoff)
+    {
+        ++expired;
+    }
+    if (expired > 0)
+    {
+        series->removePoints(0, static_cast<int>(expired));
+    }
 }
+
 main_window::main_window(QWidget* parent) : QMainWindow(parent), snap_back_timer_(new QTimer(this))
 {
     setup_chart();
@@ -50,6 +94,7 @@ main_window::main_window(QWidget* parent) : QMainWindow(parent), snap_back_timer
     connect(dns_page_, &dns_page::request_qps_stats, this, &main_window::handle_dns_page_qps_request);
     connect(dns_page_, &dns_page::request_all_domains, this, &main_window::handle_dns_page_all_domains_request);
     connect(dns_page_, &dns_page::request_dns_details_for_domain, this, &main_window::handle_dns_page_details_request);
+    connect(dns_page_, &dns_page::request_dns_breakdown, this, &main_window::handle_dns_page_breakdown_request);
     connect(this, &main_window::initial_data_load_requested, dns_page_, &dns_page::trigger_initial_load);
 
     central_stacked_widget_ = new QStackedWidget(this);
@@ -145,18 +190,26 @@ void main_window::setup_workers()
 {
     db_manager_thread_ = new QThread(this);
     QString db_path = QDir(QApplication::applicationDirPath()).filePath("network_monitor.db");
+    // dns batches go from the capture side to the database without passing through this thread
+    auto dns_queue = std::make_shared<dns_event_queue>(kDnsQueueCapacityEvents);
     db_manager_ = new database_manager(db_path);
+    db_manager_->set_dns_event_queue(dns_queue);
+    db_manager_->set_retention_policy(retention_policy_from_env());
+    db_manager_->set_traffic_storage(traffic_storage_from_env());
+    db_manager_->set_hot_tier(hot_tier_span_from_env(), collection_interval_from_env());
     db_manager_->moveToThread(db_manager_thread_);
     connect(this, &main_window::request_add_snapshots, db_manager_, &database_manager::add_snapshots);
     connect(this, &main_window::request_snapshots_in_range, db_manager_, &database_manager::get_snapshots_in_range);
     connect(db_manager_, &database_manager::snapshots_ready, this, &main_window::handle_snapshots_loaded);
-    connect(this, &main_window::request_add_dns_log, db_manager_, &database_manager::add_dns_log);
     connect(this, &main_window::request_qps_stats_from_db, db_manager_, &database_manager::get_qps_stats);
     connect(this, &main_window::request_all_domains_from_db, db_manager_, &database_manager::get_all_domains);
     connect(this, &main_window::request_dns_details_from_db, db_manager_, &database_manager::get_dns_details_for_domain);
+    connect(this, &main_window::request_dns_breakdown_from_db, db_manager_, &database_manager::get_dns_breakdown);
     connect(db_manager_, &database_manager::qps_stats_ready, dns_page_, &dns_page::handle_qps_stats_ready);
     connect(db_manager_, &database_manager::all_domains_ready, dns_page_, &dns_page::handle_all_domains_ready);
     connect(db_manager_, &database_manager::dns_details_ready, dns_page_, &dns_page::handle_dns_details_ready);
+    connect(db_manager_, &database_manager::dns_breakdown_ready, dns_page_, &dns_page::handle_dns_breakdown_ready);
+    connect(db_manager_, &database_manager::dns_logs_stored, dns_page_, &dns_page::handle_dns_logs_stored);
     connect(db_manager_thread_, &QThread::started, db_manager_, &database_manager::initialize);
     connect(db_manager_,
             &database_manager::initialization_failed,
@@ -173,21 +226,28 @@ void main_window::setup_workers()
     data_collector_ = new data_collector();
     data_collector_->moveToThread(data_collector_thread_);
     connect(data_collector_, &data_collector::stats_collected, this, &main_window::handle_stats_collected);
+    connect(data_collector_, &data_collector::interface_added, this, &main_window::handle_interface_added);
+    connect(data_collector_, &data_collector::interface_removed, this, &main_window::handle_interface_removed);
+    connect(data_collector_, &data_collector::interface_renamed, this, &main_window::handle_interface_renamed);
     connect(this, &main_window::start_collector_timer, data_collector_, &data_collector::start_collection);
     connect(data_collector_thread_, &QThread::finished, data_collector_, &QObject::deleteLater);
 
     dns_collector_thread_ = new QThread(this);
-    dns_collector_ = new dns_collector();
+    dns_collector_ = new dns_collector(dns_queue);
     dns_collector_->moveToThread(dns_collector_thread_);
+    connect(dns_collector_, &dns_collector::dns_batch_queued, db_manager_, &database_manager::drain_dns_events);
+    connect(dns_collector_, &dns_collector::dns_rates_sampled, dns_page_, &dns_page::handle_dns_rates);
     connect(this, &main_window::start_dns_capture, dns_collector_, &dns_collector::start_capture);
-    connect(dns_collector_, &dns_collector::dns_packet_collected, this, &main_window::handle_dns_packet_collected, Qt::QueuedConnection);
+    connect(data_collector_, &data_collector::interface_added, dns_collector_, &dns_collector::add_device);
+    connect(data_collector_, &data_collector::interface_removed, dns_collector_, &dns_collector::remove_device);
+    connect(data_collector_, &data_collector::interface_renamed, dns_collector_, &dns_collector::rename_device);
     connect(dns_collector_thread_, &QThread::finished, dns_collector_, &QObject::deleteLater);
 
     db_manager_thread_->start();
     data_collector_thread_->start();
     dns_collector_thread_->start();
 
-    emit start_collector_timer(kCollectionIntervalMs);
+    emit start_collector_timer(collection_interval_from_env());
     emit start_dns_capture();
 
     LOG_INFO("worker threads started");
@@ -200,78 +260,53 @@ void main_window::on_database_ready()
     LOG_INFO("received database_ready signal requesting initial data load");
     emit initial_data_load_requested();
 }
-void main_window::handle_dns_packet_collected(const dns_query_info& info)
-{
-    LOG_DEBUG("received dns_packet_collected signal for {} forwarding to db manager", info.query_domain.toStdString());
-    emit request_add_dns_log(info);
-}
 
-void main_window::handle_dns_page_qps_request(quint64 request_id, const QDateTime& start, const QDateTime& end, int interval_secs)
+void main_window::handle_dns_page_qps_request(quint64 request_id, qint64 start_ms, qint64 end_ms, int interval_secs)
 {
     LOG_DEBUG("received request for qps stats from dns_page id {} forwarding to db manager", request_id);
-    emit request_qps_stats_from_db(request_id, start, end, interval_secs);
+    emit request_qps_stats_from_db(request_id, start_ms, end_ms, interval_secs);
 }
 
-void main_window::handle_dns_page_all_domains_request(quint64 request_id, const QDateTime& start, const QDateTime& end)
+void main_window::handle_dns_page_all_domains_request(quint64 request_id, qint64 start_ms, qint64 end_ms)
 {
     LOG_DEBUG("received request for all domains from dns_page id {} forwarding to db manager", request_id);
-    emit request_all_domains_from_db(request_id, start, end);
+    emit request_all_domains_from_db(request_id, start_ms, end_ms);
 }
 
-void main_window::handle_dns_page_details_request(quint64 request_id, const QString& domain, const QDateTime& start, const QDateTime& end)
+void main_window::handle_dns_page_details_request(quint64 request_id, const QString& domain, qint64 start_ms, qint64 end_ms)
 {
     LOG_DEBUG("received request for dns details for {} from dns_page id {} forwarding to db manager", domain.toStdString(), request_id);
-    emit request_dns_details_from_db(request_id, domain, start, end);
+    emit request_dns_details_from_db(request_id, domain, start_ms, end_ms);
+}
+
+void main_window::handle_dns_page_breakdown_request(quint64 request_id, qint64 start_ms, qint64 end_ms)
+{
+    LOG_DEBUG("received request for dns breakdown from dns_page id {} forwarding to db manager", request_id);
+    emit request_dns_breakdown_from_db(request_id, start_ms, end_ms);
 }
 
-void main_window::handle_stats_collected(const QList<interface_stats>& stats, const QDateTime& timestamp)
+void main_window::handle_stats_collected(const QList<interface_stats>& stats, const sample_time& timestamp)
 {
     LOG_TRACE("received stats from collector");
     emit request_add_snapshots(stats, timestamp);
 
-    bool new_interface_detected = false;
-    for (const auto& stat : stats)
-    {
-        if (series_map_.contains(stat.name))
-        {
-            continue;
-        }
-
-        if (new_interfaces_queue_.contains(stat.name))
-        {
-            continue;
-        }
-
-        new_interfaces_queue_.append(stat.name);
-        new_interface_detected = true;
-    }
-
-    if (new_interface_detected)
-    {
-        QTimer::singleShot(0, this, &main_window::process_new_interfaces);
-    }
-
     if (is_manual_view_active_)
     {
         return;
     }
     for (const auto& stat : stats)
     {
-        if (series_map_.contains(stat.name))
+        auto it = series_map_.find(stat.name);
+        if (it != series_map_.end())
         {
-            append_live_data_point(stat, timestamp);
+            append_live_data_point(it.value(), stat, timestamp);
         }
     }
 
-    const qint64 visible_window_msecs = kVisibleWindowMinutes * 60L * 1000;
-    const QDateTime& end_time = timestamp;
-    QDateTime start_time = end_time.addMSecs(-visible_window_msecs);
-    update_x_axis(start_time, end_time);
-    rescale_y_axis();
-
+    const QDateTime end_time = QDateTime::fromMSecsSinceEpoch(timestamp.realtime_ms);
     if (!chart_view_->property("dragEnabled").toBool() && first_timestamp_.isValid())
     {
-        const qint64 total_duration_seconds = first_timestamp_.secsTo(timestamp);
+        const qint64 total_duration_seconds = first_timestamp_.secsTo(end_time);
         const qint64 visible_window_seconds = kVisibleWindowMinutes * 60L;
         if (total_duration_seconds > visible_window_seconds)
         {
@@ -280,11 +315,47 @@ void main_window::handle_stats_collected(const QList<interface_stats>& stats, co
             chart_view_->setProperty("dragEnabled", true);
         }
     }
+
+    // high frequency sampling would otherwise move the axes on each tick
+    if (last_axis_update_.isValid() && !last_axis_update_.hasExpired(kMinAxisUpdateIntervalMs))
+    {
+        return;
+    }
+    last_axis_update_.start();
+
+    const qint64 visible_window_msecs = kVisibleWindowMinutes * 60L * 1000;
+    QDateTime start_time = end_time.addMSecs(-visible_window_msecs);
+    update_x_axis(start_time, end_time);
+    rescale_live_y_axis();
+}
+
+void main_window::handle_interface_added(const QString& interface_name)
+{
+    if (series_map_.contains(interface_name) || new_interfaces_queue_.contains(interface_name))
+    {
+        return;
+    }
+    LOG_INFO("interface {} added queueing series creation", interface_name.toStdString());
+    new_interfaces_queue_.append(interface_name);
+    QTimer::singleShot(0, this, &main_window::process_new_interfaces);
+}
+
+void main_window::handle_interface_removed(const QString& interface_name)
+{
+    LOG_INFO("interface {} removed", interface_name.toStdString());
+    new_interfaces_queue_.removeAll(interface_name);
+    remove_series_for_interface(interface_name);
+}
+
+void main_window::handle_interface_renamed(const QString& old_name, const QString& new_name)
+{
+    LOG_INFO("interface {} renamed to {}", old_name.toStdString(), new_name.toStdString());
+    handle_interface_removed(old_name);
+    handle_interface_added(new_name);
 }
 
-void main_window::append_live_data_point(const interface_stats& current_stats, const QDateTime& timestamp)
+void main_window::append_live_data_point(interface_series& series_pair, const interface_stats& current_stats, const sample_time& timestamp)
 {
-    interface_series& series_pair = series_map_[current_stats.name];
     const interface_stats& previous_stats = series_pair.last_stats;
 
     if (previous_stats.name.isEmpty())
@@ -294,27 +365,29 @@ void main_window::append_live_data_point(const interface_stats& current_stats, c
         return;
     }
 
-    QPair<double, double> speeds = calculate_traffic_speeds(previous_stats.timestamp.toMSecsSinceEpoch(),
-                                                            previous_stats.bytes_sent,
-                                                            previous_stats.bytes_received,
-                                                            timestamp.toMSecsSinceEpoch(),
-                                                            current_stats.bytes_sent,
-                                                            current_stats.bytes_received);
+    // the monotonic interval keeps rates correct when the wall clock is stepped
+    const double interval_seconds = sample_clock::elapsed_seconds(previous_stats.timestamp, timestamp);
+    QPair<double, double> speeds = calculate_traffic_speeds(
+        interval_seconds, previous_stats.bytes_sent, previous_stats.bytes_received, current_stats.bytes_sent, current_stats.bytes_received);
 
     double upload_speed_kb = speeds.first;
     double download_speed_kb = speeds.second;
+    QPair<double, double> packet_rates = calculate_packet_rates(interval_seconds, previous_stats, current_stats);
 
-    series_pair.upload->append(static_cast<double>(timestamp.toMSecsSinceEpoch()), upload_speed_kb);
-    series_pair.download->append(static_cast<double>(timestamp.toMSecsSinceEpoch()), download_speed_kb);
+    const auto x = static_cast<double>(timestamp.realtime_ms);
+    series_pair.upload->append(x, upload_speed_kb);
+    series_pair.download->append(x, download_speed_kb);
+    series_pair.packets->append(x, packet_rates.first);
+    series_pair.drops->append(x, packet_rates.second);
+    series_pair.upload_max.push(QPointF(x, upload_speed_kb));
+    series_pair.download_max.push(QPointF(x, download_speed_kb));
+    series_pair.packets_max.push(QPointF(x, packet_rates.first));
+    series_pair.drops_max.push(QPointF(x, packet_rates.second));
 
-    const qint64 cutoff_ms = timestamp.addSecs(-kVisibleWindowMinutes * 60L * kDataBufferFactor).toMSecsSinceEpoch();
-    while (!series_pair.upload->points().isEmpty() && series_pair.upload->points().first().x() < static_cast<qreal>(cutoff_ms))
-    {
-        series_pair.upload->remove(0);
-    }
-    while (!series_pair.download->points().isEmpty() && series_pair.download->points().first().x() < static_cast<qreal>(cutoff_ms))
+    const auto cutoff = static_cast<qreal>(timestamp.realtime_ms - kVisibleWindowMinutes * 60L * kDataBufferFactor * 1000);
+    for (auto* series : {series_pair.upload, series_pair.download, series_pair.packets, series_pair.drops})
     {
-        series_pair.download->remove(0);
+        trim_series_before(series, cutoff);
     }
 
     series_pair.last_stats = current_stats;
@@ -344,16 +417,19 @@ void main_window::process_new_interfaces()
         return;
     }
 
+    QStringList added;
     for (const QString& interface_name : new_interfaces_queue_)
     {
         add_series_for_interface(interface_name);
+        added.append(interface_name);
     }
     new_interfaces_queue_.clear();
 
+    // the series already on the chart keep their data, only the new ones are loaded
     const QDateTime now = QDateTime::currentDateTime();
     const qint64 visible_window_msecs = kVisibleWindowMinutes * 60L * 1000;
     const QDateTime start_time = now.addMSecs(-visible_window_msecs);
-    load_data_for_display(start_time, now);
+    load_data_for_display(start_time, now, added);
 }
 
 void main_window::on_interaction_started()
@@ -403,6 +479,11 @@ void main_window::setup_chart()
     axis_y_->setMinorTickCount(4);
     axis_y_->setRange(0, 100.0);
     chart_->addAxis(axis_y_, Qt::AlignLeft);
+    axis_packets_ = new QValueAxis;
+    axis_packets_->setLabelFormat("%.0f");
+    axis_packets_->setTitleText("包/秒");
+    axis_packets_->setRange(0, 100.0);
+    chart_->addAxis(axis_packets_, Qt::AlignRight);
 }
 
 void main_window::add_series_for_interface(const QString& interface_name)
@@ -427,144 +508,161 @@ void main_window::add_series_for_interface(const QString& interface_name)
     upload_pen.setStyle(Qt::DashLine);
     upload_series->setPen(upload_pen);
 
+    auto* packets_series = new QLineSeries();
+    auto* drops_series = new QLineSeries();
+    packets_series->setName(interface_name + " 包速率");
+    drops_series->setName(interface_name + " 丢包率");
+    QPen packets_pen(base_color.darker(130));
+    packets_pen.setWidth(1);
+    packets_pen.setStyle(Qt::DotLine);
+    packets_series->setPen(packets_pen);
+    QPen drops_pen(base_color.darker(160));
+    drops_pen.setWidth(1);
+    drops_pen.setStyle(Qt::DashDotLine);
+    drops_series->setPen(drops_pen);
+
     chart_->addSeries(upload_series);
     chart_->addSeries(download_series);
+    chart_->addSeries(packets_series);
+    chart_->addSeries(drops_series);
 
     upload_series->attachAxis(axis_x_);
     upload_series->attachAxis(axis_y_);
     download_series->attachAxis(axis_x_);
     download_series->attachAxis(axis_y_);
+    packets_series->attachAxis(axis_x_);
+    packets_series->attachAxis(axis_packets_);
+    drops_series->attachAxis(axis_x_);
+    drops_series->attachAxis(axis_packets_);
 
     series_map_[interface_name].upload = upload_series;
     series_map_[interface_name].download = download_series;
+    series_map_[interface_name].packets = packets_series;
+    series_map_[interface_name].drops = drops_series;
     auto* legend = chart_->legend();
-    for (QLegendMarker* marker : legend->markers(upload_series))
+    for (auto* hidden_series : {upload_series, packets_series, drops_series})
     {
-        marker->setVisible(false);
+        for (QLegendMarker* marker : legend->markers(hidden_series))
+        {
+            marker->setVisible(false);
+        }
     }
     for (QLegendMarker* marker : legend->markers(download_series))
     {
         series_map_[interface_name].marker = marker;
         connect(marker, &QLegendMarker::clicked, this, [this, interface_name]() { toggle_series_visibility(interface_name); });
     }
-    connect(upload_series, &QLineSeries::clicked, this, [this, interface_name]() { toggle_series_visibility(interface_name); });
-    connect(download_series, &QLineSeries::clicked, this, [this, interface_name]() { toggle_series_visibility(interface_name); });
-    connect(upload_series, &QLineSeries::hovered, this, &main_window::handle_series_hovered);
-    connect(download_series, &QLineSeries::hovered, this, &main_window::handle_series_hovered);
+    for (auto* series : {upload_series, download_series, packets_series, drops_series})
+    {
+        connect(series, &QLineSeries::clicked, this, [this, interface_name]() { toggle_series_visibility(interface_name); });
+        connect(series, &QLineSeries::hovered, this, &main_window::handle_series_hovered);
+    }
 }
 
-void main_window::load_data_for_display(const QDateTime& start, const QDateTime& end)
+void main_window::remove_series_for_interface(const QString& interface_name)
+{
+    auto it = series_map_.find(interface_name);
+    if (it == series_map_.end())
+    {
+        return;
+    }
+    LOG_INFO("removing series for interface {}", interface_name.toStdString());
+    for (auto* series : {it.value().upload, it.value().download, it.value().packets, it.value().drops})
+    {
+        chart_->removeSeries(series);
+        series->deleteLater();
+    }
+    series_map_.erase(it);
+
+    if (isolated_interface_name_ == interface_name)
+    {
+        isolated_interface_name_.clear();
+    }
+    update_all_visuals();
+    rescale_y_axis();
+}
+
+void main_window::load_data_for_display(const QDateTime& start, const QDateTime& end, const QStringList& interface_names)
 {
     if (series_map_.isEmpty())
     {
-        if (new_interfaces_queue_.isEmpty() && first_timestamp_.isNull())
-        {
-        }
-        else if (series_map_.isEmpty())
-        {
-            return;
-        }
+        return;
     }
+    // a newer request makes the one in flight stale, so it has to cover every series that one would have filled
+    const QStringList names = interface_names.isEmpty() || load_pending_ ? series_map_.keys() : interface_names;
 
     current_load_request_id_++;
-    LOG_DEBUG("requesting data load with id {} for range {} {}",
+    LOG_DEBUG("requesting data load with id {} for {} interfaces range {} {}",
               current_load_request_id_,
+              names.size(),
               start.toString("hh:mm:ss").toStdString(),
               end.toString("hh:mm:ss").toStdString());
 
-    pending_queries_count_ = series_map_.size();
-    if (pending_queries_count_ == 0)
-    {
-        return;
-    }
-
+    load_pending_ = true;
     loaded_data_start_time_ = end;
 
-    for (const QString& name : series_map_.keys())
-    {
-        emit request_snapshots_in_range(current_load_request_id_, name, start, end);
-    }
+    const int pixel_width = static_cast<int>(chart_->plotArea().width());
+    emit request_snapshots_in_range(current_load_request_id_, names, start.toMSecsSinceEpoch(), end.toMSecsSinceEpoch(), pixel_width);
 }
 
-void main_window::handle_snapshots_loaded(quint64 request_id, const QString& interface_name, const QList<traffic_point>& snapshots)
+void main_window::handle_snapshots_loaded(quint64 request_id, const QList<interface_history>& histories)
 {
     if (request_id != current_load_request_id_)
     {
-        LOG_DEBUG("ignoring stale data req id {} for interface {} for current req id {}",
-                  request_id,
-                  interface_name.toStdString(),
-                  current_load_request_id_);
+        LOG_DEBUG("ignoring stale data req id {} for current req id {}", request_id, current_load_request_id_);
         return;
     }
+    load_pending_ = false;
 
-    if (!series_map_.contains(interface_name))
+    for (const auto& history : histories)
     {
-        pending_queries_count_--;
-        if (pending_queries_count_ <= 0)
+        if (series_map_.contains(history.interface_name))
         {
-            process_loaded_data_batch();
+            apply_interface_history(history);
         }
-        return;
     }
-    LOG_TRACE("received snapshot data for {}", interface_name.toStdString());
+    process_loaded_data_batch();
+}
 
-    QList<traffic_point> sorted_snapshots = snapshots;
-    std::sort(sorted_snapshots.begin(),
-              sorted_snapshots.end(),
-              [](const traffic_point& a, const traffic_point& b) { return a.timestamp_ms < b.timestamp_ms; });
+void main_window::apply_interface_history(const interface_history& history)
+{
+    const QString& interface_name = history.interface_name;
+    LOG_TRACE("received {} rate points for {}", history.download.size(), interface_name.toStdString());
 
-    QVector<QPointF> upload_points;
-    QVector<QPointF> download_points;
-    if (sorted_snapshots.size() >= 2)
+    interface_series& series = series_map_[interface_name];
+    if (history.first_rate_ms != 0)
     {
         if (!first_timestamp_.isValid())
         {
-            first_timestamp_ = QDateTime::fromMSecsSinceEpoch(sorted_snapshots[1].timestamp_ms);
-        }
-
-        upload_points.reserve(sorted_snapshots.size() * 2);
-        download_points.reserve(sorted_snapshots.size() * 2);
-
-        for (int i = 1; i < sorted_snapshots.size(); ++i)
-        {
-            const auto& current = sorted_snapshots[i];
-            const auto& previous = sorted_snapshots[i - 1];
-            double interval_seconds = static_cast<double>(current.timestamp_ms - previous.timestamp_ms) / 1000.0;
-
-            if (interval_seconds > kMaxDataGapSeconds)
-            {
-                upload_points.append(QPointF(static_cast<double>(previous.timestamp_ms + 1), 0.0));
-                download_points.append(QPointF(static_cast<double>(previous.timestamp_ms + 1), 0.0));
-                upload_points.append(QPointF(static_cast<double>(current.timestamp_ms - 1), 0.0));
-                download_points.append(QPointF(static_cast<double>(current.timestamp_ms - 1), 0.0));
-            }
-            if (interval_seconds <= 0)
-            {
-                continue;
-            }
-
-            QPair<double, double> speeds = calculate_traffic_speeds(previous.timestamp_ms,
-                                                                    previous.bytes_sent,
-                                                                    previous.bytes_received,
-                                                                    current.timestamp_ms,
-                                                                    current.bytes_sent,
-                                                                    current.bytes_received);
-            upload_points.append(QPointF(static_cast<double>(current.timestamp_ms), speeds.first));
-            download_points.append(QPointF(static_cast<double>(current.timestamp_ms), speeds.second));
+            first_timestamp_ = QDateTime::fromMSecsSinceEpoch(history.first_rate_ms);
         }
 
-        const auto& last_snapshot = sorted_snapshots.last();
-        series_map_[interface_name].last_stats = {
-            interface_name, last_snapshot.bytes_received, last_snapshot.bytes_sent, QDateTime::fromMSecsSinceEpoch(last_snapshot.timestamp_ms)};
-    }
-    series_map_[interface_name].upload->replace(upload_points);
-    series_map_[interface_name].download->replace(download_points);
-
-    pending_queries_count_--;
-    if (pending_queries_count_ <= 0)
-    {
-        process_loaded_data_batch();
-    }
+        const traffic_point& last_snapshot = history.last_point;
+        interface_stats& last_stats = series.last_stats;
+        last_stats.name = interface_name;
+        last_stats.bytes_received = last_snapshot.bytes_received;
+        last_stats.bytes_sent = last_snapshot.bytes_sent;
+        last_stats.rx_packets = last_snapshot.rx_packets;
+        last_stats.tx_packets = last_snapshot.tx_packets;
+        last_stats.rx_errors = last_snapshot.rx_errors;
+        last_stats.tx_errors = last_snapshot.tx_errors;
+        last_stats.rx_dropped = last_snapshot.rx_dropped;
+        last_stats.tx_dropped = last_snapshot.tx_dropped;
+        last_stats.rx_fifo_errors = last_snapshot.rx_fifo_errors;
+        last_stats.tx_fifo_errors = last_snapshot.tx_fifo_errors;
+        last_stats.multicast = last_snapshot.multicast;
+        // stored rows carry no monotonic stamp so the next live rate falls back to realtime once
+        last_stats.timestamp = sample_time{0, last_snapshot.timestamp_ms};
+    }
+    // rates arrive computed and decimated from the database thread
+    series.upload->replace(history.upload);
+    series.download->replace(history.download);
+    series.packets->replace(history.packets);
+    series.drops->replace(history.drops);
+    series.upload_max.reset(history.upload);
+    series.download_max.reset(history.download);
+    series.packets_max.reset(history.packets);
+    series.drops_max.reset(history.drops);
 }
 
 void main_window::process_loaded_data_batch()
@@ -605,34 +703,107 @@ void main_window::update_x_axis(const QDateTime& start, const QDateTime& end)
     axis_x_->setRange(start, end);
 }
 
+void window_max::push(const QPointF& point)
+{
+    while (!candidates_.empty() && candidates_.back().y() <= point.y())
+    {
+        candidates_.pop_back();
+    }
+    candidates_.push_back(point);
+}
+
+void window_max::reset(const QList<QPointF>& points)
+{
+    candidates_.clear();
+    for (const auto& point : points)
+    {
+        push(point);
+    }
+}
+
+double window_max::max_from(qreal min_x)
+{
+    while (!candidates_.empty() && candidates_.front().x() < min_x)
+    {
+        candidates_.pop_front();
+    }
+    return candidates_.empty() ? 0.0 : candidates_.front().y();
+}
+
+static double max_visible_value(const QLineSeries* series, qint64 min_x_ms, qint64 max_x_ms)
+{
+    double max_value = 0.0;
+    if (!series->isVisible())
+    {
+        return max_value;
+    }
+    // points are kept in time order so the window start is found by bisection
+    const auto points = series->points();
+    auto it = std::lower_bound(points.cbegin(),
+                               points.cend(),
+                               static_cast<double>(min_x_ms),
+                               [](const QPointF& point, double x) { return point.x() < x; });
+    for (; it != points.cend() && it->x() <= static_cast<double>(max_x_ms); ++it)
+    {
+        max_value = qMax(max_value, it->y());
+    }
+    return max_value;
+}
+
+static double live_max(const QLineSeries* series, window_max& maxima, qreal min_x)
+{
+    return series->isVisible() ? maxima.max_from(min_x) : 0.0;
+}
+
 void main_window::rescale_y_axis()
 {
     double max_visible_speed = 0.0;
+    double max_visible_packets = 0.0;
     qint64 min_x_ms = axis_x_->min().toMSecsSinceEpoch();
     qint64 max_x_ms = axis_x_->max().toMSecsSinceEpoch();
     for (const auto& series_pair : series_map_.values())
     {
         for (const auto* series : {series_pair.upload, series_pair.download})
         {
-            if (!series->isVisible())
-            {
-                continue;
-            }
-            for (const auto& point : series->points())
-            {
-                if (point.x() >= static_cast<double>(min_x_ms) && point.x() <= static_cast<double>(max_x_ms))
-                {
-                    max_visible_speed = qMax(max_visible_speed, point.y());
-                }
-            }
+            max_visible_speed = qMax(max_visible_speed, max_visible_value(series, min_x_ms, max_x_ms));
         }
+        for (const auto* series : {series_pair.packets, series_pair.drops})
+        {
+            max_visible_packets = qMax(max_visible_packets, max_visible_value(series, min_x_ms, max_x_ms));
+        }
+    }
+    apply_y_ranges(max_visible_speed, max_visible_packets);
+}
+
+void main_window::rescale_live_y_axis()
+{
+    // the live window only moves forward, so the maxima kept while appending answer without a scan
+    const auto min_x = static_cast<qreal>(axis_x_->min().toMSecsSinceEpoch());
+    double max_visible_speed = 0.0;
+    double max_visible_packets = 0.0;
+    for (auto& series_pair : series_map_)
+    {
+        max_visible_speed = qMax(max_visible_speed, live_max(series_pair.upload, series_pair.upload_max, min_x));
+        max_visible_speed = qMax(max_visible_speed, live_max(series_pair.download, series_pair.download_max, min_x));
+        max_visible_packets = qMax(max_visible_packets, live_max(series_pair.packets, series_pair.packets_max, min_x));
+        max_visible_packets = qMax(max_visible_packets, live_max(series_pair.drops, series_pair.drops_max, min_x));
     }
+    apply_y_ranges(max_visible_speed, max_visible_packets);
+}
+
+void main_window::apply_y_ranges(double max_visible_speed, double max_visible_packets)
+{
     constexpr double min_y_range = 100.0;
     double new_max_y = qMax(min_y_range, max_visible_speed * 1.2);
     if (qAbs(axis_y_->max() - new_max_y) > 0.1)
     {
         axis_y_->setRange(0, new_max_y);
     }
+    double new_max_packets = qMax(min_y_range, max_visible_packets * 1.2);
+    if (qAbs(axis_packets_->max() - new_max_packets) > 0.1)
+    {
+        axis_packets_->setRange(0, new_max_packets);
+    }
 }
 
 void main_window::toggle_series_visibility(const QString& name)
@@ -659,11 +830,16 @@ void main_window::update_all_visuals()
         const interface_series& series_pair = it.value();
         bool is_target_interface = (interface_name == isolated_interface_name_);
         bool should_be_visible = !is_isolated_mode || is_target_interface;
-        series_pair.upload->setVisible(should_be_visible);
-        series_pair.download->setVisible(should_be_visible);
-        for (auto* marker : legend->markers(series_pair.upload))
+        for (auto* series : {series_pair.upload, series_pair.download, series_pair.packets, series_pair.drops})
         {
-            marker->setVisible(false);
+            series->setVisible(should_be_visible);
+        }
+        for (auto* hidden_series : {series_pair.upload, series_pair.packets, series_pair.drops})
+        {
+            for (auto* marker : legend->markers(hidden_series))
+            {
+                marker->setVisible(false);
+            }
         }
         if (series_pair.marker != nullptr)
         {
@@ -695,6 +871,7 @@ void main_window::handle_series_hovered(const QPointF& point, bool state)
         return;
     }
     QString series_type_name;
+    QString unit = "KB/s";
     for (const auto& series_pair : series_map_.values())
     {
         if (series == series_pair.upload)
@@ -707,14 +884,27 @@ void main_window::handle_series_hovered(const QPointF& point, bool state)
             series_type_name = "下载";
             break;
         }
+        if (series == series_pair.packets)
+        {
+            series_type_name = "包速率";
+            unit = "包/s";
+            break;
+        }
+        if (series == series_pair.drops)
+        {
+            series_type_name = "丢包率";
+            unit = "包/s";
+            break;
+        }
     }
     if (series_type_name.isEmpty())
     {
         return;
     }
-    QString tooltip_text = QString("%1: %2 KB/s\n时间: %3")
+    QString tooltip_text = QString("%1: %2 %3\n时间: %4")
                                .arg(series_type_name)
                                .arg(point.y(), 0, 'f', 2)
+                               .arg(unit)
                                .arg(QDateTime::fromMSecsSinceEpoch(static_cast<qint64>(point.x())).toString("hh:mm:ss"));
     tooltip_->setText(tooltip_text);
     QPointF scene_pos = chart_->mapToPosition(point, series);
@@ -1,10 +1,12 @@
 #ifndef MAIN_WINDOW_H
 #define MAIN_WINDOW_H
 
+#include <deque>
 #include <QTimer>
 #include <QMenu>
 #include <QThread>
 #include <QDateTime>
+#include <QElapsedTimer>
 #include <QMainWindow>
 #include <QCloseEvent>
 #include <QSystemTrayIcon>
@@ -26,12 +28,31 @@
 
 QT_USE_NAMESPACE
 
+// largest y inside a window whose start only moves forward, candidates that can never be the maximum again are
+// dropped on push so a live tick reads the front instead of scanning every point
+class window_max
+{
+   public:
+    void push(const QPointF& point);
+    void reset(const QList<QPointF>& points);
+    double max_from(qreal min_x);
+
+   private:
+    std::deque<QPointF> candidates_;
+};
+
 struct interface_series
 {
     QLineSeries* upload = nullptr;
     QLineSeries* download = nullptr;
+    QLineSeries* packets = nullptr;
+    QLineSeries* drops = nullptr;
     QLegendMarker* marker = nullptr;
     interface_stats last_stats;
+    window_max upload_max;
+    window_max download_max;
+    window_max packets_max;
+    window_max drops_max;
 };
 
 class main_window : public QMainWindow
@@ -47,25 +68,28 @@ class main_window : public QMainWindow
 
    signals:
     void initial_data_load_requested();
-    void request_add_snapshots(const QList<interface_stats>& stats_list, const QDateTime& timestamp);
-    void request_snapshots_in_range(quint64 request_id, const QString& interface_name, const QDateTime& start, const QDateTime& end);
+    void request_add_snapshots(const QList<interface_stats>& stats_list, const sample_time& timestamp);
+    void request_snapshots_in_range(quint64 request_id, const QStringList& interface_names, qint64 start_ms, qint64 end_ms, int pixel_width);
     void start_collector_timer(int interval_ms);
 
-    void request_add_dns_log(const dns_query_info& info);
     void start_dns_capture();
-    void request_qps_stats_from_db(quint64 request_id, const QDateTime& start, const QDateTime& end, int interval_secs);
-    void request_all_domains_from_db(quint64 request_id, const QDateTime& start, const QDateTime& end);
-    void request_dns_details_from_db(quint64 request_id, const QString& domain, const QDateTime& start, const QDateTime& end);
+    void request_qps_stats_from_db(quint64 request_id, qint64 start_ms, qint64 end_ms, int interval_secs);
+    void request_all_domains_from_db(quint64 request_id, qint64 start_ms, qint64 end_ms);
+    void request_dns_details_from_db(quint64 request_id, const QString& domain, qint64 start_ms, qint64 end_ms);
+    void request_dns_breakdown_from_db(quint64 request_id, qint64 start_ms, qint64 end_ms);
 
    private slots:
-    void handle_stats_collected(const QList<interface_stats>& stats, const QDateTime& timestamp);
-    void handle_snapshots_loaded(quint64 request_id, const QString& interface_name, const QList<traffic_point>& snapshots);
+    void handle_stats_collected(const QList<interface_stats>& stats, const sample_time& timestamp);
+    void handle_snapshots_loaded(quint64 request_id, const QList<interface_history>& histories);
     void handle_series_hovered(const QPointF& point, bool state);
-    void handle_dns_packet_collected(const dns_query_info& info);
+    void handle_interface_added(const QString& interface_name);
+    void handle_interface_removed(const QString& interface_name);
+    void handle_interface_renamed(const QString& old_name, const QString& new_name);
 
-    void handle_dns_page_qps_request(quint64 request_id, const QDateTime& start, const QDateTime& end, int interval_secs);
-    void handle_dns_page_all_domains_request(quint64 request_id, const QDateTime& start, const QDateTime& end);
-    void handle_dns_page_details_request(quint64 request_id, const QString& domain, const QDateTime& start, const QDateTime& end);
+    void handle_dns_page_qps_request(quint64 request_id, qint64 start_ms, qint64 end_ms, int interval_secs);
+    void handle_dns_page_all_domains_request(quint64 request_id, qint64 start_ms, qint64 end_ms);
+    void handle_dns_page_details_request(quint64 request_id, const QString& domain, qint64 start_ms, qint64 end_ms);
+    void handle_dns_page_breakdown_request(quint64 request_id, qint64 start_ms, qint64 end_ms);
 
     void toggle_series_visibility(const QString& name);
     void snap_back_to_live_view();
@@ -82,13 +106,18 @@ class main_window : public QMainWindow
     void setup_toolbar();
     void setup_workers();
     void add_series_for_interface(const QString& interface_name);
+    void remove_series_for_interface(const QString& interface_name);
     void update_x_axis(const QDateTime& start, const QDateTime& end);
     void rescale_y_axis();
+    void rescale_live_y_axis();
+    void apply_y_ranges(double max_visible_speed, double max_visible_packets);
     void update_all_visuals();
-    void load_data_for_display(const QDateTime& start, const QDateTime& end);
+    // an empty interface_names reloads every series
+    void load_data_for_display(const QDateTime& start, const QDateTime& end, const QStringList& interface_names = {});
     void setup_tray_icon();
+    void apply_interface_history(const interface_history& history);
     void process_loaded_data_batch();
-    void append_live_data_point(const interface_stats& current_stats, const QDateTime& timestamp);
+    void append_live_data_point(interface_series& series_pair, const interface_stats& current_stats, const sample_time& timestamp);
     void transition_to_live_view();
 
    private:
@@ -102,6 +131,7 @@ class main_window : public QMainWindow
     draggable_chartview* chart_view_ = nullptr;
     QDateTimeAxis* axis_x_ = nullptr;
     QValueAxis* axis_y_ = nullptr;
+    QValueAxis* axis_packets_ = nullptr;
     QMap<QString, interface_series> series_map_;
     QList<QColor> color_palette_;
     int color_index_ = 0;
@@ -118,8 +148,9 @@ class main_window : public QMainWindow
     database_manager* db_manager_ = nullptr;
     dns_collector* dns_collector_ = nullptr;
     quint64 current_load_request_id_ = 0;
-    qint64 pending_queries_count_ = 0;
+    bool load_pending_ = false;
     QDateTime loaded_data_start_time_;
+    QElapsedTimer last_axis_update_;
     QSystemTrayIcon* tray_icon_ = nullptr;
     QMenu* tray_menu_ = nullptr;
     QAction* show_hide_action_ = nullptr;
@@ -0,0 +1,95 @@
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#include "log.h"
+#include "sample_clock.h"
+#include "monotonic_ticker.h"
+
+static constexpr qint64 kNanosPerSecond = 1000000000;
+static constexpr qint64 kNanosPerMilli = 1000000;
+
+static timespec to_timespec(qint64 ns)
+{
+    timespec value = {};
+    value.tv_sec = static_cast<time_t>(ns / kNanosPerSecond);
+    value.tv_nsec = static_cast<long>(ns % kNanosPerSecond);
+    return value;
+}
+
+monotonic_ticker::monotonic_ticker(QObject* parent) : QObject(parent) {}
+
+monotonic_ticker::~monotonic_ticker() { stop(); }
+
+bool monotonic_ticker::start(int interval_ms)
+{
+    stop();
+    if (interval_ms <= 0)
+    {
+        return false;
+    }
+
+    fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd_ < 0)
+    {
+        LOG_ERROR("timerfd_create failed {}", std::strerror(errno));
+        return false;
+    }
+
+    // first expiry on the next interval boundary so ticks land on a fixed grid
+    const qint64 interval_ns = interval_ms * kNanosPerMilli;
+    const qint64 now_ns = sample_clock::monotonic_ns();
+    const qint64 first_ns = ((now_ns / interval_ns) + 1) * interval_ns;
+
+    itimerspec spec = {};
+    spec.it_value = to_timespec(first_ns);
+    spec.it_interval = to_timespec(interval_ns);
+    if (timerfd_settime(fd_, TFD_TIMER_ABSTIME, &spec, nullptr) < 0)
+    {
+        LOG_ERROR("timerfd_settime failed {}", std::strerror(errno));
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    last_tick_ns_ = 0;
+    notifier_ = new QSocketNotifier(fd_, QSocketNotifier::Read, this);
+    connect(notifier_, &QSocketNotifier::activated, this, &monotonic_ticker::handle_timer_ready);
+    LOG_INFO("monotonic ticker started with interval {}ms", interval_ms);
+    return true;
+}
+
+void monotonic_ticker::stop()
+{
+    if (notifier_ != nullptr)
+    {
+        notifier_->setEnabled(false);
+        delete notifier_;
+        notifier_ = nullptr;
+    }
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+void monotonic_ticker::handle_timer_ready()
+{
+    uint64_t expirations = 0;
+    ssize_t received = ::read(fd_, &expirations, sizeof(expirations));
+    if (received != static_cast<ssize_t>(sizeof(expirations)))
+    {
+        if (received < 0 && errno != EAGAIN && errno != EINTR)
+        {
+            LOG_ERROR("read timerfd failed {}", std::strerror(errno));
+        }
+        return;
+    }
+
+    const qint64 now_ns = sample_clock::monotonic_ns();
+    const qint64 actual_interval_ns = last_tick_ns_ == 0 ? 0 : now_ns - last_tick_ns_;
+    last_tick_ns_ = now_ns;
+    emit tick(expirations > 1 ? expirations - 1 : 0, actual_interval_ns);
+}
@@ -0,0 +1,34 @@
+#ifndef MONOTONIC_TICKER_H
+#define MONOTONIC_TICKER_H
+
+#include <QObject>
+#include <QSocketNotifier>
+
+// timerfd on CLOCK_MONOTONIC with expirations aligned to multiples of the interval,
+// used for sub-second sampling where QTimer slack would distort the rate math
+class monotonic_ticker : public QObject
+{
+    Q_OBJECT
+
+   public:
+    explicit monotonic_ticker(QObject* parent = nullptr);
+    ~monotonic_ticker() override;
+
+    bool start(int interval_ms);
+    void stop();
+    bool is_active() const { return notifier_ != nullptr; }
+
+   signals:
+    // missed_ticks counts expirations that were coalesced into this wakeup
+    void tick(quint64 missed_ticks, qint64 actual_interval_ns);
+
+   private slots:
+    void handle_timer_ready();
+
+   private:
+    int fd_ = -1;
+    QSocketNotifier* notifier_ = nullptr;
+    qint64 last_tick_ns_ = 0;
+};
+
+#endif
@@ -0,0 +1,321 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include "log.h"
+#include "netlink_link_reader.h"
+
+static constexpr size_t kReceiveBufferSize = 64 * 1024;
+static constexpr int kDumpAttempts = 3;
+
+netlink_link_reader::~netlink_link_reader() { close(); }
+
+bool netlink_link_reader::open()
+{
+    if (fd_ >= 0)
+    {
+        return true;
+    }
+
+    fd_ = ::socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd_ < 0)
+    {
+        LOG_ERROR("create rtnetlink socket failed {}", std::strerror(errno));
+        return false;
+    }
+
+    sockaddr_nl local = {};
+    local.nl_family = AF_NETLINK;
+    if (::bind(fd_, reinterpret_cast<sockaddr*>(&local), sizeof(local)) < 0)
+    {
+        LOG_ERROR("bind rtnetlink socket failed {}", std::strerror(errno));
+        close();
+        return false;
+    }
+
+    socklen_t local_len = sizeof(local);
+    if (::getsockname(fd_, reinterpret_cast<sockaddr*>(&local), &local_len) < 0)
+    {
+        LOG_ERROR("getsockname on rtnetlink socket failed {}", std::strerror(errno));
+        close();
+        return false;
+    }
+    port_id_ = local.nl_pid;
+    buffer_.resize(kReceiveBufferSize);
+    LOG_INFO("rtnetlink socket opened port id {}", port_id_);
+    return true;
+}
+
+void netlink_link_reader::close()
+{
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool netlink_link_reader::send_dump_request()
+{
+    struct
+    {
+        nlmsghdr header;
+        ifinfomsg info;
+    } request = {};
+
+    request.header.nlmsg_len = NLMSG_LENGTH(sizeof(ifinfomsg));
+    request.header.nlmsg_type = RTM_GETLINK;
+    request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request.header.nlmsg_seq = ++seq_;
+    request.info.ifi_family = AF_UNSPEC;
+
+    sockaddr_nl kernel = {};
+    kernel.nl_family = AF_NETLINK;
+
+    ssize_t sent = 0;
+    do
+    {
+        sent = ::sendto(fd_, &request, request.header.nlmsg_len, 0, reinterpret_cast<sockaddr*>(&kernel), sizeof(kernel));
+    } while (sent < 0 && errno == EINTR);
+
+    if (sent < 0)
+    {
+        LOG_ERROR("send RTM_GETLINK dump request failed {}", std::strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+bool netlink_link_reader::dump_links(std::vector<link_info>& links)
+{
+    for (int attempt = 1; attempt <= kDumpAttempts; ++attempt)
+    {
+        const dump_result result = dump_once(links);
+        if (result != dump_result::kRetry)
+        {
+            return result == dump_result::kOk;
+        }
+        LOG_DEBUG("RTM_GETLINK dump attempt {} of {} did not complete, retrying", attempt, kDumpAttempts);
+    }
+    LOG_ERROR("RTM_GETLINK dump did not complete after {} attempts", kDumpAttempts);
+    return false;
+}
+
+netlink_link_reader::dump_result netlink_link_reader::dump_once(std::vector<link_info>& links)
+{
+    links.clear();
+    if (fd_ < 0 || !send_dump_request())
+    {
+        return dump_result::kError;
+    }
+
+    // messages still queued from an abandoned dump carry an older sequence number and are skipped below
+    for (;;)
+    {
+        ssize_t received = ::recv(fd_, buffer_.data(), buffer_.size(), MSG_TRUNC);
+        if (received < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == ENOBUFS)
+            {
+                LOG_WARN("RTM_GETLINK dump overran the socket buffer");
+                return dump_result::kRetry;
+            }
+            LOG_ERROR("receive RTM_GETLINK dump failed {}", std::strerror(errno));
+            return dump_result::kError;
+        }
+        if (received == 0)
+        {
+            LOG_ERROR("rtnetlink socket closed during dump");
+            return dump_result::kError;
+        }
+        // with MSG_TRUNC recv reports the whole datagram length, the part past the buffer is already lost
+        if (static_cast<size_t>(received) > buffer_.size())
+        {
+            LOG_WARN("RTM_GETLINK dump message of {} bytes truncated, growing the receive buffer", received);
+            buffer_.resize(static_cast<size_t>(received));
+            return dump_result::kRetry;
+        }
+
+        auto remaining = static_cast<uint32_t>(received);
+        for (const auto* header = reinterpret_cast<const nlmsghdr*>(buffer_.data()); NLMSG_OK(header, remaining);
+             header = NLMSG_NEXT(header, remaining))
+        {
+            if (header->nlmsg_seq != seq_ || header->nlmsg_pid != port_id_)
+            {
+                continue;
+            }
+            if (header->nlmsg_type == NLMSG_DONE)
+            {
+                return dump_result::kOk;
+            }
+            if (header->nlmsg_type == NLMSG_ERROR)
+            {
+                const auto* error = static_cast<const nlmsgerr*>(NLMSG_DATA(header));
+                if (error->error == -EINTR || error->error == -EBUSY)
+                {
+                    return dump_result::kRetry;
+                }
+                LOG_ERROR("RTM_GETLINK dump returned error {}", std::strerror(-error->error));
+                return dump_result::kError;
+            }
+            if (header->nlmsg_type != RTM_NEWLINK)
+            {
+                continue;
+            }
+
+            link_info info;
+            if (parse_link_message(header, header->nlmsg_len, info))
+            {
+                links.push_back(info);
+            }
+        }
+    }
+}
+
+bool netlink_link_reader::parse_link_message(const void* data, uint32_t length, link_info& info)
+{
+    const auto* header = static_cast<const nlmsghdr*>(data);
+    if (length < NLMSG_LENGTH(sizeof(ifinfomsg)))
+    {
+        return false;
+    }
+
+    const auto* ifi = static_cast<const ifinfomsg*>(NLMSG_DATA(header));
+    info.index = ifi->ifi_index;
+    info.name[0] = '\0';
+    info.operstate = kOperStateUnknown;
+    info.has_stats = false;
+
+    auto attr_length = static_cast<unsigned int>(IFLA_PAYLOAD(header));
+    for (const auto* attr = IFLA_RTA(ifi); RTA_OK(attr, attr_length); attr = RTA_NEXT(attr, attr_length))
+    {
+        const void* payload = RTA_DATA(attr);
+        const auto payload_length = static_cast<size_t>(RTA_PAYLOAD(attr));
+        switch (attr->rta_type)
+        {
+            case IFLA_IFNAME:
+            {
+                size_t name_length = strnlen(static_cast<const char*>(payload), payload_length);
+                if (name_length >= sizeof(info.name))
+                {
+                    name_length = sizeof(info.name) - 1;
+                }
+                std::memcpy(info.name, payload, name_length);
+                info.name[name_length] = '\0';
+                break;
+            }
+            case IFLA_OPERSTATE:
+                if (payload_length >= sizeof(uint8_t))
+                {
+                    info.operstate = *static_cast<const uint8_t*>(payload);
+                }
+                break;
+            case IFLA_STATS64:
+                // the attribute payload is only 4 byte aligned so it must be copied out
+                std::memcpy(&info.stats, payload, std::min(payload_length, sizeof(info.stats)));
+                info.has_stats = true;
+                break;
+            default:
+                break;
+        }
+    }
+    return info.name[0] != '\0';
+}
+
+netlink_link_monitor::~netlink_link_monitor() { close(); }
+
+bool netlink_link_monitor::open()
+{
+    if (fd_ >= 0)
+    {
+        return true;
+    }
+
+    fd_ = ::socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_ROUTE);
+    if (fd_ < 0)
+    {
+        LOG_ERROR("create rtnetlink monitor socket failed {}", std::strerror(errno));
+        return false;
+    }
+
+    sockaddr_nl local = {};
+    local.nl_family = AF_NETLINK;
+    local.nl_groups = RTMGRP_LINK;
+    if (::bind(fd_, reinterpret_cast<sockaddr*>(&local), sizeof(local)) < 0)
+    {
+        LOG_ERROR("subscribe to RTNLGRP_LINK failed {}", std::strerror(errno));
+        close();
+        return false;
+    }
+    buffer_.resize(kReceiveBufferSize);
+    LOG_INFO("subscribed to rtnetlink link notifications");
+    return true;
+}
+
+void netlink_link_monitor::close()
+{
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+netlink_link_monitor::read_result netlink_link_monitor::read_events(std::vector<link_event>& events)
+{
+    events.clear();
+    if (fd_ < 0)
+    {
+        return read_result::kError;
+    }
+
+    for (;;)
+    {
+        ssize_t received = ::recv(fd_, buffer_.data(), buffer_.size(), 0);
+        if (received < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                return read_result::kOk;
+            }
+            if (errno == ENOBUFS)
+            {
+                LOG_WARN("rtnetlink link notifications overran the socket buffer");
+                return read_result::kOverrun;
+            }
+            LOG_ERROR("receive rtnetlink link notification failed {}", std::strerror(errno));
+            return read_result::kError;
+        }
+        if (received == 0)
+        {
+            return read_result::kError;
+        }
+
+        auto remaining = static_cast<uint32_t>(received);
+        for (const auto* header = reinterpret_cast<const nlmsghdr*>(buffer_.data()); NLMSG_OK(header, remaining);
+             header = NLMSG_NEXT(header, remaining))
+        {
+            if (header->nlmsg_type != RTM_NEWLINK && header->nlmsg_type != RTM_DELLINK)
+            {
+                continue;
+            }
+            link_event event;
+            if (netlink_link_reader::parse_link_message(header, header->nlmsg_len, event.info))
+            {
+                event.removed = header->nlmsg_type == RTM_DELLINK;
+                events.push_back(event);
+            }
+        }
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef NETLINK_LINK_READER_H
+#define NETLINK_LINK_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <linux/if_link.h>
+
+// RFC 2863 operational states as reported in IFLA_OPERSTATE
+static constexpr uint8_t kOperStateUnknown = 0;
+static constexpr uint8_t kOperStateDown = 2;
+static constexpr uint8_t kOperStateUp = 6;
+
+// matches IFNAMSIZ without pulling net/if.h into every includer
+static constexpr size_t kLinkNameSize = 16;
+
+struct link_info
+{
+    int index = 0;
+    char name[kLinkNameSize] = {};
+    uint8_t operstate = 0;
+    bool has_stats = false;
+    rtnl_link_stats64 stats = {};
+};
+
+struct link_event
+{
+    link_info info;
+    bool removed = false;
+};
+
+class netlink_link_reader
+{
+   public:
+    netlink_link_reader() = default;
+    ~netlink_link_reader();
+
+    netlink_link_reader(const netlink_link_reader&) = delete;
+    netlink_link_reader& operator=(const netlink_link_reader&) = delete;
+
+    bool open();
+    void close();
+    bool is_open() const { return fd_ >= 0; }
+
+    // one RTM_GETLINK dump over the persistent socket, links is reused between calls, an overrun or truncated
+    // dump is restarted a few times before giving up
+    bool dump_links(std::vector<link_info>& links);
+
+    static bool parse_link_message(const void* data, uint32_t length, link_info& info);
+
+   private:
+    enum class dump_result : uint8_t
+    {
+        kOk,
+        kRetry,
+        kError
+    };
+
+    bool send_dump_request();
+    dump_result dump_once(std::vector<link_info>& links);
+
+   private:
+    int fd_ = -1;
+    uint32_t seq_ = 0;
+    uint32_t port_id_ = 0;
+    std::vector<char> buffer_;
+};
+
+class netlink_link_monitor
+{
+   public:
+    enum class read_result : uint8_t
+    {
+        kOk,
+        kOverrun,
+        kError
+    };
+
+    netlink_link_monitor() = default;
+    ~netlink_link_monitor();
+
+    netlink_link_monitor(const netlink_link_monitor&) = delete;
+    netlink_link_monitor& operator=(const netlink_link_monitor&) = delete;
+
+    // non blocking socket subscribed to RTNLGRP_LINK
+    bool open();
+    void close();
+    int fd() const { return fd_; }
+
+    // drains every pending notification, kOverrun means events were lost and a full dump is needed
+    read_result read_events(std::vector<link_event>& events);
+
+   private:
+    int fd_ = -1;
+    std::vector<char> buffer_;
+};
+
+#endif
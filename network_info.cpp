@@ -1,68 +1,194 @@
-#include <QDir>
-#include <QFile>
+#include "log.h"
 #include "network_info.h"
 
+static constexpr std::string_view kIgnoredPrefixes[] = {"lo", "tailscale", "vnet", "veth", "br-", "docker", "virbr", "vmnet"};
+
+network_info::network_info(backend preferred) : backend_(preferred) {}
+
+const char* network_info::backend_name(backend type)
+{
+    switch (type)
+    {
+        case backend::kNetlink:
+            return "netlink";
+        case backend::kProcNetDev:
+            return "procfs";
+        case backend::kSysfs:
+            return "sysfs";
+    }
+    return "unknown";
+}
+
+bool network_info::is_ignored_interface(std::string_view name)
+{
+    for (const auto& prefix : kIgnoredPrefixes)
+    {
+        if (name.substr(0, prefix.size()) == prefix)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void network_info::set_running_interfaces(const QStringList& names)
+{
+    running_names_ = QSet<QString>(names.begin(), names.end());
+    running_names_known_ = true;
+}
+
+void network_info::clear_running_interfaces()
+{
+    running_names_.clear();
+    running_names_known_ = false;
+}
+
 QList<interface_stats> network_info::get_all_stats()
 {
     QList<interface_stats> stats_list;
-    QDir net_dir("/sys/class/net/");
-    QStringList interface_list = net_dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
-    static const QStringList ignored_prefixes = {"lo", "tailscale", "vnet", "veth", "br-", "docker", "virbr", "vmnet"};
-    for (const QString& if_name : interface_list)
+    if (backend_ == backend::kNetlink)
     {
-        bool ignore = false;
-        for (const QString& prefix : ignored_prefixes)
+        if (get_netlink_stats(stats_list))
         {
-            if (if_name.startsWith(prefix))
-            {
-                ignore = true;
-                break;
-            }
+            return stats_list;
         }
-        if (ignore)
+        // a fresh socket drops whatever the failed dump left queued on the old one
+        LOG_WARN("netlink stats dump failed reopening the rtnetlink socket");
+        netlink_reader_.close();
+        if (get_netlink_stats(stats_list))
+        {
+            return stats_list;
+        }
+        LOG_WARN("netlink stats backend unavailable falling back to sysfs");
+        netlink_reader_.close();
+        backend_ = backend::kSysfs;
+    }
+    else if (backend_ == backend::kProcNetDev)
+    {
+        if (get_proc_net_dev_stats(stats_list))
+        {
+            return stats_list;
+        }
+        LOG_WARN("/proc/net/dev read failed reopening the file");
+        proc_reader_.close();
+        if (get_proc_net_dev_stats(stats_list))
+        {
+            return stats_list;
+        }
+        LOG_WARN("/proc/net/dev stats backend unavailable falling back to sysfs");
+        proc_reader_.close();
+        backend_ = backend::kSysfs;
+    }
+    get_sysfs_stats(stats_list);
+    return stats_list;
+}
+
+bool network_info::get_netlink_stats(QList<interface_stats>& stats_list)
+{
+    if (!netlink_reader_.open() || !netlink_reader_.dump_links(links_))
+    {
+        return false;
+    }
+    append_link_stats(stats_list);
+    return true;
+}
+
+void network_info::append_link_stats(QList<interface_stats>& stats_list)
+{
+    stats_list.reserve(static_cast<qsizetype>(links_.size()));
+    for (const auto& link : links_)
+    {
+        if (link.operstate != kOperStateUp && link.operstate != kOperStateUnknown)
         {
             continue;
         }
-        QFile operstate_file(net_dir.filePath(if_name + "/operstate"));
-        if (!operstate_file.open(QIODevice::ReadOnly))
+        if (is_ignored_interface(link.name))
         {
             continue;
         }
 
-        QString state = operstate_file.readAll().trimmed();
-        if (state != "up" && state != "unknown")
+        // reuse the cached name so steady state ticks share one string per interface
+        QString& cached_name = name_cache_[link.index];
+        if (cached_name != QLatin1String(link.name))
         {
-            operstate_file.close();
-            continue;
+            cached_name = QString::fromLatin1(link.name);
         }
-        operstate_file.close();
-        interface_stats stats;
-        stats.name = if_name;
 
-        QFile rx_file(net_dir.filePath(if_name + "/statistics/rx_bytes"));
-        if (rx_file.open(QIODevice::ReadOnly))
+        interface_stats stats;
+        stats.name = cached_name;
+        if (link.has_stats)
         {
-            stats.bytes_received = rx_file.readAll().trimmed().toULongLong();
-            rx_file.close();
+            stats.bytes_received = link.stats.rx_bytes;
+            stats.bytes_sent = link.stats.tx_bytes;
+            stats.rx_packets = link.stats.rx_packets;
+            stats.tx_packets = link.stats.tx_packets;
+            stats.rx_errors = link.stats.rx_errors;
+            stats.tx_errors = link.stats.tx_errors;
+            stats.rx_dropped = link.stats.rx_dropped;
+            stats.tx_dropped = link.stats.tx_dropped;
+            stats.rx_fifo_errors = link.stats.rx_fifo_errors;
+            stats.tx_fifo_errors = link.stats.tx_fifo_errors;
+            stats.multicast = link.stats.multicast;
         }
-        else
+        stats_list.append(stats);
+    }
+}
+
+bool network_info::get_proc_net_dev_stats(QList<interface_stats>& stats_list)
+{
+    if (!proc_reader_.open() || !proc_reader_.read(proc_entries_))
+    {
+        return false;
+    }
+
+    stats_list.reserve(static_cast<qsizetype>(proc_entries_.size()));
+    if (proc_name_cache_.size() < static_cast<qsizetype>(proc_entries_.size()))
+    {
+        proc_name_cache_.resize(static_cast<qsizetype>(proc_entries_.size()));
+    }
+    for (size_t i = 0; i < proc_entries_.size(); ++i)
+    {
+        const auto& entry = proc_entries_[i];
+        if (is_ignored_interface(entry.name_view()))
         {
-            stats.bytes_received = 0;
+            continue;
         }
 
-        QFile tx_file(net_dir.filePath(if_name + "/statistics/tx_bytes"));
-        if (tx_file.open(QIODevice::ReadOnly))
+        // the kernel keeps /proc/net/dev order stable so the cache is indexed by line
+        QString& cached_name = proc_name_cache_[static_cast<qsizetype>(i)];
+        if (cached_name != QLatin1String(entry.name, static_cast<qsizetype>(entry.name_length)))
         {
-            stats.bytes_sent = tx_file.readAll().trimmed().toULongLong();
-            tx_file.close();
+            cached_name = QString::fromLatin1(entry.name, static_cast<qsizetype>(entry.name_length));
         }
-        else
+        if (running_names_known_ ? !running_names_.contains(cached_name) : !proc_reader_.is_running(entry))
         {
-            stats.bytes_sent = 0;
+            continue;
         }
 
+        interface_stats stats;
+        stats.name = cached_name;
+        stats.bytes_received = entry.rx_bytes;
+        stats.bytes_sent = entry.tx_bytes;
+        stats.rx_packets = entry.rx_packets;
+        stats.tx_packets = entry.tx_packets;
+        stats.rx_errors = entry.rx_errors;
+        stats.tx_errors = entry.tx_errors;
+        stats.rx_dropped = entry.rx_dropped;
+        stats.tx_dropped = entry.tx_dropped;
+        stats.rx_fifo_errors = entry.rx_fifo_errors;
+        stats.tx_fifo_errors = entry.tx_fifo_errors;
+        stats.multicast = entry.multicast;
         stats_list.append(stats);
     }
+    return true;
+}
 
-    return stats_list;
+bool network_info::get_sysfs_stats(QList<interface_stats>& stats_list)
+{
+    if (!sysfs_reader_.open() || !sysfs_reader_.read(links_, &network_info::is_ignored_interface))
+    {
+        return false;
+    }
+    append_link_stats(stats_list);
+    return true;
 }
@@ -1,23 +1,75 @@
 #ifndef NETWORK_INFO_H
 #define NETWORK_INFO_H
 
+#include <string_view>
+#include <vector>
 #include <QString>
 #include <QList>
 #include <QPair>
-#include <QDateTime>
+#include <QHash>
+#include <QSet>
+#include "netlink_link_reader.h"
+#include "proc_net_dev_reader.h"
+#include "sysfs_stats_reader.h"
+#include "sample_clock.h"
 
 struct interface_stats
 {
     QString name;
-    quint64 bytes_received;
-    quint64 bytes_sent;
-    QDateTime timestamp;
+    quint64 bytes_received = 0;
+    quint64 bytes_sent = 0;
+    quint64 rx_packets = 0;
+    quint64 tx_packets = 0;
+    quint64 rx_errors = 0;
+    quint64 tx_errors = 0;
+    quint64 rx_dropped = 0;
+    quint64 tx_dropped = 0;
+    quint64 rx_fifo_errors = 0;
+    quint64 tx_fifo_errors = 0;
+    quint64 multicast = 0;
+    sample_time timestamp;
 };
 
 class network_info
 {
    public:
-    static QList<interface_stats> get_all_stats();
+    enum class backend : uint8_t
+    {
+        kNetlink,
+        kProcNetDev,
+        kSysfs
+    };
+
+    explicit network_info(backend preferred = backend::kNetlink);
+
+    QList<interface_stats> get_all_stats();
+    backend active_backend() const { return backend_; }
+    // the up or running interfaces as the link notifications report them, /proc/net/dev rows are filtered by
+    // this set instead of an interface flags ioctl per row until cleared
+    void set_running_interfaces(const QStringList& names);
+    void clear_running_interfaces();
+
+    static bool is_ignored_interface(std::string_view name);
+    static const char* backend_name(backend type);
+
+   private:
+    bool get_netlink_stats(QList<interface_stats>& stats_list);
+    bool get_proc_net_dev_stats(QList<interface_stats>& stats_list);
+    bool get_sysfs_stats(QList<interface_stats>& stats_list);
+    // turns links_ as the netlink or sysfs reader left it into stats rows
+    void append_link_stats(QList<interface_stats>& stats_list);
+
+   private:
+    backend backend_;
+    netlink_link_reader netlink_reader_;
+    std::vector<link_info> links_;
+    QHash<int, QString> name_cache_;
+    proc_net_dev_reader proc_reader_;
+    std::vector<proc_net_dev_entry> proc_entries_;
+    QList<QString> proc_name_cache_;
+    QSet<QString> running_names_;
+    bool running_names_known_ = false;
+    sysfs_stats_reader sysfs_reader_;
 };
 
 #endif
@@ -0,0 +1,301 @@
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <arpa/inet.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <linux/filter.h>
+#include <linux/if_arp.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include "log.h"
+#include "packet_ring_capture.h"
+
+static constexpr unsigned int kBlockSize = 1U << 18;
+static constexpr unsigned int kBlockCount = 16;
+static constexpr unsigned int kFrameSize = 1U << 11;
+static constexpr unsigned int kBlockRetireTimeoutMs = 50;
+static constexpr int kPollTimeoutMs = 100;
+
+// classic bpf takes the negative ancillary offsets as unsigned
+static constexpr uint32_t kSkbProtocol = static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_PROTOCOL);
+static constexpr uint32_t net_offset(int offset) { return static_cast<uint32_t>(SKF_NET_OFF + offset); }
+
+// "udp port 53 or tcp port 53" with every load relative to the network header and the protocol taken from the
+// skb, so the same program works whether the ring sees a link header or not, non first ipv4 fragments are rejected
+static sock_filter kDnsPortFilter[] = {
+    BPF_STMT(BPF_LD | BPF_H | BPF_ABS, kSkbProtocol),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ETH_P_IPV6, 0, 7),
+    BPF_STMT(BPF_LD | BPF_B | BPF_ABS, net_offset(6)),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_TCP, 1, 0),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_UDP, 0, 16),
+    BPF_STMT(BPF_LD | BPF_H | BPF_ABS, net_offset(40)),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 53, 13, 0),
+    BPF_STMT(BPF_LD | BPF_H | BPF_ABS, net_offset(42)),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 53, 11, 12),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ETH_P_IP, 0, 11),
+    BPF_STMT(BPF_LD | BPF_B | BPF_ABS, net_offset(9)),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_TCP, 1, 0),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_UDP, 0, 8),
+    BPF_STMT(BPF_LD | BPF_H | BPF_ABS, net_offset(6)),
+    BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x1fff, 6, 0),
+    BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, net_offset(0)),
+    BPF_STMT(BPF_LD | BPF_H | BPF_IND, net_offset(0)),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 53, 2, 0),
+    BPF_STMT(BPF_LD | BPF_H | BPF_IND, net_offset(2)),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 53, 0, 1),
+    BPF_STMT(BPF_RET | BPF_K, 262144),
+    BPF_STMT(BPF_RET | BPF_K, 0),
+};
+
+// reads the hardware type of the device, -1 when it cannot be asked
+static int device_hardware_type(const std::string& device_name)
+{
+    const int probe = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (probe < 0)
+    {
+        return -1;
+    }
+    ifreq request = {};
+    std::strncpy(request.ifr_name, device_name.c_str(), sizeof(request.ifr_name) - 1);
+    const int result = ::ioctl(probe, SIOCGIFHWADDR, &request);
+    ::close(probe);
+    return result < 0 ? -1 : request.ifr_hwaddr.sa_family;
+}
+
+packet_ring_capture::~packet_ring_capture() { close(); }
+
+bool packet_ring_capture::open(const std::string& device_name)
+{
+    if (fd_ >= 0)
+    {
+        return true;
+    }
+    device_name_ = device_name;
+
+    const unsigned int if_index = if_nametoindex(device_name.c_str());
+    if (if_index == 0)
+    {
+        LOG_ERROR("packet ring device {} not found {}", device_name, std::strerror(errno));
+        return false;
+    }
+
+    // a device without an ethernet header is read through SOCK_DGRAM, the kernel then strips whatever link header
+    // it has and every frame starts at the ip header
+    const int hardware_type = device_hardware_type(device_name);
+    const bool ethernet = hardware_type == ARPHRD_ETHER || hardware_type == ARPHRD_LOOPBACK;
+    link_type_ = ethernet ? kRingLinkTypeEthernet : kRingLinkTypeRaw;
+
+    fd_ = ::socket(AF_PACKET, (ethernet ? SOCK_RAW : SOCK_DGRAM) | SOCK_CLOEXEC, htons(ETH_P_ALL));
+    if (fd_ < 0)
+    {
+        LOG_ERROR("create AF_PACKET socket for {} failed {}", device_name, std::strerror(errno));
+        return false;
+    }
+
+    // the filter goes on before bind so no unfiltered frame reaches the ring
+    if (!attach_filter() || !setup_ring())
+    {
+        close();
+        return false;
+    }
+
+    sockaddr_ll local = {};
+    local.sll_family = AF_PACKET;
+    local.sll_protocol = htons(ETH_P_ALL);
+    local.sll_ifindex = static_cast<int>(if_index);
+    if (::bind(fd_, reinterpret_cast<sockaddr*>(&local), sizeof(local)) < 0)
+    {
+        LOG_ERROR("bind AF_PACKET socket to {} failed {}", device_name, std::strerror(errno));
+        close();
+        return false;
+    }
+
+    LOG_INFO("packet ring opened on {} {} blocks of {} bytes hardware type {} link type {}",
+             device_name,
+             block_count_,
+             block_size_,
+             hardware_type,
+             link_type_);
+    return true;
+}
+
+bool packet_ring_capture::attach_filter()
+{
+    sock_fprog program = {};
+    program.len = static_cast<unsigned short>(sizeof(kDnsPortFilter) / sizeof(kDnsPortFilter[0]));
+    program.filter = kDnsPortFilter;
+    if (::setsockopt(fd_, SOL_SOCKET, SO_ATTACH_FILTER, &program, sizeof(program)) < 0)
+    {
+        LOG_ERROR("attach dns bpf filter on {} failed {}", device_name_, std::strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+bool packet_ring_capture::setup_ring()
+{
+    int version = TPACKET_V3;
+    if (::setsockopt(fd_, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0)
+    {
+        LOG_ERROR("TPACKET_V3 not supported on {} {}", device_name_, std::strerror(errno));
+        return false;
+    }
+
+    tpacket_req3 request = {};
+    request.tp_block_size = kBlockSize;
+    request.tp_block_nr = kBlockCount;
+    request.tp_frame_size = kFrameSize;
+    request.tp_frame_nr = (kBlockSize * kBlockCount) / kFrameSize;
+    request.tp_retire_blk_tov = kBlockRetireTimeoutMs;
+    if (::setsockopt(fd_, SOL_PACKET, PACKET_RX_RING, &request, sizeof(request)) < 0)
+    {
+        LOG_ERROR("request packet rx ring on {} failed {}", device_name_, std::strerror(errno));
+        return false;
+    }
+
+    ring_size_ = static_cast<size_t>(kBlockSize) * kBlockCount;
+    void* mapped = ::mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, 0);
+    if (mapped == MAP_FAILED)
+    {
+        LOG_ERROR("mmap packet rx ring on {} failed {}", device_name_, std::strerror(errno));
+        ring_size_ = 0;
+        return false;
+    }
+    ring_ = static_cast<uint8_t*>(mapped);
+    block_size_ = kBlockSize;
+    block_count_ = kBlockCount;
+    return true;
+}
+
+void packet_ring_capture::close()
+{
+    stop();
+    if (ring_ != nullptr)
+    {
+        ::munmap(ring_, ring_size_);
+        ring_ = nullptr;
+        ring_size_ = 0;
+    }
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool packet_ring_capture::start(frame_handler handler, void* cookie)
+{
+    if (fd_ < 0 || handler == nullptr || running_)
+    {
+        return false;
+    }
+    handler_ = handler;
+    cookie_ = cookie;
+    running_ = true;
+    thread_ = std::thread(&packet_ring_capture::capture_loop, this);
+    return true;
+}
+
+void packet_ring_capture::stop()
+{
+    running_ = false;
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+}
+
+void packet_ring_capture::capture_loop()
+{
+    unsigned int current = 0;
+    pollfd waiter = {};
+    waiter.fd = fd_;
+    waiter.events = POLLIN | POLLERR;
+
+    while (running_)
+    {
+        auto* block = ring_ + static_cast<size_t>(current) * block_size_;
+        auto* descriptor = reinterpret_cast<tpacket_block_desc*>(block);
+        if ((__atomic_load_n(&descriptor->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0)
+        {
+            waiter.revents = 0;
+            if (::poll(&waiter, 1, kPollTimeoutMs) < 0 && errno != EINTR)
+            {
+                LOG_ERROR("poll on packet ring {} failed {}", device_name_, std::strerror(errno));
+                break;
+            }
+            if ((waiter.revents & POLLNVAL) != 0)
+            {
+                LOG_ERROR("packet ring {} socket is no longer valid", device_name_);
+                break;
+            }
+            // a pending socket error keeps poll returning at once until it is read
+            if ((waiter.revents & POLLERR) != 0)
+            {
+                clear_socket_error();
+            }
+            continue;
+        }
+
+        process_block(block);
+        // hand the whole block back to the kernel in one store
+        __atomic_store_n(&descriptor->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+        blocks_.fetch_add(1, std::memory_order_relaxed);
+        current = (current + 1) % block_count_;
+    }
+}
+
+void packet_ring_capture::clear_socket_error()
+{
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (::getsockopt(fd_, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error != 0)
+    {
+        LOG_WARN("packet ring {} socket error {}", device_name_, std::strerror(error));
+    }
+    // anything left on the error queue would raise POLLERR again
+    char discard[256];
+    while (::recv(fd_, discard, sizeof(discard), MSG_ERRQUEUE | MSG_DONTWAIT) >= 0)
+    {
+    }
+}
+
+void packet_ring_capture::process_block(uint8_t* block)
+{
+    const auto* descriptor = reinterpret_cast<const tpacket_block_desc*>(block);
+    const uint32_t packet_count = descriptor->hdr.bh1.num_pkts;
+    const auto* header = reinterpret_cast<const tpacket3_hdr*>(block + descriptor->hdr.bh1.offset_to_first_pkt);
+    for (uint32_t i = 0; i < packet_count; ++i)
+    {
+        timespec timestamp = {};
+        timestamp.tv_sec = static_cast<time_t>(header->tp_sec);
+        timestamp.tv_nsec = static_cast<long>(header->tp_nsec);
+        handler_(reinterpret_cast<const uint8_t*>(header) + header->tp_mac, header->tp_snaplen, timestamp, link_type_, cookie_);
+        header = reinterpret_cast<const tpacket3_hdr*>(reinterpret_cast<const uint8_t*>(header) + header->tp_next_offset);
+    }
+}
+
+bool packet_ring_capture::read_statistics(packet_ring_stats& stats)
+{
+    if (fd_ < 0)
+    {
+        return false;
+    }
+    tpacket_stats_v3 kernel_stats = {};
+    socklen_t length = sizeof(kernel_stats);
+    if (::getsockopt(fd_, SOL_PACKET, PACKET_STATISTICS, &kernel_stats, &length) < 0)
+    {
+        LOG_ERROR("read packet ring statistics on {} failed {}", device_name_, std::strerror(errno));
+        return false;
+    }
+    totals_.packets += kernel_stats.tp_packets;
+    totals_.drops += kernel_stats.tp_drops;
+    totals_.freeze_count += kernel_stats.tp_freeze_q_cnt;
+    totals_.blocks = blocks_.load(std::memory_order_relaxed);
+    stats = totals_;
+    return true;
+}
@@ -0,0 +1,74 @@
+#ifndef PACKET_RING_CAPTURE_H
+#define PACKET_RING_CAPTURE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <thread>
+
+struct packet_ring_stats
+{
+    uint64_t packets = 0;
+    uint64_t drops = 0;
+    uint64_t freeze_count = 0;
+    uint64_t blocks = 0;
+};
+
+// pcap LINKTYPE_ values the ring frames are delivered as
+static constexpr uint16_t kRingLinkTypeEthernet = 1;
+static constexpr uint16_t kRingLinkTypeRaw = 101;
+
+// AF_PACKET TPACKET_V3 receive ring with a kernel BPF filter for port 53,
+// frames are handed to the handler straight from the mapped block without copying
+class packet_ring_capture
+{
+   public:
+    using frame_handler = void (*)(const uint8_t* data, uint32_t length, const timespec& timestamp, uint16_t link_type, void* cookie);
+
+    packet_ring_capture() = default;
+    ~packet_ring_capture();
+
+    packet_ring_capture(const packet_ring_capture&) = delete;
+    packet_ring_capture& operator=(const packet_ring_capture&) = delete;
+
+    bool open(const std::string& device_name);
+    void close();
+    bool is_open() const { return fd_ >= 0; }
+    const std::string& name() const { return device_name_; }
+    // ethernet and loopback devices keep their link header, every other device is read from the network header
+    uint16_t link_type() const { return link_type_; }
+
+    // runs the block loop on its own thread until stop
+    bool start(frame_handler handler, void* cookie);
+    void stop();
+
+    // kernel counters reset on every read so they are accumulated here
+    bool read_statistics(packet_ring_stats& stats);
+
+   private:
+    bool attach_filter();
+    bool setup_ring();
+    void capture_loop();
+    void process_block(uint8_t* block);
+    void clear_socket_error();
+
+   private:
+    int fd_ = -1;
+    std::string device_name_;
+    uint16_t link_type_ = kRingLinkTypeEthernet;
+    uint8_t* ring_ = nullptr;
+    size_t ring_size_ = 0;
+    unsigned int block_size_ = 0;
+    unsigned int block_count_ = 0;
+
+    frame_handler handler_ = nullptr;
+    void* cookie_ = nullptr;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> blocks_{0};
+    packet_ring_stats totals_;
+};
+
+#endif
@@ -0,0 +1,302 @@
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDate>
+#include <QRegularExpression>
+#include "log.h"
+#include "scoped_exit.h"
+#include "partition_store.h"
+
+// partitions are numbered by utc day since the epoch
+static const QDate kEpochDate(1970, 1, 1);
+
+static const char* kind_prefix(partition_kind kind) { return kind == partition_kind::kTraffic ? "traffic" : "dns"; }
+
+static const char* const kTrafficSchema[] = {
+    "CREATE TABLE IF NOT EXISTS traffic_snapshots ("
+    "interface_id INTEGER NOT NULL, "
+    "timestamp INTEGER NOT NULL, "
+    "bytes_received INTEGER NOT NULL, "
+    "bytes_sent INTEGER NOT NULL, "
+    "rx_packets INTEGER NOT NULL DEFAULT 0, "
+    "tx_packets INTEGER NOT NULL DEFAULT 0, "
+    "rx_errors INTEGER NOT NULL DEFAULT 0, "
+    "tx_errors INTEGER NOT NULL DEFAULT 0, "
+    "rx_dropped INTEGER NOT NULL DEFAULT 0, "
+    "tx_dropped INTEGER NOT NULL DEFAULT 0, "
+    "rx_fifo_errors INTEGER NOT NULL DEFAULT 0, "
+    "tx_fifo_errors INTEGER NOT NULL DEFAULT 0, "
+    "multicast INTEGER NOT NULL DEFAULT 0, "
+    "PRIMARY KEY (interface_id, timestamp)"
+    ") WITHOUT ROWID",
+    // traffic_block encoded hours, used instead of traffic_snapshots when block storage is selected
+    "CREATE TABLE IF NOT EXISTS traffic_blocks ("
+    "interface_id INTEGER NOT NULL, "
+    "block_start INTEGER NOT NULL, "
+    "samples INTEGER NOT NULL, "
+    "last_timestamp INTEGER NOT NULL, "
+    "data BLOB NOT NULL, "
+    "PRIMARY KEY (interface_id, block_start)"
+    ") WITHOUT ROWID",
+    nullptr};
+
+static const char* const kDnsSchema[] = {
+    "CREATE TABLE IF NOT EXISTS dns_logs ("
+    "timestamp INTEGER NOT NULL, "
+    "transaction_id INTEGER NOT NULL, "
+    "direction INTEGER NOT NULL, "
+    "query_domain TEXT NOT NULL, "
+    "query_type TEXT NOT NULL, "
+    "response_code TEXT, "
+    "response_data TEXT, "
+    "resolver_ip TEXT NOT NULL"
+    ")",
+    "CREATE INDEX IF NOT EXISTS idx_dns_log_time ON dns_logs (timestamp)",
+    // request and response counts per kDnsBucketMs, maintained by the writer with every dns_logs batch
+    "CREATE TABLE IF NOT EXISTS dns_buckets ("
+    "bucket_start INTEGER NOT NULL, "
+    "direction INTEGER NOT NULL, "
+    "query_type TEXT NOT NULL, "
+    "response_code TEXT NOT NULL, "
+    "count INTEGER NOT NULL, "
+    "PRIMARY KEY (bucket_start, direction, query_type, response_code)"
+    ") WITHOUT ROWID",
+    nullptr};
+
+// partitions written before dns_buckets existed get their counts rebuilt once when the writer opens them,
+// backfill_dns_buckets opens the ones no write reaches
+static const std::string kDnsBucketBackfillSql =
+    "INSERT INTO dns_buckets (bucket_start, direction, query_type, response_code, count) "
+    "SELECT (timestamp / " + std::to_string(partition_store::kDnsBucketMs) + ") * " + std::to_string(partition_store::kDnsBucketMs) +
+    ", direction, query_type, IFNULL(response_code, ''), COUNT(*) FROM dns_logs GROUP BY 1, 2, 3, 4";
+
+bool partition_store::has_table(sqlite_database& db, const char* table)
+{
+    sqlite_statement* lookup = db.statement("SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = ?1");
+    if (lookup == nullptr)
+    {
+        return false;
+    }
+    DEFER(lookup->reset());
+    lookup->bind_text(1, std::string_view(table));
+    return lookup->step() == sqlite_statement::step_result::kRow;
+}
+
+bool partition_store::open(const QString& directory, bool read_only)
+{
+    directory_ = directory;
+    read_only_ = read_only;
+    QDir dir(directory_);
+    if (!read_only_ && !dir.exists() && !dir.mkpath("."))
+    {
+        LOG_ERROR("create partition directory {} failed", directory_.toStdString());
+        return false;
+    }
+    rescan();
+    LOG_INFO("found {} traffic and {} dns partitions in {}", traffic_.size(), dns_.size(), directory_.toStdString());
+    return true;
+}
+
+void partition_store::rescan()
+{
+    const QDir dir(directory_);
+    std::map<qint64, QString> found[2];
+    static const QRegularExpression kFilePattern("^(traffic|dns)-(\\d{8})\\.db$");
+    for (const QString& name : dir.entryList({"*.db"}, QDir::Files))
+    {
+        const auto match = kFilePattern.match(name);
+        if (!match.hasMatch())
+        {
+            continue;
+        }
+        const QDate date = QDate::fromString(match.captured(2), "yyyyMMdd");
+        if (!date.isValid())
+        {
+            continue;
+        }
+        found[match.captured(1) == "traffic" ? 0 : 1][kEpochDate.daysTo(date)] = dir.filePath(name);
+    }
+
+    for (const partition_kind kind : {partition_kind::kTraffic, partition_kind::kDns})
+    {
+        auto& map = partitions(kind);
+        const auto& files = found[kind == partition_kind::kTraffic ? 0 : 1];
+        for (auto it = map.begin(); it != map.end();)
+        {
+            // a writable store also keeps partitions it created whose file is not flushed to the directory yet
+            it = read_only_ && files.count(it->first) == 0 ? map.erase(it) : std::next(it);
+        }
+        for (const auto& [day, path] : files)
+        {
+            map.emplace(day, partition_file{path, nullptr});
+        }
+    }
+}
+
+void partition_store::close()
+{
+    traffic_.clear();
+    dns_.clear();
+}
+
+QString partition_store::path_for(partition_kind kind, qint64 day) const
+{
+    const QString date = kEpochDate.addDays(day).toString("yyyyMMdd");
+    return QDir(directory_).filePath(QString("%1-%2.db").arg(kind_prefix(kind), date));
+}
+
+sqlite_database* partition_store::connect(partition_kind kind, partition_file& part)
+{
+    if (part.db != nullptr)
+    {
+        return part.db.get();
+    }
+    auto db = std::make_unique<sqlite_database>();
+    if (read_only_)
+    {
+        if (!db->open(part.path, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX))
+        {
+            return nullptr;
+        }
+        part.db = std::move(db);
+        return part.db.get();
+    }
+    if (!db->open(part.path))
+    {
+        return nullptr;
+    }
+    db->exec("PRAGMA journal_mode = WAL;");
+    // the table and its rebuilt counts appear together, so a failed rebuild is retried on the next open
+    const bool had_buckets = kind != partition_kind::kDns || has_table(*db, "dns_buckets");
+    if (!had_buckets && !db->begin())
+    {
+        return nullptr;
+    }
+    for (const char* const* sql = kind == partition_kind::kTraffic ? kTrafficSchema : kDnsSchema; *sql != nullptr; ++sql)
+    {
+        if (!db->exec(*sql))
+        {
+            LOG_ERROR("create schema in partition {} failed {}", part.path.toStdString(), db->last_error());
+            return nullptr;
+        }
+    }
+    if (!had_buckets && (!db->exec(kDnsBucketBackfillSql.c_str()) || !db->commit()))
+    {
+        LOG_ERROR("rebuild dns buckets in partition {} failed {}", part.path.toStdString(), db->last_error());
+        db->rollback();
+        return nullptr;
+    }
+    part.db = std::move(db);
+    return part.db.get();
+}
+
+sqlite_database* partition_store::partition(partition_kind kind, qint64 timestamp_ms, bool create)
+{
+    const qint64 day = timestamp_ms / kPartitionMs;
+    auto& map = partitions(kind);
+    auto it = map.find(day);
+    if (it == map.end())
+    {
+        if (!create || read_only_)
+        {
+            return nullptr;
+        }
+        it = map.emplace(day, partition_file{path_for(kind, day), nullptr}).first;
+        LOG_INFO("opening new partition {}", it->second.path.toStdString());
+    }
+    return connect(kind, it->second);
+}
+
+std::vector<sqlite_database*> partition_store::overlapping(partition_kind kind, qint64 start_ms, qint64 end_ms)
+{
+    std::vector<sqlite_database*> result;
+    auto& map = partitions(kind);
+    for (auto it = map.lower_bound(start_ms / kPartitionMs); it != map.end() && it->first <= end_ms / kPartitionMs; ++it)
+    {
+        if (auto* db = connect(kind, it->second); db != nullptr)
+        {
+            result.push_back(db);
+        }
+    }
+    return result;
+}
+
+std::optional<qint64> partition_store::oldest_start_ms(partition_kind kind) const
+{
+    const auto& map = partitions(kind);
+    if (map.empty())
+    {
+        return std::nullopt;
+    }
+    return map.begin()->first * kPartitionMs;
+}
+
+void partition_store::unlink(partition_file& part)
+{
+    // statements and the connection go first so the wal is checkpointed and released before the unlink
+    part.db.reset();
+    for (const QString& suffix : {QString(), QString("-wal"), QString("-shm")})
+    {
+        QFile::remove(part.path + suffix);
+    }
+    LOG_INFO("dropped partition {}", part.path.toStdString());
+}
+
+int partition_store::drop_before(partition_kind kind, qint64 cutoff_ms)
+{
+    int dropped = 0;
+    auto& map = partitions(kind);
+    while (!map.empty() && (map.begin()->first + 1) * kPartitionMs <= cutoff_ms)
+    {
+        unlink(map.begin()->second);
+        map.erase(map.begin());
+        dropped++;
+    }
+    return dropped;
+}
+
+bool partition_store::backfill_dns_buckets()
+{
+    auto it = dns_.lower_bound(dns_bucket_day_);
+    if (read_only_ || it == dns_.end())
+    {
+        return false;
+    }
+    dns_bucket_day_ = it->first + 1;
+    if (it->second.db == nullptr)
+    {
+        // connect does the rebuild, an old day is not kept open afterwards
+        connect(partition_kind::kDns, it->second);
+        it->second.db.reset();
+    }
+    return std::next(it) != dns_.end();
+}
+
+std::vector<sqlite_database*> partition_store::open_connections() const
+{
+    std::vector<sqlite_database*> result;
+    for (const auto* map : {&traffic_, &dns_})
+    {
+        for (const auto& [day, part] : *map)
+        {
+            if (part.db != nullptr)
+            {
+                result.push_back(part.db.get());
+            }
+        }
+    }
+    return result;
+}
+
+qint64 partition_store::disk_bytes() const
+{
+    qint64 total = 0;
+    for (const auto* map : {&traffic_, &dns_})
+    {
+        for (const auto& [day, part] : *map)
+        {
+            total += QFileInfo(part.path).size() + QFileInfo(part.path + "-wal").size();
+        }
+    }
+    return total;
+}
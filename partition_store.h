@@ -0,0 +1,98 @@
+#ifndef PARTITION_STORE_H
+#define PARTITION_STORE_H
+
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <vector>
+#include <QString>
+#include "sqlite_store.h"
+
+enum class partition_kind : uint8_t
+{
+    kTraffic,
+    kDns
+};
+
+// one sqlite file per kind and utc day next to the main database, so retention unlinks whole files
+// instead of deleting rows, connections are opened on first use and kept until the file is dropped
+class partition_store
+{
+   public:
+    static constexpr qint64 kPartitionMs = 24LL * 60 * 60 * 1000;
+    // width of the dns_buckets counts kept next to dns_logs, qps intervals that are a multiple read those
+    static constexpr qint64 kDnsBucketMs = 10 * 1000;
+
+    partition_store() = default;
+
+    partition_store(const partition_store&) = delete;
+    partition_store& operator=(const partition_store&) = delete;
+
+    // picks up the partition files already in directory, creating it when missing, a read only store never
+    // creates files or schema and only sees partitions a writer made
+    bool open(const QString& directory, bool read_only = false);
+    // picks up partitions added and forgets ones dropped by another connection since open
+    void rescan();
+    void close();
+
+    // the partition holding timestamp_ms, created on demand when create is set and the store is writable
+    sqlite_database* partition(partition_kind kind, qint64 timestamp_ms, bool create);
+    // partitions overlapping [start_ms, end_ms] oldest first
+    std::vector<sqlite_database*> overlapping(partition_kind kind, qint64 start_ms, qint64 end_ms);
+    // visits partitions starting at or before timestamp_ms newest first until visit returns true, so older
+    // files are only opened when the newer ones did not hold what the caller looks for
+    template <typename Visit>
+    bool find_at_or_before(partition_kind kind, qint64 timestamp_ms, Visit&& visit);
+
+    std::optional<qint64> oldest_start_ms(partition_kind kind) const;
+    // unlinks every partition that ends at or before cutoff_ms and returns how many went
+    int drop_before(partition_kind kind, qint64 cutoff_ms);
+    qint64 disk_bytes() const;
+    // opens the next dns partition in day order once, so a file written before dns_buckets existed gets its
+    // counts rebuilt even when no new row lands in it, false once every partition was visited
+    bool backfill_dns_buckets();
+    // every connection opened so far, for maintenance such as wal checkpoints
+    std::vector<sqlite_database*> open_connections() const;
+    // a cached lookup in sqlite_master, partitions from older versions lack newer tables
+    static bool has_table(sqlite_database& db, const char* table);
+
+   private:
+    struct partition_file
+    {
+        QString path;
+        std::unique_ptr<sqlite_database> db;
+    };
+    using partition_map = std::map<qint64, partition_file>;
+
+    partition_map& partitions(partition_kind kind) { return kind == partition_kind::kTraffic ? traffic_ : dns_; }
+    const partition_map& partitions(partition_kind kind) const { return kind == partition_kind::kTraffic ? traffic_ : dns_; }
+    QString path_for(partition_kind kind, qint64 day) const;
+    sqlite_database* connect(partition_kind kind, partition_file& part);
+    void unlink(partition_file& part);
+
+    QString directory_;
+    bool read_only_ = false;
+    partition_map traffic_;
+    partition_map dns_;
+    // dns partitions before this day were visited by backfill_dns_buckets
+    qint64 dns_bucket_day_ = std::numeric_limits<qint64>::min();
+};
+
+template <typename Visit>
+bool partition_store::find_at_or_before(partition_kind kind, qint64 timestamp_ms, Visit&& visit)
+{
+    auto& map = partitions(kind);
+    for (auto it = std::make_reverse_iterator(map.upper_bound(timestamp_ms / kPartitionMs)); it != map.rend(); ++it)
+    {
+        if (sqlite_database* db = connect(kind, it->second); db != nullptr && visit(*db))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif
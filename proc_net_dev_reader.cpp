@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include "log.h"
+#include "proc_net_dev_reader.h"
+
+static constexpr size_t kInitialBufferSize = 16 * 1024;
+static constexpr size_t kHeaderLines = 2;
+
+static const char* skip_line(const char* cursor, const char* end)
+{
+    const void* newline = std::memchr(cursor, '\n', static_cast<size_t>(end - cursor));
+    return newline == nullptr ? end : static_cast<const char*>(newline) + 1;
+}
+
+static const char* skip_blanks(const char* cursor, const char* end)
+{
+    while (cursor < end && (*cursor == ' ' || *cursor == '\t'))
+    {
+        ++cursor;
+    }
+    return cursor;
+}
+
+static const char* parse_u64(const char* cursor, const char* end, uint64_t& value)
+{
+    cursor = skip_blanks(cursor, end);
+    value = 0;
+    while (cursor < end && *cursor >= '0' && *cursor <= '9')
+    {
+        value = value * 10 + static_cast<uint64_t>(*cursor - '0');
+        ++cursor;
+    }
+    return cursor;
+}
+
+proc_net_dev_reader::proc_net_dev_reader(std::string path) : path_(std::move(path)) {}
+
+proc_net_dev_reader::~proc_net_dev_reader() { close(); }
+
+bool proc_net_dev_reader::open()
+{
+    if (fd_ >= 0)
+    {
+        return true;
+    }
+    fd_ = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ < 0)
+    {
+        LOG_ERROR("open {} failed {}", path_, std::strerror(errno));
+        return false;
+    }
+    flags_fd_ = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (flags_fd_ < 0)
+    {
+        LOG_ERROR("create interface flags socket failed {}", std::strerror(errno));
+        close();
+        return false;
+    }
+    buffer_.resize(kInitialBufferSize);
+    return true;
+}
+
+void proc_net_dev_reader::close()
+{
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    if (flags_fd_ >= 0)
+    {
+        ::close(flags_fd_);
+        flags_fd_ = -1;
+    }
+}
+
+bool proc_net_dev_reader::is_running(const proc_net_dev_entry& entry) const
+{
+    ifreq request = {};
+    std::memcpy(request.ifr_name, entry.name, std::min(static_cast<size_t>(entry.name_length), sizeof(request.ifr_name) - 1));
+    // an interface removed since the read fails with ENODEV and is left out like a down one
+    if (flags_fd_ < 0 || ::ioctl(flags_fd_, SIOCGIFFLAGS, &request) < 0)
+    {
+        return false;
+    }
+    const int required = IFF_UP | IFF_RUNNING;
+    return (request.ifr_flags & required) == required;
+}
+
+bool proc_net_dev_reader::read(std::vector<proc_net_dev_entry>& entries)
+{
+    if (fd_ < 0)
+    {
+        return false;
+    }
+
+    for (;;)
+    {
+        ssize_t received = ::pread(fd_, buffer_.data(), buffer_.size(), 0);
+        if (received < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            LOG_ERROR("pread {} failed {}", path_, std::strerror(errno));
+            return false;
+        }
+
+        // a full buffer may mean the file was cut short so grow and read again
+        if (static_cast<size_t>(received) == buffer_.size())
+        {
+            buffer_.resize(buffer_.size() * 2);
+            LOG_DEBUG("{} read buffer grown to {} bytes", path_, buffer_.size());
+            continue;
+        }
+
+        parse(buffer_.data(), static_cast<size_t>(received), entries);
+        return true;
+    }
+}
+
+size_t proc_net_dev_reader::parse(const char* data, size_t length, std::vector<proc_net_dev_entry>& entries)
+{
+    const char* cursor = data;
+    const char* end = data + length;
+    for (size_t i = 0; i < kHeaderLines; ++i)
+    {
+        cursor = skip_line(cursor, end);
+    }
+
+    size_t count = 0;
+    while (cursor < end)
+    {
+        const char* line_end = skip_line(cursor, end);
+        const char* name_begin = skip_blanks(cursor, line_end);
+        const auto* colon = static_cast<const char*>(std::memchr(name_begin, ':', static_cast<size_t>(line_end - name_begin)));
+        if (colon == nullptr)
+        {
+            cursor = line_end;
+            continue;
+        }
+
+        if (count == entries.size())
+        {
+            entries.emplace_back();
+        }
+        proc_net_dev_entry& entry = entries[count];
+
+        auto name_length = static_cast<size_t>(colon - name_begin);
+        if (name_length >= sizeof(entry.name))
+        {
+            name_length = sizeof(entry.name) - 1;
+        }
+        std::memcpy(entry.name, name_begin, name_length);
+        entry.name[name_length] = '\0';
+        entry.name_length = static_cast<uint32_t>(name_length);
+
+        uint64_t unused = 0;
+        const char* field = colon + 1;
+        field = parse_u64(field, line_end, entry.rx_bytes);
+        field = parse_u64(field, line_end, entry.rx_packets);
+        field = parse_u64(field, line_end, entry.rx_errors);
+        field = parse_u64(field, line_end, entry.rx_dropped);
+        field = parse_u64(field, line_end, entry.rx_fifo_errors);
+        field = parse_u64(field, line_end, unused);    // frame
+        field = parse_u64(field, line_end, unused);    // compressed
+        field = parse_u64(field, line_end, entry.multicast);
+        field = parse_u64(field, line_end, entry.tx_bytes);
+        field = parse_u64(field, line_end, entry.tx_packets);
+        field = parse_u64(field, line_end, entry.tx_errors);
+        field = parse_u64(field, line_end, entry.tx_dropped);
+        parse_u64(field, line_end, entry.tx_fifo_errors);
+
+        ++count;
+        cursor = line_end;
+    }
+
+    entries.resize(count);
+    return count;
+}
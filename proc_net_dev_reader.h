@@ -0,0 +1,59 @@
+#ifndef PROC_NET_DEV_READER_H
+#define PROC_NET_DEV_READER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <string_view>
+#include "netlink_link_reader.h"
+
+struct proc_net_dev_entry
+{
+    char name[kLinkNameSize] = {};
+    uint32_t name_length = 0;
+    uint64_t rx_bytes = 0;
+    uint64_t rx_packets = 0;
+    uint64_t rx_errors = 0;
+    uint64_t rx_dropped = 0;
+    uint64_t rx_fifo_errors = 0;
+    uint64_t multicast = 0;
+    uint64_t tx_bytes = 0;
+    uint64_t tx_packets = 0;
+    uint64_t tx_errors = 0;
+    uint64_t tx_dropped = 0;
+    uint64_t tx_fifo_errors = 0;
+
+    std::string_view name_view() const { return {name, name_length}; }
+};
+
+// reads /proc/net/dev with a single pread into a buffer that is kept between calls,
+// /proc/net/dev carries no operstate so is_running asks the kernel for the interface flags
+class proc_net_dev_reader
+{
+   public:
+    explicit proc_net_dev_reader(std::string path = "/proc/net/dev");
+    ~proc_net_dev_reader();
+
+    proc_net_dev_reader(const proc_net_dev_reader&) = delete;
+    proc_net_dev_reader& operator=(const proc_net_dev_reader&) = delete;
+
+    bool open();
+    void close();
+
+    // entries is reused between calls and only grows when the interface count does
+    bool read(std::vector<proc_net_dev_entry>& entries);
+
+    // IFF_UP and IFF_RUNNING together match the operstate up or unknown filter of the other backends
+    bool is_running(const proc_net_dev_entry& entry) const;
+
+    static size_t parse(const char* data, size_t length, std::vector<proc_net_dev_entry>& entries);
+
+   private:
+    std::string path_;
+    int fd_ = -1;
+    // SIOCGIFFLAGS needs any socket to be issued on
+    int flags_fd_ = -1;
+    std::vector<char> buffer_;
+};
+
+#endif
@@ -0,0 +1,46 @@
+#include <ctime>
+#include "sample_clock.h"
+
+static constexpr qint64 kNanosPerSecond = 1000000000;
+static constexpr qint64 kNanosPerMilli = 1000000;
+static constexpr qint64 kMillisPerSecond = 1000;
+
+namespace
+{
+struct sample_time_registrar
+{
+    sample_time_registrar() { qRegisterMetaType<sample_time>("sample_time"); }
+};
+sample_time_registrar registrar;
+}    // namespace
+
+sample_time sample_clock::now()
+{
+    sample_time stamp;
+    stamp.monotonic_ns = monotonic_ns();
+    stamp.realtime_ms = realtime_ms();
+    return stamp;
+}
+
+qint64 sample_clock::monotonic_ns()
+{
+    timespec now = {};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<qint64>(now.tv_sec) * kNanosPerSecond + now.tv_nsec;
+}
+
+qint64 sample_clock::realtime_ms()
+{
+    timespec now = {};
+    clock_gettime(CLOCK_REALTIME, &now);
+    return static_cast<qint64>(now.tv_sec) * kMillisPerSecond + now.tv_nsec / kNanosPerMilli;
+}
+
+double sample_clock::elapsed_seconds(const sample_time& from, const sample_time& to)
+{
+    if (from.monotonic_ns != 0 && to.monotonic_ns != 0)
+    {
+        return static_cast<double>(to.monotonic_ns - from.monotonic_ns) / static_cast<double>(kNanosPerSecond);
+    }
+    return static_cast<double>(to.realtime_ms - from.realtime_ms) / static_cast<double>(kMillisPerSecond);
+}
@@ -0,0 +1,27 @@
+#ifndef SAMPLE_CLOCK_H
+#define SAMPLE_CLOCK_H
+
+#include <QMetaType>
+#include <QtGlobal>
+
+// monotonic_ns orders samples and drives rate math, realtime_ms is only for storage and display
+struct sample_time
+{
+    qint64 monotonic_ns = 0;
+    qint64 realtime_ms = 0;
+};
+
+class sample_clock
+{
+   public:
+    static sample_time now();
+    static qint64 monotonic_ns();
+    static qint64 realtime_ms();
+
+    // prefers the monotonic stamps and falls back to realtime when one side was loaded from the database
+    static double elapsed_seconds(const sample_time& from, const sample_time& to);
+};
+
+Q_DECLARE_METATYPE(sample_time)
+
+#endif
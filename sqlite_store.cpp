@@ -0,0 +1,159 @@
+#include <algorithm>
+#include "log.h"
+#include "sqlite_store.h"
+
+sqlite_statement::sqlite_statement(sqlite3* db, sqlite3_stmt* stmt) : db_(db), stmt_(stmt) {}
+
+sqlite_statement::~sqlite_statement() { sqlite3_finalize(stmt_); }
+
+void sqlite_statement::bind_text(int index, const QString& value)
+{
+    // sqlite converts utf16 to the database encoding itself, no QByteArray round trip
+    sqlite3_bind_text16(stmt_, index, value.utf16(), static_cast<int>(value.size() * sizeof(char16_t)), SQLITE_TRANSIENT);
+}
+
+void sqlite_statement::bind_text(int index, std::string_view value)
+{
+    sqlite3_bind_text(stmt_, index, value.data(), static_cast<int>(value.size()), SQLITE_TRANSIENT);
+}
+
+void sqlite_statement::bind_blob(int index, const void* data, int size) { sqlite3_bind_blob(stmt_, index, data, size, SQLITE_TRANSIENT); }
+
+sqlite_statement::step_result sqlite_statement::step()
+{
+    const int rc = sqlite3_step(stmt_);
+    if (rc == SQLITE_ROW)
+    {
+        return step_result::kRow;
+    }
+    if (rc == SQLITE_DONE)
+    {
+        return step_result::kDone;
+    }
+    if (rc == SQLITE_INTERRUPT)
+    {
+        return step_result::kInterrupted;
+    }
+    LOG_ERROR("sqlite step failed {} for {}", sqlite3_errmsg(db_), sqlite3_sql(stmt_));
+    return step_result::kError;
+}
+
+bool sqlite_statement::execute()
+{
+    const step_result result = step();
+    reset();
+    return result == step_result::kDone;
+}
+
+void sqlite_statement::reset()
+{
+    sqlite3_reset(stmt_);
+    sqlite3_clear_bindings(stmt_);
+}
+
+QString sqlite_statement::column_text(int column) const
+{
+    const auto* text = static_cast<const char16_t*>(sqlite3_column_text16(stmt_, column));
+    if (text == nullptr)
+    {
+        return {};
+    }
+    const int bytes = sqlite3_column_bytes16(stmt_, column);
+    return QString::fromUtf16(text, bytes / static_cast<int>(sizeof(char16_t)));
+}
+
+std::string_view sqlite_statement::column_blob(int column) const
+{
+    const void* data = sqlite3_column_blob(stmt_, column);
+    if (data == nullptr)
+    {
+        return {};
+    }
+    return {static_cast<const char*>(data), static_cast<size_t>(sqlite3_column_bytes(stmt_, column))};
+}
+
+sqlite_database::~sqlite_database() { close(); }
+
+bool sqlite_database::open(const QString& path, int flags)
+{
+    if (db_ != nullptr)
+    {
+        return true;
+    }
+    const QByteArray utf8_path = path.toUtf8();
+    if (sqlite3_open_v2(utf8_path.constData(), &db_, flags, nullptr) != SQLITE_OK)
+    {
+        LOG_ERROR("open sqlite database {} failed {}", utf8_path.constData(), db_ != nullptr ? sqlite3_errmsg(db_) : "out of memory");
+        close();
+        return false;
+    }
+    sqlite3_extended_result_codes(db_, 1);
+    return true;
+}
+
+void sqlite_database::close()
+{
+    // statements must be finalized before the connection can close
+    statements_.clear();
+    if (db_ != nullptr)
+    {
+        sqlite3_close(db_);
+        db_ = nullptr;
+    }
+}
+
+bool sqlite_database::exec(const char* sql)
+{
+    char* error = nullptr;
+    if (sqlite3_exec(db_, sql, nullptr, nullptr, &error) != SQLITE_OK)
+    {
+        LOG_ERROR("sqlite exec failed {} for {}", error != nullptr ? error : sqlite3_errmsg(db_), sql);
+        sqlite3_free(error);
+        return false;
+    }
+    return true;
+}
+
+int sqlite_database::wal_checkpoint()
+{
+    int log_frames = 0;
+    int checkpointed_frames = 0;
+    // without a busy handler a truncate that finds a reader degrades to a passive checkpoint and reports busy
+    const int rc = sqlite3_wal_checkpoint_v2(db_, nullptr, SQLITE_CHECKPOINT_TRUNCATE, &log_frames, &checkpointed_frames);
+    if (rc == SQLITE_BUSY)
+    {
+        return std::max(0, log_frames - checkpointed_frames);
+    }
+    if (rc != SQLITE_OK)
+    {
+        LOG_ERROR("sqlite wal checkpoint failed {}", sqlite3_errmsg(db_));
+        return -1;
+    }
+    return 0;
+}
+
+sqlite_statement* sqlite_database::statement(const std::string& sql)
+{
+    auto it = statements_.find(sql);
+    if (it != statements_.end())
+    {
+        return it->second.get();
+    }
+    auto prepared = prepare(sql);
+    if (prepared == nullptr)
+    {
+        return nullptr;
+    }
+    return statements_.emplace(sql, std::move(prepared)).first->second.get();
+}
+
+std::unique_ptr<sqlite_statement> sqlite_database::prepare(const std::string& sql)
+{
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v3(db_, sql.c_str(), static_cast<int>(sql.size() + 1), SQLITE_PREPARE_PERSISTENT, &stmt, nullptr) != SQLITE_OK)
+    {
+        LOG_ERROR("sqlite prepare failed {} for {}", sqlite3_errmsg(db_), sql);
+        return nullptr;
+    }
+    return std::make_unique<sqlite_statement>(db_, stmt);
+}
@@ -0,0 +1,97 @@
+#ifndef SQLITE_STORE_H
+#define SQLITE_STORE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <QString>
+#include <sqlite3.h>
+
+// thin typed wrapper over a prepared sqlite3_stmt, indexes are 1 based for binds and 0 based for columns like the C API
+class sqlite_statement
+{
+   public:
+    enum class step_result : uint8_t
+    {
+        kRow,
+        kDone,
+        kError,
+        // the progress handler asked to stop, not logged as a failure
+        kInterrupted
+    };
+
+    sqlite_statement(sqlite3* db, sqlite3_stmt* stmt);
+    ~sqlite_statement();
+
+    sqlite_statement(const sqlite_statement&) = delete;
+    sqlite_statement& operator=(const sqlite_statement&) = delete;
+
+    void bind_int64(int index, qint64 value) { sqlite3_bind_int64(stmt_, index, value); }
+    void bind_double(int index, double value) { sqlite3_bind_double(stmt_, index, value); }
+    void bind_null(int index) { sqlite3_bind_null(stmt_, index); }
+    void bind_text(int index, const QString& value);
+    void bind_text(int index, std::string_view value);
+    void bind_blob(int index, const void* data, int size);
+
+    step_result step();
+    // steps a statement that returns no rows and resets it
+    bool execute();
+    // clears the previous run so a cached statement can be reused
+    void reset();
+
+    qint64 column_int64(int column) const { return sqlite3_column_int64(stmt_, column); }
+    double column_double(int column) const { return sqlite3_column_double(stmt_, column); }
+    bool column_is_null(int column) const { return sqlite3_column_type(stmt_, column) == SQLITE_NULL; }
+    QString column_text(int column) const;
+    std::string_view column_blob(int column) const;
+
+    const char* sql() const { return sqlite3_sql(stmt_); }
+    const char* last_error() const { return sqlite3_errmsg(db_); }
+
+   private:
+    sqlite3* db_;
+    sqlite3_stmt* stmt_;
+};
+
+// owns the connection and a cache of prepared statements keyed by their sql text
+class sqlite_database
+{
+   public:
+    sqlite_database() = default;
+    ~sqlite_database();
+
+    sqlite_database(const sqlite_database&) = delete;
+    sqlite_database& operator=(const sqlite_database&) = delete;
+
+    bool open(const QString& path, int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX);
+    void close();
+    bool is_open() const { return db_ != nullptr; }
+
+    bool exec(const char* sql);
+    // prepared on first use and kept until close, the caller resets it when done
+    sqlite_statement* statement(const std::string& sql);
+    // for one off statements that should not live in the cache
+    std::unique_ptr<sqlite_statement> prepare(const std::string& sql);
+
+    bool begin() { return exec("BEGIN"); }
+    bool commit() { return exec("COMMIT"); }
+    bool rollback() { return exec("ROLLBACK"); }
+    // checkpoints and truncates the wal without waiting for readers, returns the frames a reader kept in the log
+    // or -1 on error
+    int wal_checkpoint();
+
+    // check runs every instructions virtual machine steps of any statement, a non zero return interrupts it
+    void set_progress_handler(int instructions, int (*check)(void*), void* context) { sqlite3_progress_handler(db_, instructions, check, context); }
+
+    int changes() const { return sqlite3_changes(db_); }
+    const char* last_error() const { return db_ != nullptr ? sqlite3_errmsg(db_) : "database not open"; }
+    sqlite3* handle() const { return db_; }
+
+   private:
+    sqlite3* db_ = nullptr;
+    std::unordered_map<std::string, std::unique_ptr<sqlite_statement>> statements_;
+};
+
+#endif
@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include "log.h"
+#include "sysfs_stats_reader.h"
+
+struct sysfs_counter
+{
+    const char* file;
+    __u64 rtnl_link_stats64::*field;
+};
+
+static constexpr sysfs_counter kCounters[] = {
+    {"statistics/rx_bytes", &rtnl_link_stats64::rx_bytes},
+    {"statistics/tx_bytes", &rtnl_link_stats64::tx_bytes},
+    {"statistics/rx_packets", &rtnl_link_stats64::rx_packets},
+    {"statistics/tx_packets", &rtnl_link_stats64::tx_packets},
+    {"statistics/rx_errors", &rtnl_link_stats64::rx_errors},
+    {"statistics/tx_errors", &rtnl_link_stats64::tx_errors},
+    {"statistics/rx_dropped", &rtnl_link_stats64::rx_dropped},
+    {"statistics/tx_dropped", &rtnl_link_stats64::tx_dropped},
+    {"statistics/rx_fifo_errors", &rtnl_link_stats64::rx_fifo_errors},
+    {"statistics/tx_fifo_errors", &rtnl_link_stats64::tx_fifo_errors},
+    {"statistics/multicast", &rtnl_link_stats64::multicast},
+};
+
+// the callers only tell up and unknown apart from the rest, so the other states all read as down
+static uint8_t parse_operstate(std::string_view state)
+{
+    if (state == "up")
+    {
+        return kOperStateUp;
+    }
+    if (state == "unknown")
+    {
+        return kOperStateUnknown;
+    }
+    return kOperStateDown;
+}
+
+sysfs_stats_reader::sysfs_stats_reader(std::string path) : path_(std::move(path))
+{
+    static_assert(std::size(kCounters) == kCounterFiles);
+}
+
+sysfs_stats_reader::~sysfs_stats_reader() { close(); }
+
+bool sysfs_stats_reader::open()
+{
+    if (dir_ != nullptr)
+    {
+        return true;
+    }
+    dir_ = ::opendir(path_.c_str());
+    if (dir_ == nullptr)
+    {
+        LOG_ERROR("open {} failed {}", path_, std::strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+void sysfs_stats_reader::close()
+{
+    for (auto& entry : interfaces_)
+    {
+        close_interface(entry.second);
+    }
+    interfaces_.clear();
+    if (dir_ != nullptr)
+    {
+        ::closedir(dir_);
+        dir_ = nullptr;
+    }
+}
+
+bool sysfs_stats_reader::read(std::vector<link_info>& links, bool (*skip)(std::string_view name))
+{
+    if (dir_ == nullptr)
+    {
+        return false;
+    }
+
+    for (auto& entry : interfaces_)
+    {
+        entry.second.listed = false;
+    }
+
+    size_t count = 0;
+    ::rewinddir(dir_);
+    while (const dirent* dir_entry = ::readdir(dir_))
+    {
+        const std::string_view name(dir_entry->d_name);
+        // interfaces are symlinks, bonding_masters and the dot entries are not
+        if (dir_entry->d_type != DT_LNK && dir_entry->d_type != DT_DIR && dir_entry->d_type != DT_UNKNOWN)
+        {
+            continue;
+        }
+        if (name == "." || name == ".." || name.size() >= kLinkNameSize || skip(name))
+        {
+            continue;
+        }
+
+        auto [it, inserted] = interfaces_.try_emplace(std::string(name));
+        if (inserted)
+        {
+            open_interface(it->first, it->second);
+        }
+        it->second.listed = true;
+
+        if (count == links.size())
+        {
+            links.emplace_back();
+        }
+        if (read_interface(it->first, it->second, links[count]))
+        {
+            ++count;
+        }
+    }
+    links.resize(count);
+
+    // a renamed interface shows up under its new name, the files of names no longer listed are closed
+    for (auto it = interfaces_.begin(); it != interfaces_.end();)
+    {
+        if (it->second.listed)
+        {
+            ++it;
+            continue;
+        }
+        close_interface(it->second);
+        it = interfaces_.erase(it);
+    }
+    return true;
+}
+
+void sysfs_stats_reader::open_interface(const std::string& name, interface_files& files)
+{
+    bool out_of_descriptors = false;
+    auto open_file = [this, &name, &out_of_descriptors](const char* file)
+    {
+        const int fd = ::openat(::dirfd(dir_), (name + '/' + file).c_str(), O_RDONLY | O_CLOEXEC);
+        out_of_descriptors = out_of_descriptors || (fd < 0 && errno == EMFILE);
+        return fd;
+    };
+    files.operstate_fd = open_file("operstate");
+    for (size_t i = 0; i < kCounterFiles; ++i)
+    {
+        files.counter_fds[i] = open_file(kCounters[i].file);
+    }
+    if (out_of_descriptors && !descriptor_limit_logged_)
+    {
+        LOG_WARN("out of file descriptors keeping {} statistics open, reading them with an open per tick", path_);
+        descriptor_limit_logged_ = true;
+    }
+
+    const ssize_t length = read_file(-1, name, "ifindex");
+    files.index = length > 0 ? static_cast<int>(std::strtol(buffer_.data(), nullptr, 10)) : 0;
+}
+
+void sysfs_stats_reader::close_interface(interface_files& files)
+{
+    if (files.operstate_fd >= 0)
+    {
+        ::close(files.operstate_fd);
+        files.operstate_fd = -1;
+    }
+    for (int& fd : files.counter_fds)
+    {
+        if (fd >= 0)
+        {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+}
+
+bool sysfs_stats_reader::read_interface(const std::string& name, const interface_files& files, link_info& link)
+{
+    // an interface removed since the scan fails here and is left out like the other backends leave it out
+    ssize_t length = read_file(files.operstate_fd, name, "operstate");
+    if (length <= 0)
+    {
+        return false;
+    }
+    std::string_view state(buffer_.data(), static_cast<size_t>(length));
+    while (!state.empty() && state.back() == '\n')
+    {
+        state.remove_suffix(1);
+    }
+
+    link.index = files.index;
+    std::memcpy(link.name, name.data(), name.size());
+    link.name[name.size()] = '\0';
+    link.operstate = parse_operstate(state);
+    link.has_stats = true;
+    link.stats = {};
+    if (link.operstate != kOperStateUp && link.operstate != kOperStateUnknown)
+    {
+        return true;
+    }
+    for (size_t i = 0; i < kCounterFiles; ++i)
+    {
+        length = read_file(files.counter_fds[i], name, kCounters[i].file);
+        if (length > 0)
+        {
+            link.stats.*kCounters[i].field = std::strtoull(buffer_.data(), nullptr, 10);
+        }
+    }
+    return true;
+}
+
+ssize_t sysfs_stats_reader::read_file(int fd, const std::string& name, const char* file)
+{
+    const bool transient = fd < 0;
+    if (transient)
+    {
+        fd = ::openat(::dirfd(dir_), (name + '/' + file).c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return -1;
+        }
+    }
+    ssize_t length = 0;
+    do
+    {
+        length = ::pread(fd, buffer_.data(), buffer_.size() - 1, 0);
+    } while (length < 0 && errno == EINTR);
+    if (transient)
+    {
+        ::close(fd);
+    }
+    buffer_[length > 0 ? static_cast<size_t>(length) : 0] = '\0';
+    return length;
+}
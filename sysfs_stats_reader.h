@@ -0,0 +1,56 @@
+#ifndef SYSFS_STATS_READER_H
+#define SYSFS_STATS_READER_H
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <dirent.h>
+#include "netlink_link_reader.h"
+
+// reads operstate and the statistics files under /sys/class/net, the files of each interface are opened once
+// and reread with pread, so a tick costs one directory scan and one read per file instead of an open and close
+class sysfs_stats_reader
+{
+   public:
+    explicit sysfs_stats_reader(std::string path = "/sys/class/net");
+    ~sysfs_stats_reader();
+
+    sysfs_stats_reader(const sysfs_stats_reader&) = delete;
+    sysfs_stats_reader& operator=(const sysfs_stats_reader&) = delete;
+
+    bool open();
+    void close();
+
+    // links is reused between calls, names skip returns true for are neither opened nor returned
+    bool read(std::vector<link_info>& links, bool (*skip)(std::string_view name));
+
+   private:
+    static constexpr size_t kCounterFiles = 11;
+
+    // a descriptor left at -1 could not be kept open, running out of descriptors on hosts with many
+    // interfaces, and that file is opened for each read instead
+    struct interface_files
+    {
+        int index = 0;
+        int operstate_fd = -1;
+        std::array<int, kCounterFiles> counter_fds = {};
+        bool listed = false;
+    };
+
+    void open_interface(const std::string& name, interface_files& files);
+    static void close_interface(interface_files& files);
+    bool read_interface(const std::string& name, const interface_files& files, link_info& link);
+    // rereads fd, or opens name/file for this read alone when fd is -1, the text lands nul terminated in buffer_
+    ssize_t read_file(int fd, const std::string& name, const char* file);
+
+   private:
+    std::string path_;
+    DIR* dir_ = nullptr;
+    std::unordered_map<std::string, interface_files> interfaces_;
+    bool descriptor_limit_logged_ = false;
+    std::array<char, 64> buffer_ = {};
+};
+
+#endif
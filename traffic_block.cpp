@@ -0,0 +1,223 @@
+#include <algorithm>
+#include "traffic_block.h"
+
+static constexpr char kBlockVersion = 1;
+
+// column 0 is the timestamp, the counters follow in traffic_point order
+static constexpr quint64 traffic_point::* kCounterFields[] = {&traffic_point::bytes_received,
+                                                              &traffic_point::bytes_sent,
+                                                              &traffic_point::rx_packets,
+                                                              &traffic_point::tx_packets,
+                                                              &traffic_point::rx_errors,
+                                                              &traffic_point::tx_errors,
+                                                              &traffic_point::rx_dropped,
+                                                              &traffic_point::tx_dropped,
+                                                              &traffic_point::rx_fifo_errors,
+                                                              &traffic_point::tx_fifo_errors,
+                                                              &traffic_point::multicast};
+
+static quint64 column_value(const traffic_point& point, size_t column)
+{
+    return column == 0 ? static_cast<quint64>(point.timestamp_ms) : point.*kCounterFields[column - 1];
+}
+
+static void set_column_value(traffic_point& point, size_t column, quint64 value)
+{
+    if (column == 0)
+    {
+        point.timestamp_ms = static_cast<qint64>(value);
+    }
+    else
+    {
+        point.*kCounterFields[column - 1] = value;
+    }
+}
+
+static void put_varint(std::string& out, quint64 value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+static bool get_varint(std::string_view& in, quint64& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && !in.empty(); shift += 7)
+    {
+        const auto byte = static_cast<quint8>(in.front());
+        in.remove_prefix(1);
+        value |= static_cast<quint64>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// deltas are differences of unsigned counters taken modulo 2^64, a reset reads as a small negative step
+static quint64 zigzag(quint64 delta) { return (delta << 1) ^ static_cast<quint64>(static_cast<qint64>(delta) >> 63); }
+static quint64 unzigzag(quint64 value) { return (value >> 1) ^ (~(value & 1) + 1); }
+
+void traffic_block::flush_run(const column& col, std::string& out)
+{
+    if (col.run_length == 0)
+    {
+        return;
+    }
+    // the low bit marks a run whose extra repeats follow
+    const bool repeated = col.run_length > 1;
+    put_varint(out, (zigzag(col.run_delta) << 1) | (repeated ? 1 : 0));
+    if (repeated)
+    {
+        put_varint(out, col.run_length - 2);
+    }
+}
+
+bool traffic_block::append(const traffic_point& point)
+{
+    if (count_ > 0 && point.timestamp_ms <= last_timestamp_ms_)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < kColumns; ++i)
+    {
+        column& col = columns_[i];
+        const quint64 value = column_value(point, i);
+        if (count_ == 0)
+        {
+            put_varint(col.bytes, value);
+        }
+        else
+        {
+            const quint64 delta = value - col.previous;
+            if (col.run_length > 0 && delta == col.run_delta)
+            {
+                col.run_length++;
+            }
+            else
+            {
+                flush_run(col, col.bytes);
+                col.run_delta = delta;
+                col.run_length = 1;
+            }
+        }
+        col.previous = value;
+    }
+    count_++;
+    last_timestamp_ms_ = point.timestamp_ms;
+    return true;
+}
+
+std::string traffic_block::encode() const
+{
+    std::string out;
+    out.push_back(kBlockVersion);
+    put_varint(out, count_);
+    std::string body;
+    for (const column& col : columns_)
+    {
+        body = col.bytes;
+        flush_run(col, body);
+        put_varint(out, body.size());
+        out += body;
+    }
+    return out;
+}
+
+// walks one column stream of count values, handing each row and its value to visit, false when the stream
+// ends early or a run reaches past count
+template <typename Visit>
+static bool decode_column(std::string_view in, quint64 count, Visit&& visit)
+{
+    quint64 value = 0;
+    quint64 row = 0;
+    if (count > 0)
+    {
+        if (!get_varint(in, value))
+        {
+            return false;
+        }
+        visit(row++, value);
+    }
+    while (row < count)
+    {
+        quint64 token = 0;
+        quint64 repeats = 1;
+        if (!get_varint(in, token) || ((token & 1) != 0 && !get_varint(in, repeats)))
+        {
+            return false;
+        }
+        if ((token & 1) != 0 && repeats > count)
+        {
+            return false;
+        }
+        repeats = (token & 1) != 0 ? repeats + 2 : 1;
+        const quint64 delta = unzigzag(token >> 1);
+        if (repeats > count - row)
+        {
+            return false;
+        }
+        for (quint64 n = 0; n < repeats; ++n)
+        {
+            value += delta;
+            visit(row++, value);
+        }
+    }
+    return true;
+}
+
+bool traffic_block::decode(std::string_view blob, qint64 start_ms, qint64 end_ms, QList<traffic_point>& out)
+{
+    quint64 count = 0;
+    if (blob.empty() || blob.front() != kBlockVersion)
+    {
+        return false;
+    }
+    blob.remove_prefix(1);
+    if (!get_varint(blob, count) || count > static_cast<quint64>(kBlockMs))
+    {
+        return false;
+    }
+
+    // runs let a few bytes stand for many rows, so the blob length says nothing about count, every column is
+    // walked once before out grows and a corrupt count is rejected without allocating for it
+    std::array<std::string_view, kColumns> streams;
+    for (std::string_view& stream : streams)
+    {
+        quint64 length = 0;
+        if (!get_varint(blob, length) || length > blob.size())
+        {
+            return false;
+        }
+        stream = blob.substr(0, length);
+        blob.remove_prefix(length);
+        if (!decode_column(stream, count, [](quint64, quint64) {}))
+        {
+            return false;
+        }
+    }
+
+    // samples are written straight into out and the ones outside the range trimmed afterwards
+    const qsizetype base = out.size();
+    out.resize(base + static_cast<qsizetype>(count));
+    for (size_t i = 0; i < kColumns; ++i)
+    {
+        decode_column(streams[i],
+                      count,
+                      [&out, base, i](quint64 row, quint64 value) { set_column_value(out[base + static_cast<qsizetype>(row)], i, value); });
+    }
+
+    const auto first = std::lower_bound(out.begin() + base, out.end(), start_ms,
+                                        [](const traffic_point& point, qint64 ms) { return point.timestamp_ms < ms; });
+    const auto last = std::upper_bound(first, out.end(), end_ms, [](qint64 ms, const traffic_point& point) { return ms < point.timestamp_ms; });
+    const qsizetype keep_first = first - out.begin();
+    const qsizetype keep_last = last - out.begin();
+    out.erase(out.begin() + keep_last, out.end());
+    out.erase(out.begin() + base, out.begin() + keep_first);
+    return true;
+}
@@ -0,0 +1,48 @@
+#ifndef TRAFFIC_BLOCK_H
+#define TRAFFIC_BLOCK_H
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <QList>
+#include "traffic_point.h"
+#include "traffic_rollup.h"
+
+// one interface hour of samples stored column by column, every column is a raw first value followed by
+// zigzag varint deltas where a repeated delta is folded into a run, so the fixed 1 s spacing and idle
+// counters shrink to a few bytes per block and only the busy byte and packet counters cost per sample
+class traffic_block
+{
+   public:
+    static constexpr qint64 kBlockMs = kMillisPerHour;
+
+    static qint64 block_start(qint64 timestamp_ms) { return timestamp_ms - timestamp_ms % kBlockMs; }
+    // appends the samples in [start_ms, end_ms] to out in timestamp order, false when the blob is malformed
+    static bool decode(std::string_view blob, qint64 start_ms, qint64 end_ms, QList<traffic_point>& out);
+
+    // samples must arrive in timestamp order, one not newer than the last is ignored
+    bool append(const traffic_point& point);
+    std::string encode() const;
+    bool empty() const { return count_ == 0; }
+    quint32 size() const { return count_; }
+    qint64 last_timestamp_ms() const { return last_timestamp_ms_; }
+
+   private:
+    static constexpr size_t kColumns = 12;
+
+    struct column
+    {
+        std::string bytes;
+        quint64 previous = 0;
+        quint64 run_delta = 0;
+        quint64 run_length = 0;
+    };
+
+    static void flush_run(const column& col, std::string& out);
+
+    std::array<column, kColumns> columns_;
+    quint32 count_ = 0;
+    qint64 last_timestamp_ms_ = 0;
+};
+
+#endif
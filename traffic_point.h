@@ -0,0 +1,22 @@
+#ifndef TRAFFIC_POINT_H
+#define TRAFFIC_POINT_H
+
+#include <QtGlobal>
+
+struct traffic_point
+{
+    qint64 timestamp_ms = 0;
+    quint64 bytes_received = 0;
+    quint64 bytes_sent = 0;
+    quint64 rx_packets = 0;
+    quint64 tx_packets = 0;
+    quint64 rx_errors = 0;
+    quint64 tx_errors = 0;
+    quint64 rx_dropped = 0;
+    quint64 tx_dropped = 0;
+    quint64 rx_fifo_errors = 0;
+    quint64 tx_fifo_errors = 0;
+    quint64 multicast = 0;
+};
+
+#endif
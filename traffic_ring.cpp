@@ -0,0 +1,73 @@
+#include "traffic_ring.h"
+
+traffic_ring::traffic_ring(qsizetype capacity) : capacity_(capacity > 0 ? capacity : 1) {}
+
+void traffic_ring::append(const traffic_point& point)
+{
+    if (count_ > 0 && point.timestamp_ms <= timestamps_[static_cast<size_t>(slot(count_ - 1))])
+    {
+        return;
+    }
+    // the columns grow with the samples until the ring is full, head_ only moves once it wraps
+    if (count_ < capacity_)
+    {
+        timestamps_.push_back(point.timestamp_ms);
+        bytes_received_.push_back(point.bytes_received);
+        bytes_sent_.push_back(point.bytes_sent);
+        rx_packets_.push_back(point.rx_packets);
+        tx_packets_.push_back(point.tx_packets);
+        rx_dropped_.push_back(point.rx_dropped);
+        tx_dropped_.push_back(point.tx_dropped);
+        count_++;
+        return;
+    }
+    head_ = slot(1);
+    const auto i = static_cast<size_t>(slot(count_ - 1));
+    timestamps_[i] = point.timestamp_ms;
+    bytes_received_[i] = point.bytes_received;
+    bytes_sent_[i] = point.bytes_sent;
+    rx_packets_[i] = point.rx_packets;
+    tx_packets_[i] = point.tx_packets;
+    rx_dropped_[i] = point.rx_dropped;
+    tx_dropped_[i] = point.tx_dropped;
+}
+
+qsizetype traffic_ring::lower_bound(qint64 ms) const
+{
+    qsizetype low = 0;
+    qsizetype high = count_;
+    while (low < high)
+    {
+        const qsizetype mid = low + (high - low) / 2;
+        if (timestamps_[static_cast<size_t>(slot(mid))] < ms)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+void traffic_ring::read(qint64 start_ms, qint64 end_ms, QList<traffic_point>& out) const
+{
+    const qsizetype first = lower_bound(start_ms);
+    const qsizetype last = lower_bound(end_ms + 1);
+    const qsizetype from = first > 0 ? first - 1 : first;
+    out.reserve(out.size() + (last - from));
+    for (qsizetype logical = from; logical < last; ++logical)
+    {
+        const auto i = static_cast<size_t>(slot(logical));
+        traffic_point point;
+        point.timestamp_ms = timestamps_[i];
+        point.bytes_received = bytes_received_[i];
+        point.bytes_sent = bytes_sent_[i];
+        point.rx_packets = rx_packets_[i];
+        point.tx_packets = tx_packets_[i];
+        point.rx_dropped = rx_dropped_[i];
+        point.tx_dropped = tx_dropped_[i];
+        out.append(point);
+    }
+}
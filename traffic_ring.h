@@ -0,0 +1,45 @@
+#ifndef TRAFFIC_RING_H
+#define TRAFFIC_RING_H
+
+#include <vector>
+#include <QList>
+#include "traffic_point.h"
+
+// the newest samples of one interface in a ring of at most capacity samples, one column per counter the rate
+// series needs so a range copy stays in a few contiguous arrays, the columns grow as samples arrive and the
+// oldest sample is overwritten once full
+class traffic_ring
+{
+   public:
+    explicit traffic_ring(qsizetype capacity = 0);
+
+    // samples not newer than the last one are ignored
+    void append(const traffic_point& point);
+    bool empty() const { return count_ == 0; }
+    qsizetype size() const { return count_; }
+    qint64 oldest_ms() const { return timestamps_[static_cast<size_t>(slot(0))]; }
+    // true when a sample before start_ms is still held, so everything from start_ms on and the sample
+    // seeding the first rate are all in memory
+    bool covers(qint64 start_ms) const { return count_ > 0 && oldest_ms() < start_ms; }
+    // appends the newest sample before start_ms and the samples in [start_ms, end_ms], only bytes, packets
+    // and drops are filled in
+    void read(qint64 start_ms, qint64 end_ms, QList<traffic_point>& out) const;
+
+   private:
+    qsizetype slot(qsizetype logical) const { return (head_ + logical) % capacity_; }
+    // first logical index whose timestamp is at or after ms
+    qsizetype lower_bound(qint64 ms) const;
+
+    qsizetype capacity_;
+    qsizetype head_ = 0;
+    qsizetype count_ = 0;
+    std::vector<qint64> timestamps_;
+    std::vector<quint64> bytes_received_;
+    std::vector<quint64> bytes_sent_;
+    std::vector<quint64> rx_packets_;
+    std::vector<quint64> tx_packets_;
+    std::vector<quint64> rx_dropped_;
+    std::vector<quint64> tx_dropped_;
+};
+
+#endif
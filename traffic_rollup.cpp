@@ -0,0 +1,232 @@
+#include <algorithm>
+#include <string>
+#include "log.h"
+#include "traffic_rollup.h"
+
+static const char* const kLastColumns[] = {"timestamp",
+                                           "bytes_received",
+                                           "bytes_sent",
+                                           "rx_packets",
+                                           "tx_packets",
+                                           "rx_errors",
+                                           "tx_errors",
+                                           "rx_dropped",
+                                           "tx_dropped",
+                                           "rx_fifo_errors",
+                                           "tx_fifo_errors",
+                                           "multicast"};
+
+static std::string build_upsert_sql()
+{
+    std::string columns;
+    std::string values;
+    std::string last_updates;
+    int index = 12;
+    for (const char* column : kLastColumns)
+    {
+        columns += std::string(", ") + column;
+        values += ", ?" + std::to_string(index++);
+        // a backfilled older sample must not overwrite the newer counters of a live bucket
+        last_updates += std::string(", ") + column + " = CASE WHEN excluded.timestamp >= traffic_rollups.timestamp THEN excluded." + column +
+                        " ELSE traffic_rollups." + column + " END";
+    }
+    return "INSERT INTO traffic_rollups (tier, interface_id, bucket_start, samples, span_ms, rx_bytes, tx_bytes, rx_rate_min, rx_rate_max, "
+           "tx_rate_min, tx_rate_max" +
+           columns + ") VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10, ?11" + values +
+           ") ON CONFLICT (tier, interface_id, bucket_start) DO UPDATE SET "
+           "samples = samples + excluded.samples, span_ms = span_ms + excluded.span_ms, "
+           "rx_bytes = rx_bytes + excluded.rx_bytes, tx_bytes = tx_bytes + excluded.tx_bytes, "
+           "rx_rate_min = MIN(rx_rate_min, excluded.rx_rate_min), rx_rate_max = MAX(rx_rate_max, excluded.rx_rate_max), "
+           "tx_rate_min = MIN(tx_rate_min, excluded.tx_rate_min), tx_rate_max = MAX(tx_rate_max, excluded.tx_rate_max)" +
+           last_updates;
+}
+
+const char* traffic_rollup::create_table_sql()
+{
+    return "CREATE TABLE IF NOT EXISTS traffic_rollups ("
+           "tier INTEGER NOT NULL, "
+           "interface_id INTEGER NOT NULL, "
+           "bucket_start INTEGER NOT NULL, "
+           "samples INTEGER NOT NULL, "
+           "span_ms INTEGER NOT NULL, "
+           "rx_bytes INTEGER NOT NULL, "
+           "tx_bytes INTEGER NOT NULL, "
+           "rx_rate_min REAL NOT NULL, "
+           "rx_rate_max REAL NOT NULL, "
+           "tx_rate_min REAL NOT NULL, "
+           "tx_rate_max REAL NOT NULL, "
+           "timestamp INTEGER NOT NULL, "
+           "bytes_received INTEGER NOT NULL, "
+           "bytes_sent INTEGER NOT NULL, "
+           "rx_packets INTEGER NOT NULL, "
+           "tx_packets INTEGER NOT NULL, "
+           "rx_errors INTEGER NOT NULL, "
+           "tx_errors INTEGER NOT NULL, "
+           "rx_dropped INTEGER NOT NULL, "
+           "tx_dropped INTEGER NOT NULL, "
+           "rx_fifo_errors INTEGER NOT NULL, "
+           "tx_fifo_errors INTEGER NOT NULL, "
+           "multicast INTEGER NOT NULL, "
+           "PRIMARY KEY (tier, interface_id, bucket_start)"
+           ") WITHOUT ROWID";
+}
+
+tier_ages traffic_rollup::default_tier_ages()
+{
+    tier_ages ages{};
+    for (size_t i = 0; i < kRollupTiers.size(); ++i)
+    {
+        ages[i] = kRollupTiers[i].retention_ms;
+    }
+    return ages;
+}
+
+const rollup_tier& traffic_rollup::pick_tier(qint64 start_ms, qint64 end_ms, int pixel_width, qint64 now_ms, const tier_ages& max_age_ms)
+{
+    const qint64 age_ms = now_ms - start_ms;
+    const qint64 span_ms = end_ms - start_ms;
+    if (pixel_width <= 0 || span_ms <= 0)
+    {
+        return kRollupTiers.front();
+    }
+    for (size_t i = kRollupTiers.size(); i-- > 0;)
+    {
+        const rollup_tier& tier = kRollupTiers[i];
+        if (age_ms > max_age_ms[i])
+        {
+            continue;
+        }
+        if (tier.resolution_ms == 0 || span_ms / tier.resolution_ms >= pixel_width)
+        {
+            return tier;
+        }
+    }
+    // nothing is dense enough, take the most detail that still reaches back to start_ms
+    for (size_t i = 0; i < kRollupTiers.size(); ++i)
+    {
+        if (age_ms <= max_age_ms[i])
+        {
+            return kRollupTiers[i];
+        }
+    }
+    return kRollupTiers.back();
+}
+
+void traffic_rollup::add(qint64 interface_id, const traffic_point& point)
+{
+    auto it = last_points_.find(interface_id);
+    if (it == last_points_.end())
+    {
+        last_points_.insert(interface_id, point);
+        return;
+    }
+    const traffic_point previous = it.value();
+    const qint64 span_ms = point.timestamp_ms - previous.timestamp_ms;
+    if (span_ms <= 0)
+    {
+        return;
+    }
+    it.value() = point;
+    // a counter that went backwards means the interface was reset, the next sample starts a fresh delta
+    if (point.bytes_received < previous.bytes_received || point.bytes_sent < previous.bytes_sent)
+    {
+        return;
+    }
+
+    const quint64 rx_bytes = point.bytes_received - previous.bytes_received;
+    const quint64 tx_bytes = point.bytes_sent - previous.bytes_sent;
+    const double rx_rate = static_cast<double>(rx_bytes) * 1000.0 / static_cast<double>(span_ms);
+    const double tx_rate = static_cast<double>(tx_bytes) * 1000.0 / static_cast<double>(span_ms);
+
+    for (const auto& tier : kRollupTiers)
+    {
+        if (tier.resolution_ms == 0)
+        {
+            continue;
+        }
+        const qint64 bucket_start = point.timestamp_ms / tier.resolution_ms * tier.resolution_ms;
+        bucket& b = pending_[std::make_tuple(tier.id, interface_id, bucket_start)];
+        if (b.samples == 0)
+        {
+            b.rx_rate_min = b.rx_rate_max = rx_rate;
+            b.tx_rate_min = b.tx_rate_max = tx_rate;
+        }
+        else
+        {
+            b.rx_rate_min = std::min(b.rx_rate_min, rx_rate);
+            b.rx_rate_max = std::max(b.rx_rate_max, rx_rate);
+            b.tx_rate_min = std::min(b.tx_rate_min, tx_rate);
+            b.tx_rate_max = std::max(b.tx_rate_max, tx_rate);
+        }
+        b.samples++;
+        b.span_ms += span_ms;
+        b.rx_bytes += rx_bytes;
+        b.tx_bytes += tx_bytes;
+        if (point.timestamp_ms >= b.last.timestamp_ms)
+        {
+            b.last = point;
+        }
+    }
+}
+
+bool traffic_rollup::write(sqlite_database& db)
+{
+    static const std::string kUpsertSql = build_upsert_sql();
+    if (pending_.empty())
+    {
+        return true;
+    }
+    sqlite_statement* upsert = db.statement(kUpsertSql);
+    if (upsert == nullptr)
+    {
+        pending_.clear();
+        return false;
+    }
+
+    bool ok = true;
+    for (const auto& [key, b] : pending_)
+    {
+        upsert->bind_int64(1, std::get<0>(key));
+        upsert->bind_int64(2, std::get<1>(key));
+        upsert->bind_int64(3, std::get<2>(key));
+        upsert->bind_int64(4, b.samples);
+        upsert->bind_int64(5, b.span_ms);
+        upsert->bind_int64(6, static_cast<qint64>(b.rx_bytes));
+        upsert->bind_int64(7, static_cast<qint64>(b.tx_bytes));
+        upsert->bind_double(8, b.rx_rate_min);
+        upsert->bind_double(9, b.rx_rate_max);
+        upsert->bind_double(10, b.tx_rate_min);
+        upsert->bind_double(11, b.tx_rate_max);
+        const quint64 counters[] = {b.last.bytes_received,
+                                    b.last.bytes_sent,
+                                    b.last.rx_packets,
+                                    b.last.tx_packets,
+                                    b.last.rx_errors,
+                                    b.last.tx_errors,
+                                    b.last.rx_dropped,
+                                    b.last.tx_dropped,
+                                    b.last.rx_fifo_errors,
+                                    b.last.tx_fifo_errors,
+                                    b.last.multicast};
+        upsert->bind_int64(12, b.last.timestamp_ms);
+        int index = 13;
+        for (quint64 counter : counters)
+        {
+            upsert->bind_int64(index++, static_cast<qint64>(counter));
+        }
+        if (!upsert->execute())
+        {
+            LOG_ERROR("upsert traffic rollup tier {} failed {}", std::get<0>(key), db.last_error());
+            ok = false;
+            break;
+        }
+    }
+    pending_.clear();
+    return ok;
+}
+
+void traffic_rollup::clear()
+{
+    pending_.clear();
+    last_points_.clear();
+}
@@ -0,0 +1,66 @@
+#ifndef TRAFFIC_ROLLUP_H
+#define TRAFFIC_ROLLUP_H
+
+#include <array>
+#include <map>
+#include <tuple>
+#include <QHash>
+#include "sqlite_store.h"
+#include "traffic_point.h"
+
+struct rollup_tier
+{
+    int id;
+    qint64 resolution_ms;
+    qint64 retention_ms;
+};
+
+// tier 0 is the raw traffic_snapshots table, the rest live in traffic_rollups ordered fine to coarse
+static constexpr qint64 kMillisPerHour = 60LL * 60 * 1000;
+static constexpr std::array<rollup_tier, 4> kRollupTiers = {{
+    {0, 0, 2 * 24 * kMillisPerHour},
+    {1, 60 * 1000, 30 * 24 * kMillisPerHour},
+    {2, 15 * 60 * 1000, 180 * 24 * kMillisPerHour},
+    {3, kMillisPerHour, 365 * 24 * kMillisPerHour},
+}};
+
+// maximum age per kRollupTiers entry in the same order, the defaults come from retention_ms
+using tier_ages = std::array<qint64, kRollupTiers.size()>;
+
+// folds raw counter samples into per tier buckets holding byte totals, min and max rates and the
+// last counters seen, so a bucket reads back as a traffic_point the chart can difference like a raw row
+class traffic_rollup
+{
+   public:
+    static const char* create_table_sql();
+    static tier_ages default_tier_ages();
+    // coarsest tier with at least one bucket per pixel whose retention still reaches start_ms
+    static const rollup_tier& pick_tier(qint64 start_ms, qint64 end_ms, int pixel_width, qint64 now_ms, const tier_ages& max_age_ms);
+
+    // the first sample of an interface only seeds the delta for the next one
+    void add(qint64 interface_id, const traffic_point& point);
+    // upserts every bucket touched since the last write, the caller owns the transaction
+    bool write(sqlite_database& db);
+    bool empty() const { return pending_.empty(); }
+    void clear();
+
+   private:
+    struct bucket
+    {
+        qint64 samples = 0;
+        qint64 span_ms = 0;
+        quint64 rx_bytes = 0;
+        quint64 tx_bytes = 0;
+        double rx_rate_min = 0;
+        double rx_rate_max = 0;
+        double tx_rate_min = 0;
+        double tx_rate_max = 0;
+        traffic_point last;
+    };
+
+    QHash<qint64, traffic_point> last_points_;
+    // (tier, interface_id, bucket_start)
+    std::map<std::tuple<int, qint64, qint64>, bucket> pending_;
+};
+
+#endif
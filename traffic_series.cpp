@@ -0,0 +1,134 @@
+#include <algorithm>
+#include "traffic_series.h"
+
+QPair<double, double> calculate_traffic_speeds(
+    double interval_seconds, quint64 prev_bytes_sent, quint64 prev_bytes_received, quint64 curr_bytes_sent, quint64 curr_bytes_received)
+{
+    if (interval_seconds <= 0)
+    {
+        return {0.0, 0.0};
+    }
+
+    quint64 sent_diff = (curr_bytes_sent >= prev_bytes_sent) ? (curr_bytes_sent - prev_bytes_sent) : curr_bytes_sent;
+    quint64 recv_diff = (curr_bytes_received >= prev_bytes_received) ? (curr_bytes_received - prev_bytes_received) : curr_bytes_received;
+
+    double upload_speed_kb = (static_cast<double>(sent_diff) / interval_seconds) / 1024.0;
+    double download_speed_kb = (static_cast<double>(recv_diff) / interval_seconds) / 1024.0;
+
+    return {upload_speed_kb, download_speed_kb};
+}
+
+void build_rate_series(
+    interface_history& history, const QList<traffic_point>& points, int pixel_width, int sample_interval_ms, const QList<rate_envelope>& envelopes)
+{
+    if (points.size() < 2)
+    {
+        return;
+    }
+    history.first_rate_ms = points[1].timestamp_ms;
+    history.last_point = points.last();
+
+    QList<QPointF>* series[] = {&history.upload, &history.download, &history.packets, &history.drops};
+    for (auto* rates : series)
+    {
+        rates->reserve(points.size() * 2);
+    }
+
+    const bool has_envelopes = envelopes.size() == points.size();
+    // rollup buckets are a whole bucket apart, only a longer silence is a gap
+    const qint64 max_gap_ms = kMaxDataGapIntervals * std::max(sample_interval_ms, 1) + history.resolution_ms;
+    for (qsizetype i = 1; i < points.size(); ++i)
+    {
+        const auto& current = points[i];
+        const auto& previous = points[i - 1];
+        const qint64 interval_ms = current.timestamp_ms - previous.timestamp_ms;
+
+        if (interval_ms > max_gap_ms)
+        {
+            for (auto* rates : series)
+            {
+                rates->append(QPointF(static_cast<double>(previous.timestamp_ms + 1), 0.0));
+                rates->append(QPointF(static_cast<double>(current.timestamp_ms - 1), 0.0));
+            }
+        }
+        if (interval_ms <= 0)
+        {
+            continue;
+        }
+
+        const double interval_seconds = static_cast<double>(interval_ms) / 1000.0;
+        QPair<double, double> speeds =
+            calculate_traffic_speeds(interval_seconds, previous.bytes_sent, previous.bytes_received, current.bytes_sent, current.bytes_received);
+        QPair<double, double> packet_rates = calculate_packet_rates(interval_seconds, previous, current);
+        const auto x = static_cast<double>(current.timestamp_ms);
+        if (has_envelopes)
+        {
+            // a short burst inside a coarse bucket would vanish in its average
+            const rate_envelope& envelope = envelopes[i];
+            history.upload.append(QPointF(x, envelope.tx_min / 1024.0));
+            history.upload.append(QPointF(x, envelope.tx_max / 1024.0));
+            history.download.append(QPointF(x, envelope.rx_min / 1024.0));
+            history.download.append(QPointF(x, envelope.rx_max / 1024.0));
+        }
+        else
+        {
+            history.upload.append(QPointF(x, speeds.first));
+            history.download.append(QPointF(x, speeds.second));
+        }
+        history.packets.append(QPointF(x, packet_rates.first));
+        history.drops.append(QPointF(x, packet_rates.second));
+    }
+
+    if (pixel_width > 0)
+    {
+        for (auto* rates : series)
+        {
+            *rates = decimate_min_max(*rates, pixel_width);
+        }
+    }
+}
+
+QList<QPointF> decimate_min_max(const QList<QPointF>& points, int buckets)
+{
+    if (buckets <= 0 || points.size() <= 2 * static_cast<qsizetype>(buckets))
+    {
+        return points;
+    }
+    const double first_x = points.first().x();
+    const double bucket_width = (points.last().x() - first_x) / buckets;
+    if (bucket_width <= 0)
+    {
+        return points;
+    }
+
+    QList<QPointF> decimated;
+    decimated.reserve(2 * static_cast<qsizetype>(buckets));
+    qsizetype i = 0;
+    while (i < points.size())
+    {
+        const int bucket = std::min(buckets - 1, static_cast<int>((points[i].x() - first_x) / bucket_width));
+        const bool last_bucket = bucket == buckets - 1;
+        const double bucket_end = first_x + (bucket + 1) * bucket_width;
+        qsizetype low = i;
+        qsizetype high = i;
+        qsizetype next = i + 1;
+        for (; next < points.size() && (last_bucket || points[next].x() < bucket_end); ++next)
+        {
+            if (points[next].y() < points[low].y())
+            {
+                low = next;
+            }
+            if (points[next].y() > points[high].y())
+            {
+                high = next;
+            }
+        }
+        decimated.append(points[std::min(low, high)]);
+        if (low != high)
+        {
+            decimated.append(points[std::max(low, high)]);
+        }
+        i = next;
+    }
+    return decimated;
+}
@@ -0,0 +1,73 @@
+#ifndef TRAFFIC_SERIES_H
+#define TRAFFIC_SERIES_H
+
+#include <QList>
+#include <QPair>
+#include <QPointF>
+#include <QString>
+#include "traffic_point.h"
+
+// samples further apart than this many sampling intervals plus the tier resolution are drawn as a drop to zero
+static constexpr qint64 kMaxDataGapIntervals = 5;
+
+// one interface's share of a batched history load with the rates ready to hand to the chart
+struct interface_history
+{
+    QString interface_name;
+    // bucket width of the tier that answered, 0 for raw samples
+    qint64 resolution_ms = 0;
+    QList<QPointF> upload;
+    QList<QPointF> download;
+    QList<QPointF> packets;
+    QList<QPointF> drops;
+    // newest stored counters the live series continues from, timestamp_ms is 0 when nothing was stored
+    traffic_point last_point;
+    // time of the first rate point, 0 when fewer than two samples were stored
+    qint64 first_rate_ms = 0;
+};
+
+// lowest and highest byte rate between the samples folded into one rollup bucket, in bytes per second
+struct rate_envelope
+{
+    double rx_min = 0;
+    double rx_max = 0;
+    double tx_min = 0;
+    double tx_max = 0;
+};
+
+// upload and download in KB/s, a counter that went backwards counts from zero
+QPair<double, double> calculate_traffic_speeds(
+    double interval_seconds, quint64 prev_bytes_sent, quint64 prev_bytes_received, quint64 curr_bytes_sent, quint64 curr_bytes_received);
+
+inline quint64 counter_delta(quint64 previous, quint64 current) { return (current >= previous) ? (current - previous) : current; }
+
+// packets and drops per second summed over both directions
+template <typename Counters>
+QPair<double, double> calculate_packet_rates(double interval_seconds, const Counters& previous, const Counters& current)
+{
+    if (interval_seconds <= 0)
+    {
+        return {0.0, 0.0};
+    }
+
+    quint64 packets_diff = counter_delta(previous.rx_packets, current.rx_packets) + counter_delta(previous.tx_packets, current.tx_packets);
+    quint64 drops_diff = counter_delta(previous.rx_dropped, current.rx_dropped) + counter_delta(previous.tx_dropped, current.tx_dropped);
+
+    return {static_cast<double>(packets_diff) / interval_seconds, static_cast<double>(drops_diff) / interval_seconds};
+}
+
+// rates between consecutive samples sorted by time, reduced to a min and a max per pixel column when there
+// are more points than pixel_width can show, 0 keeps every point, envelopes aligned with points draw each
+// bucket's upload and download as its min and max instead of the average, sample_interval_ms is the
+// collection interval gaps are measured in
+void build_rate_series(interface_history& history,
+                       const QList<traffic_point>& points,
+                       int pixel_width,
+                       int sample_interval_ms,
+                       const QList<rate_envelope>& envelopes = {});
+
+// keeps the lowest and highest point of each of buckets equal time slices in time order, so spikes and
+// drops survive at any zoom level
+QList<QPointF> decimate_min_max(const QList<QPointF>& points, int buckets);
+
+#endif